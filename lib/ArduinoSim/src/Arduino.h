@@ -0,0 +1,109 @@
+/**
+ * @file Arduino.h
+ * @brief Host stand-in for the parts of the Arduino core used by the
+ *    memory drivers. Only built for the [env:native] target.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * Pins, delays and the clock are not real: every digitalWrite(), delay()
+ * and SPI transfer is forwarded to the simulated bus (see sim_bus.h), which
+ * keeps a virtual clock in nanoseconds. millis() and micros() read that
+ * virtual clock, so code that measures its own duration on the Nano measures
+ * the simulated duration here.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define SPACERAD_NATIVE_SIMULATOR 1
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+// Program memory is plain memory on the host.
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#define pgm_read_word(address) (*(const uint16_t*)(address))
+#define pgm_read_dword(address) (*(const uint32_t*)(address))
+
+// Strings in F() stay in the flash of the AVR instead of being copied to
+// its RAM at startup. On the host they are plain strings.
+class __FlashStringHelper;
+#define F(string) (reinterpret_cast<const __FlashStringHelper*>(string))
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+// Stand-in for writing a pin through its PORTx register, which the AVR does
+// with a single sbi/cbi instruction. Charged at that cost instead of the one
+// of digitalWrite() (see chip_select.h).
+void simPortWrite(uint8_t pin, uint8_t value);
+
+// Stand-ins for a byte over 1, 2 or 4 data lines (see spi_lanes.h), bit
+// banged on a port of the ATmega328 or shifted by the QSPI peripheral of a
+// faster MCU at clockHz, where lanes is 8 for 4 lines on both clock edges.
+// Charged as such by the simulated bus.
+uint8_t simBitBangTransfer(uint8_t mosi, uint8_t lanes);
+uint8_t simQspiTransfer(uint8_t mosi, uint8_t lanes, uint32_t clockHz);
+
+void delay(unsigned long milliseconds);
+void delayMicroseconds(unsigned int microseconds);
+unsigned long millis();
+unsigned long micros();
+
+/**
+ * @brief Serial port replacement that prints to the host's standard output.
+ */
+class HardwareSerial {
+public:
+  void begin(unsigned long baudRate) {}
+  void end() {}
+  void flush();
+
+  size_t print(const char* text);
+  size_t print(const __FlashStringHelper* text) {
+    return print(reinterpret_cast<const char*>(text));
+  }
+  size_t print(char character);
+  size_t print(int number, int base = DEC);
+  size_t print(unsigned int number, int base = DEC);
+  size_t print(long number, int base = DEC);
+  size_t print(unsigned long number, int base = DEC);
+  size_t print(long long number, int base = DEC);
+  size_t print(unsigned long long number, int base = DEC);
+  size_t print(double number, int digits = 2);
+
+  size_t println();
+  size_t println(const char* text);
+  size_t println(const __FlashStringHelper* text) {
+    return println(reinterpret_cast<const char*>(text));
+  }
+  size_t println(char character);
+  size_t println(int number, int base = DEC);
+  size_t println(unsigned int number, int base = DEC);
+  size_t println(long number, int base = DEC);
+  size_t println(unsigned long number, int base = DEC);
+  size_t println(long long number, int base = DEC);
+  size_t println(unsigned long long number, int base = DEC);
+  size_t println(double number, int digits = 2);
+
+  operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,29 @@
+/**
+ * @file EEPROM.h
+ * @brief Host stand-in for the EEPROM library of the AVR core, the 1 KByte
+ *    internal EEPROM of the ATmega328. Only built for the [env:native]
+ *    target.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * The bytes live in host memory, erased (0xFF) at start up like a new chip,
+ * and every byte actually written is charged the 3.3 ms write time of the
+ * ATmega328 on the virtual clock.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class EEPROMClass {
+public:
+  uint8_t read(int address);
+  void write(int address, uint8_t value);
+
+  // Write only if the byte differs, which saves the write time and wear.
+  void update(int address, uint8_t value);
+
+  uint16_t length() { return 1024; }
+};
+
+extern EEPROMClass EEPROM;
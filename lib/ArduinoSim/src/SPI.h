@@ -0,0 +1,59 @@
+/**
+ * @file SPI.h
+ * @brief Host stand-in for the Arduino SPI library. Only built for the
+ *    [env:native] target.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * Every SPIClass instance talks to the same simulated bus, in the same way
+ * every memory on the breakout board shares the clock, input and output
+ * lines. So SPI and an hspi object declared by a sketch are the same wires.
+ *
+ * Transfers are delivered byte by byte to whichever simulated chip has its
+ * chip select pin at LOW (see sim_bus.h).
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+
+// ESP32 style bus identifiers, accepted and ignored.
+#define FSPI 1
+#define HSPI 2
+#define VSPI 3
+
+class SPISettings {
+public:
+  SPISettings() : clock(4000000), bitOrder(MSBFIRST), dataMode(SPI_MODE0) {}
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode)
+      : clock(clock), bitOrder(bitOrder), dataMode(dataMode) {}
+
+  uint32_t clock;
+  uint8_t bitOrder;
+  uint8_t dataMode;
+};
+
+class SPIClass {
+public:
+  SPIClass(uint8_t busNumber = 0) {}
+
+  void begin() {}
+  void end() {}
+
+  void beginTransaction(SPISettings settings);
+  void endTransaction();
+
+  uint8_t transfer(uint8_t data);
+  uint16_t transfer16(uint16_t data);
+  void transfer(void* buffer, size_t count);
+};
+
+extern SPIClass SPI;
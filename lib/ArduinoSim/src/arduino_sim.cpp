@@ -0,0 +1,168 @@
+#include "./Arduino.h"
+#include "./EEPROM.h"
+#include "./SPI.h"
+#include "./sim_bus.h"
+
+#include <stdio.h>
+
+HardwareSerial Serial;
+SPIClass SPI;
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  simBus.pinWrite(pin, value);
+}
+
+void simPortWrite(uint8_t pin, uint8_t value) {
+  simBus.portWrite(pin, value);
+}
+
+uint8_t simBitBangTransfer(uint8_t mosi, uint8_t lanes) {
+  return simBus.transferLanes(mosi, lanes, simBus.costModel().bitBangCycleNanos,
+      simBus.costModel().bitBangByteOverheadNanos);
+}
+
+uint8_t simQspiTransfer(uint8_t mosi, uint8_t lanes, uint32_t clockHz) {
+  return simBus.transferLanes(mosi, lanes, 1000000000ul / clockHz,
+      simBus.costModel().qspiByteOverheadNanos);
+}
+
+int digitalRead(uint8_t pin) {
+  return simBus.pinRead(pin);
+}
+
+void delay(unsigned long milliseconds) {
+  simBus.advance(milliseconds * 1000000ull);
+}
+
+void delayMicroseconds(unsigned int microseconds) {
+  simBus.advance(microseconds * 1000ull);
+}
+
+unsigned long millis() {
+  return simBus.nowNanos() / 1000000ull;
+}
+
+unsigned long micros() {
+  return simBus.nowNanos() / 1000ull;
+}
+
+void SPIClass::beginTransaction(SPISettings settings) {
+  simBus.beginTransaction(settings.clock);
+}
+
+void SPIClass::endTransaction() {
+  simBus.endTransaction();
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+  return simBus.transfer(data);
+}
+
+// Most significant byte first, like the AVR core with MSBFIRST.
+uint16_t SPIClass::transfer16(uint16_t data) {
+  uint16_t high = simBus.transfer((uint8_t)(data >> 8));
+  uint16_t low = simBus.transfer((uint8_t)data);
+  return (high << 8) | low;
+}
+
+// The received bytes replace the sent ones, like the AVR core.
+void SPIClass::transfer(void* buffer, size_t count) {
+  uint8_t* bytes = (uint8_t*)buffer;
+  for (size_t i = 0; i < count; ++i) {
+    bytes[i] = simBus.transfer(bytes[i]);
+  }
+}
+
+EEPROMClass EEPROM;
+
+namespace {
+
+uint8_t internalEeprom[1024];
+bool internalEepromErased = false;
+
+const uint64_t kInternalEepromWriteNanos = 3300000;
+
+uint8_t& internalEepromByte(int address) {
+  if (!internalEepromErased) {
+    memset(internalEeprom, 0xFF, sizeof(internalEeprom));
+    internalEepromErased = true;
+  }
+  return internalEeprom[address & 0x3FF];
+}
+
+} // namespace
+
+uint8_t EEPROMClass::read(int address) {
+  return internalEepromByte(address);
+}
+
+void EEPROMClass::write(int address, uint8_t value) {
+  internalEepromByte(address) = value;
+  simBus.advance(kInternalEepromWriteNanos);
+}
+
+void EEPROMClass::update(int address, uint8_t value) {
+  if (read(address) != value) {
+    write(address, value);
+  }
+}
+
+namespace {
+
+const char* formatFor(int base, bool isSigned) {
+  switch (base) {
+    case HEX: return "%llX";
+    case OCT: return "%llo";
+    default: return isSigned ? "%lld" : "%llu";
+  }
+}
+
+size_t printSigned(long long number, int base) {
+  if (base == BIN) {
+    return 0;
+  }
+  return printf(formatFor(base, true), number);
+}
+
+size_t printUnsigned(unsigned long long number, int base) {
+  if (base == BIN) {
+    char digits[65];
+    int length = 0;
+    do {
+      digits[length++] = '0' + (number & 1);
+      number >>= 1;
+    } while (number != 0);
+    for (int i = length - 1; i >= 0; --i) {
+      putchar(digits[i]);
+    }
+    return length;
+  }
+  return printf(formatFor(base, false), number);
+}
+
+} // namespace
+
+void HardwareSerial::flush() { fflush(stdout); }
+
+size_t HardwareSerial::print(const char* text) { return printf("%s", text); }
+size_t HardwareSerial::print(char character) { return putchar(character) != EOF; }
+size_t HardwareSerial::print(int number, int base) { return printSigned(number, base); }
+size_t HardwareSerial::print(unsigned int number, int base) { return printUnsigned(number, base); }
+size_t HardwareSerial::print(long number, int base) { return printSigned(number, base); }
+size_t HardwareSerial::print(unsigned long number, int base) { return printUnsigned(number, base); }
+size_t HardwareSerial::print(long long number, int base) { return printSigned(number, base); }
+size_t HardwareSerial::print(unsigned long long number, int base) { return printUnsigned(number, base); }
+size_t HardwareSerial::print(double number, int digits) { return printf("%.*f", digits, number); }
+
+size_t HardwareSerial::println() { return print('\n'); }
+size_t HardwareSerial::println(const char* text) { return print(text) + println(); }
+size_t HardwareSerial::println(char character) { return print(character) + println(); }
+size_t HardwareSerial::println(int number, int base) { return print(number, base) + println(); }
+size_t HardwareSerial::println(unsigned int number, int base) { return print(number, base) + println(); }
+size_t HardwareSerial::println(long number, int base) { return print(number, base) + println(); }
+size_t HardwareSerial::println(unsigned long number, int base) { return print(number, base) + println(); }
+size_t HardwareSerial::println(long long number, int base) { return print(number, base) + println(); }
+size_t HardwareSerial::println(unsigned long long number, int base) { return print(number, base) + println(); }
+size_t HardwareSerial::println(double number, int digits) { return print(number, digits) + println(); }
@@ -0,0 +1,205 @@
+#include "./sim_bus.h"
+
+#include <stdio.h>
+
+SimBus simBus;
+
+SimCounters SimCounters::operator-(const SimCounters& other) const {
+  SimCounters difference;
+  difference.sckCycles = sckCycles - other.sckCycles;
+  difference.bytes = bytes - other.bytes;
+  difference.chipSelectToggles = chipSelectToggles - other.chipSelectToggles;
+  difference.transactions = transactions - other.transactions;
+  difference.busNanos = busNanos - other.busNanos;
+  difference.busyNanos = busyNanos - other.busyNanos;
+  return difference;
+}
+
+SimCounters& SimCounters::operator+=(const SimCounters& other) {
+  sckCycles += other.sckCycles;
+  bytes += other.bytes;
+  chipSelectToggles += other.chipSelectToggles;
+  transactions += other.transactions;
+  busNanos += other.busNanos;
+  busyNanos += other.busyNanos;
+  return *this;
+}
+
+SimDevice::SimDevice(const char* name, uint8_t chipSelectPin)
+    : name_(name), chipSelectPin_(chipSelectPin) {
+  simBus.attach(this);
+}
+
+SimDevice::~SimDevice() {
+  simBus.detach(this);
+}
+
+bool SimDevice::isBusy() const {
+  return simBus.nowNanos() < busyUntilNanos_;
+}
+
+void SimDevice::startBusy(uint64_t nanos) {
+  busyUntilNanos_ = simBus.nowNanos() + nanos;
+  counters_.busyNanos += nanos;
+  simBus.counters_.busyNanos += nanos;
+}
+
+uint64_t SimDevice::nowNanos() const {
+  return simBus.nowNanos();
+}
+
+SimBus::SimBus() : clockHz_(effectiveClock(4000000)) {
+  for (uint8_t i = 0; i < kMaxPins; ++i) {
+    pinLevels_[i] = 1;
+  }
+}
+
+void SimBus::attach(SimDevice* device) {
+  if (deviceCount_ >= kMaxDevices) {
+    fprintf(stderr, "SimBus: too many devices, %s not attached.\n",
+        device->name());
+    return;
+  }
+  devices_[deviceCount_++] = device;
+}
+
+void SimBus::detach(SimDevice* device) {
+  for (uint8_t i = 0; i < deviceCount_; ++i) {
+    if (devices_[i] == device) {
+      devices_[i] = devices_[--deviceCount_];
+      return;
+    }
+  }
+}
+
+void SimBus::advance(uint64_t nanos) {
+  nowNanos_ += nanos;
+}
+
+void SimBus::pinWrite(uint8_t pin, uint8_t level) {
+  setPin(pin, level, costModel_.digitalWriteNanos);
+}
+
+void SimBus::portWrite(uint8_t pin, uint8_t level) {
+  setPin(pin, level, costModel_.portWriteNanos);
+}
+
+/**
+ * Only edges reach the chips: writing LOW to a pin that is already LOW does
+ * not start a new instruction, the same as on the real chip select line.
+ */
+void SimBus::setPin(uint8_t pin, uint8_t level, uint32_t costNanos) {
+  advance(costNanos);
+  counters_.busNanos += costNanos;
+  if (pin >= kMaxPins) {
+    return;
+  }
+  level = level ? 1 : 0;
+  const bool isEdge = pinLevels_[pin] != level;
+  pinLevels_[pin] = level;
+  for (uint8_t i = 0; i < deviceCount_; ++i) {
+    SimDevice* device = devices_[i];
+    if (device->chipSelectPin_ != pin) {
+      continue;
+    }
+    device->counters_.busNanos += costNanos;
+    if (!isEdge) {
+      continue;
+    }
+    ++device->counters_.chipSelectToggles;
+    ++counters_.chipSelectToggles;
+    if (level == 0) {
+      device->select();
+    } else {
+      device->deselect();
+    }
+  }
+}
+
+int SimBus::pinRead(uint8_t pin) const {
+  if (pin >= kMaxPins) {
+    return 0;
+  }
+  return pinLevels_[pin];
+}
+
+void SimBus::beginTransaction(uint32_t requestedClockHz) {
+  advance(costModel_.beginTransactionNanos);
+  counters_.busNanos += costModel_.beginTransactionNanos;
+  clockHz_ = effectiveClock(requestedClockHz);
+  ++counters_.transactions;
+}
+
+void SimBus::endTransaction() {
+  advance(costModel_.endTransactionNanos);
+  counters_.busNanos += costModel_.endTransactionNanos;
+}
+
+/**
+ * Outputs of all selected chips are ANDed together, which is what two chips
+ * fighting over the output line tend to look like. Nobody selected reads as
+ * 0xFF because of the pull-up.
+ */
+uint8_t SimBus::transfer(uint8_t mosi) {
+  const uint64_t byteNanos = 8ull * 1000000000ull / clockHz_ +
+      costModel_.byteOverheadNanos;
+  return exchangeSelected(mosi, 8, byteNanos);
+}
+
+uint8_t SimBus::transferLanes(uint8_t mosi, uint8_t lanes, uint32_t cycleNanos,
+    uint32_t byteOverheadNanos) {
+  const uint32_t cycles = 8 / lanes;
+  return exchangeSelected(mosi, cycles,
+      (uint64_t)cycles * cycleNanos + byteOverheadNanos);
+}
+
+uint8_t SimBus::exchangeSelected(uint8_t mosi, uint32_t cycles,
+    uint64_t byteNanos) {
+  uint8_t miso = 0xFF;
+  uint8_t selectedDevices = 0;
+  for (uint8_t i = 0; i < deviceCount_; ++i) {
+    SimDevice* device = devices_[i];
+    if (pinLevels_[device->chipSelectPin_] != 0 || device->isHeld()) {
+      continue;
+    }
+    ++selectedDevices;
+    miso &= device->exchange(mosi);
+    device->counters_.sckCycles += cycles;
+    ++device->counters_.bytes;
+    device->counters_.busNanos += byteNanos;
+  }
+  if (selectedDevices > 1) {
+    ++contentions_;
+  }
+  counters_.sckCycles += cycles;
+  ++counters_.bytes;
+  counters_.busNanos += byteNanos;
+  advance(byteNanos);
+  return miso;
+}
+
+uint32_t SimBus::effectiveClock(uint32_t requestedClockHz) const {
+  if (costModel_.cpuHz == 0) {
+    return requestedClockHz < costModel_.maxSpiClockHz ?
+        requestedClockHz : costModel_.maxSpiClockHz;
+  }
+  uint32_t clockHz = costModel_.cpuHz / 2;
+  while (clockHz > requestedClockHz && clockHz > costModel_.cpuHz / 128) {
+    clockHz /= 2;
+  }
+  return clockHz < costModel_.maxSpiClockHz ? clockHz :
+      costModel_.maxSpiClockHz;
+}
+
+void printSimCountersHeader() {
+  printf("%-40s %12s %8s %8s %12s %12s\n", "operation", "SCK cycles",
+      "CS tog.", "trans.", "bus us", "busy us");
+}
+
+void printSimCounters(const char* label, const SimCounters& counters) {
+  printf("%-40s %12llu %8lu %8lu %12.1f %12.1f\n", label,
+      (unsigned long long)counters.sckCycles,
+      (unsigned long)counters.chipSelectToggles,
+      (unsigned long)counters.transactions,
+      counters.busNanos / 1000.0, counters.busyNanos / 1000.0);
+}
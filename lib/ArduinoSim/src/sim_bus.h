@@ -0,0 +1,194 @@
+/**
+ * @file sim_bus.h
+ * @brief Simulated SPI bus shared by every simulated memory chip, with a
+ *    virtual clock and bus cost counters.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * The simulator replaces the wires between the Arduino and the breakout
+ * board. Arduino.h and SPI.h forward every pin write, delay and SPI transfer
+ * to the single SimBus object, which:
+ *
+ *  - keeps a virtual clock in nanoseconds (what millis() and micros() read),
+ *  - routes each transferred byte to the chips whose chip select is LOW,
+ *  - charges every operation with its time on an ATmega328 at 16 MHz
+ *    (SimCostModel), and
+ *  - counts SCK cycles, chip select toggles, transactions, bus time and chip
+ *    busy time, both in total and for every attached chip (SimCounters).
+ *
+ * Taking a SimCounters snapshot before and after a driver call and
+ * subtracting them gives the bus cost of that call.
+ *
+ * The chip models (sim_eeprom.h, sim_serial_ram.h, sim_nand_flash.h,
+ * sim_nor_flash.h) derive from SimDevice and decode the real opcodes of each
+ * memory, so drivers are exercised exactly as on the breakout board.
+ *
+ * NOTE: every chip needs its own chip select pin in the simulator, except
+ * the dies of the NOR Flash, which take turns through their HOLD# pins. The
+ * [env:native] target of platformio.ini gives them distinct pins through
+ * build flags.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct SimCounters {
+  uint64_t sckCycles = 0;
+  uint64_t bytes = 0;
+  uint32_t chipSelectToggles = 0; // both edges, one select + deselect = 2
+  uint32_t transactions = 0;      // beginTransaction() calls
+  uint64_t busNanos = 0;          // bus time plus MCU overhead around it
+  uint64_t busyNanos = 0;         // time the chips spent in WIP/BUSY
+
+  SimCounters operator-(const SimCounters& other) const;
+  SimCounters& operator+=(const SimCounters& other);
+};
+
+/**
+ * @brief What each operation costs in virtual time. Defaults describe an
+ *    Arduino Nano (ATmega328 at 16 MHz) using the Arduino core.
+ *
+ * The ATmega328 SPI clock is the CPU clock divided by 2, 4, ... 128, so the
+ * fastest divider not above the requested clock is used, the same way
+ * SPISettings does it on the target. Setting cpuHz to 0 disables the divider
+ * and uses min(requested, maxSpiClockHz) instead.
+ */
+struct SimCostModel {
+  uint32_t cpuHz = 16000000;
+  uint32_t maxSpiClockHz = 8000000;
+  uint32_t byteOverheadNanos = 375;    // load SPDR, poll SPIF, read SPDR
+  uint32_t digitalWriteNanos = 3500;   // pin lookup tables + interrupt guard
+  uint32_t portWriteNanos = 125;       // sbi/cbi on the PORTx register
+  uint32_t beginTransactionNanos = 1000;
+  uint32_t endTransactionNanos = 500;
+  // Bit-banged lanes on PORTC (see spi_lanes.h): out/in of the port and
+  // the SCK pulse take about 8 CPU cycles per clock, plus the shifts that
+  // split or assemble each byte.
+  uint32_t bitBangCycleNanos = 500;
+  uint32_t bitBangByteOverheadNanos = 250;
+  // QSPI peripheral of a faster MCU: its FIFO is refilled by DMA, so only
+  // a little per byte is added to the clock cycles.
+  uint32_t qspiByteOverheadNanos = 10;
+};
+
+class SimBus;
+
+/**
+ * @brief One chip on the simulated bus.
+ *
+ * A device is attached to the bus on construction and detached on
+ * destruction. select() and deselect() are called on the chip select edges
+ * and exchange() once per byte shifted while selected.
+ */
+class SimDevice {
+public:
+  SimDevice(const char* name, uint8_t chipSelectPin);
+  virtual ~SimDevice();
+
+  const char* name() const { return name_; }
+  uint8_t chipSelectPin() const { return chipSelectPin_; }
+  const SimCounters& counters() const { return counters_; }
+
+  /**
+   * @return true while an internal operation (write cycle, program, erase,
+   *    page load...) started by the chip has not finished yet.
+   */
+  bool isBusy() const;
+
+  /**
+   * @return true while the chip ignores the bus although selected, as a
+   *    die whose HOLD# is LOW (see sim_nor_flash.h). It neither sees the
+   *    bytes nor drives its output then.
+   */
+  virtual bool isHeld() const { return false; }
+
+  // CS falling edge.
+  virtual void select() {}
+  // One byte on the bus. Returns what the chip drives on its output line.
+  virtual uint8_t exchange(uint8_t mosi) = 0;
+  // CS rising edge.
+  virtual void deselect() {}
+
+protected:
+  // Mark the chip busy for the given time starting now.
+  void startBusy(uint64_t nanos);
+  uint64_t nowNanos() const;
+
+private:
+  friend class SimBus;
+
+  const char* name_;
+  uint8_t chipSelectPin_;
+  SimCounters counters_;
+  uint64_t busyUntilNanos_ = 0;
+};
+
+class SimBus {
+public:
+  static const uint8_t kMaxDevices = 8;
+  static const uint8_t kMaxPins = 64;
+
+  SimBus();
+
+  void attach(SimDevice* device);
+  void detach(SimDevice* device);
+
+  SimCostModel& costModel() { return costModel_; }
+
+  uint64_t nowNanos() const { return nowNanos_; }
+  void advance(uint64_t nanos);
+
+  void pinWrite(uint8_t pin, uint8_t level);
+  // Same as pinWrite() but charged as a direct port write.
+  void portWrite(uint8_t pin, uint8_t level);
+  int pinRead(uint8_t pin) const;
+
+  void beginTransaction(uint32_t requestedClockHz);
+  void endTransaction();
+  uint8_t transfer(uint8_t mosi);
+
+  /**
+   * @brief One byte over 1, 2 or 4 data lines, 8 / lanes clock cycles of
+   *    cycleNanos each, for the buses that are not the SPI peripheral (see
+   *    spi_lanes.h). The chips still see a byte: the opcode tells them how
+   *    many lines it uses. Double transfer rate on 4 lines is passed as 8,
+   *    a clock per byte.
+   */
+  uint8_t transferLanes(uint8_t mosi, uint8_t lanes, uint32_t cycleNanos,
+      uint32_t byteOverheadNanos);
+
+  // SCK frequency actually used by the current transaction.
+  uint32_t clockHz() const { return clockHz_; }
+
+  const SimCounters& counters() const { return counters_; }
+
+  // Bytes transferred while more than one chip was selected and not held.
+  uint32_t contentions() const { return contentions_; }
+
+private:
+  friend class SimDevice;
+
+  uint32_t effectiveClock(uint32_t requestedClockHz) const;
+  uint8_t exchangeSelected(uint8_t mosi, uint32_t cycles, uint64_t byteNanos);
+  void setPin(uint8_t pin, uint8_t level, uint32_t costNanos);
+
+  SimCostModel costModel_;
+  SimDevice* devices_[kMaxDevices];
+  uint8_t deviceCount_ = 0;
+  uint8_t pinLevels_[kMaxPins];
+  uint64_t nowNanos_ = 0;
+  uint32_t clockHz_;
+  SimCounters counters_;
+  uint32_t contentions_ = 0;
+};
+
+extern SimBus simBus;
+
+/**
+ * @brief Print a counter delta as a single line:
+ *    label | SCK cycles | CS toggles | transactions | bus us | busy us
+ */
+void printSimCounters(const char* label, const SimCounters& counters);
+void printSimCountersHeader();
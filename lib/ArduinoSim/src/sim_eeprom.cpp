@@ -0,0 +1,163 @@
+#include "./sim_eeprom.h"
+
+#include <string.h>
+
+namespace {
+
+const uint8_t kWriteEnable = 0x06;
+const uint8_t kWriteDisable = 0x04;
+const uint8_t kReadStatus = 0x05;
+const uint8_t kWriteStatus = 0x01;
+const uint8_t kRead = 0x03;
+const uint8_t kWrite = 0x02;
+const uint8_t kReadIdentification = 0x83;
+const uint8_t kWriteIdentification = 0x82;
+
+const uint8_t kWip = 0x01;
+const uint8_t kWel = 0x02;
+const uint8_t kWritableStatusBits = 0x8C; // SRWD, BP1, BP0
+
+} // namespace
+
+SimEeprom::SimEeprom(uint8_t chipSelectPin)
+    : SimDevice("EEPROM M95M02", chipSelectPin), array_(kCapacity, 0xFF) {
+  memset(identificationPage_, 0xFF, sizeof(identificationPage_));
+  memset(latched_, 0, sizeof(latched_));
+  identificationPage_[0] = 0x20; // ST manufacturer code
+  identificationPage_[1] = 0x00; // SPI family code
+  identificationPage_[2] = 0x12; // 2 Mbit density code
+}
+
+uint8_t SimEeprom::statusRegister() const {
+  uint8_t status = protectionBits_;
+  if (isBusy()) {
+    status |= kWip | kWel;
+  } else if (writeEnabled_) {
+    status |= kWel;
+  }
+  return status;
+}
+
+bool SimEeprom::isProtected(uint32_t address) const {
+  switch ((protectionBits_ >> 2) & 0x03) {
+    case 1: return address >= 0x30000;
+    case 2: return address >= 0x20000;
+    case 3: return true;
+    default: return false;
+  }
+}
+
+void SimEeprom::select() {
+  opcode_ = 0;
+  index_ = 0;
+  address_ = 0;
+  anyLatched_ = false;
+  memset(latched_, 0, sizeof(latched_));
+  statusWritePending_ = false;
+}
+
+uint8_t SimEeprom::exchange(uint8_t mosi) {
+  const uint32_t index = index_++;
+  if (index == 0) {
+    opcode_ = mosi;
+    return 0xFF;
+  }
+  if (opcode_ == kReadStatus) {
+    return statusRegister();
+  }
+  if (isBusy()) {
+    return 0xFF; // only RDSR is decoded during a write cycle
+  }
+  switch (opcode_) {
+    case kWriteStatus:
+      if (index == 1) {
+        pendingStatus_ = mosi;
+        statusWritePending_ = true;
+      }
+      return 0xFF;
+    case kRead:
+    case kReadIdentification:
+    case kWrite:
+    case kWriteIdentification:
+      if (index <= 3) {
+        address_ = ((address_ << 8) | mosi) & (kCapacity - 1);
+        return 0xFF;
+      }
+      break;
+    default:
+      return 0xFF;
+  }
+  switch (opcode_) {
+    case kRead: {
+      const uint8_t output = array_[address_];
+      address_ = (address_ + 1) & (kCapacity - 1);
+      return output;
+    }
+    case kReadIdentification: {
+      const uint8_t output = identificationPage_[address_ % kPageSize];
+      address_ = (address_ & ~(uint32_t)(kPageSize - 1)) |
+          ((address_ + 1) % kPageSize);
+      return output;
+    }
+    default: {
+      // WRITE and WRID roll over inside the page.
+      const uint16_t offset = address_ % kPageSize;
+      pageLatch_[offset] = mosi;
+      latched_[offset] = true;
+      anyLatched_ = true;
+      address_ = (address_ & ~(uint32_t)(kPageSize - 1)) | ((offset + 1) % kPageSize);
+      return 0xFF;
+    }
+  }
+}
+
+void SimEeprom::deselect() {
+  if (isBusy()) {
+    if (opcode_ != kReadStatus && opcode_ != 0) {
+      ++rejectedWrites_;
+    }
+    return;
+  }
+  switch (opcode_) {
+    case kWriteEnable:
+      writeEnabled_ = true;
+      return;
+    case kWriteDisable:
+      writeEnabled_ = false;
+      return;
+    case kWriteStatus:
+      if (!statusWritePending_) {
+        return;
+      }
+      if (!writeEnabled_) {
+        ++rejectedWrites_;
+        return;
+      }
+      protectionBits_ = pendingStatus_ & kWritableStatusBits;
+      writeEnabled_ = false;
+      startBusy(writeCycleNanos_);
+      return;
+    case kWrite:
+    case kWriteIdentification:
+      break;
+    default:
+      return;
+  }
+  if (!anyLatched_) {
+    return;
+  }
+  if (!writeEnabled_ || isProtected(address_)) {
+    ++rejectedWrites_;
+    return;
+  }
+  const uint32_t pageBase = address_ & ~(uint32_t)(kPageSize - 1);
+  uint8_t* destination = opcode_ == kWrite ?
+      &array_[pageBase] : identificationPage_;
+  for (uint16_t i = 0; i < kPageSize; ++i) {
+    if (latched_[i]) {
+      destination[i] = pageLatch_[i];
+    }
+  }
+  writeEnabled_ = false;
+  startBusy(writeCycleNanos_);
+}
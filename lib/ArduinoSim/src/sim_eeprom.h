@@ -0,0 +1,64 @@
+/**
+ * @file sim_eeprom.h
+ * @brief Behavioural model of the M95M02 SPI EEPROM (see memory_eeprom.h).
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * Decoded instructions: WREN, WRDI, RDSR, WRSR, READ, WRITE, RDID and WRID.
+ *
+ * WRITE bytes go to a page latch, wrapping inside the 256 byte page, and are
+ * committed to the array on the chip select rising edge, which starts a write
+ * cycle. While the write cycle lasts WIP = 1 and only RDSR is answered;
+ * WEL goes back to 0 once it finishes. Writes are ignored if WEL = 0 or the
+ * address falls inside the BP1/BP0 protected area.
+ */
+
+#pragma once
+
+#include "./sim_bus.h"
+
+#include <stdint.h>
+#include <vector>
+
+class SimEeprom : public SimDevice {
+public:
+  static const uint32_t kCapacity = 262144;
+  static const uint16_t kPageSize = 256;
+
+  SimEeprom(uint8_t chipSelectPin);
+
+  // Maximum tW of the datasheet.
+  void setWriteCycleNanos(uint64_t nanos) { writeCycleNanos_ = nanos; }
+
+  // Direct array access for the host, no bus cost.
+  uint8_t peek(uint32_t address) const { return array_[address % kCapacity]; }
+  void poke(uint32_t address, uint8_t value) { array_[address % kCapacity] = value; }
+
+  // Write instructions received while WEL = 0 or while busy.
+  uint32_t rejectedWrites() const { return rejectedWrites_; }
+
+  void select() override;
+  uint8_t exchange(uint8_t mosi) override;
+  void deselect() override;
+
+private:
+  uint8_t statusRegister() const;
+  bool isProtected(uint32_t address) const;
+
+  std::vector<uint8_t> array_;
+  uint8_t identificationPage_[kPageSize];
+  uint8_t pageLatch_[kPageSize];
+  bool latched_[kPageSize];
+  bool anyLatched_ = false;
+
+  uint64_t writeCycleNanos_ = 5000000;
+  bool writeEnabled_ = false;
+  uint8_t protectionBits_ = 0; // SRWD, BP1, BP0 as in the status register
+  uint8_t pendingStatus_ = 0;
+  bool statusWritePending_ = false;
+
+  uint8_t opcode_ = 0;
+  uint32_t index_ = 0;
+  uint32_t address_ = 0;
+  uint32_t rejectedWrites_ = 0;
+};
@@ -0,0 +1,451 @@
+#include "./sim_nand_flash.h"
+
+#include <string.h>
+
+namespace {
+
+const uint8_t kWriteEnable = 0x06;
+const uint8_t kWriteDisable = 0x04;
+const uint8_t kDeviceReset = 0xFF;
+const uint8_t kJedecId = 0x9F;
+const uint8_t kReadStatus = 0x0F;
+const uint8_t kReadStatusAlternative = 0x05;
+const uint8_t kWriteStatus = 0x1F;
+const uint8_t kWriteStatusAlternative = 0x01;
+const uint8_t kPageDataRead = 0x13;
+const uint8_t kRead = 0x03;
+const uint8_t kFastRead = 0x0B;
+const uint8_t kFastReadDualOutput = 0x3B;
+const uint8_t kFastReadQuadOutput = 0x6B;
+const uint8_t kFastReadDualIo = 0xBB;
+const uint8_t kFastReadQuadIo = 0xEB;
+const uint8_t kLoadProgramData = 0x02;
+const uint8_t kRandomLoadProgramData = 0x84;
+const uint8_t kProgramExecute = 0x10;
+const uint8_t kBlockErase = 0xD8;
+
+const uint8_t kProtectionRegister = 0xA0;
+const uint8_t kConfigurationRegister = 0xB0;
+const uint8_t kStatusRegister = 0xC0;
+
+const uint8_t kProtectionRegisterAtPowerUp = 0x7C; // BP3..BP0 = 1111, TB = 1
+const uint8_t kConfigurationRegisterAtPowerUp = 0x18; // ECC-E = 1, BUF = 1
+const uint8_t kWritableConfigurationBits = 0x58; // OTP-E, ECC-E, BUF
+
+const uint8_t kOtpEnabled = 0x40;
+const uint8_t kEccEnabled = 0x10;
+const uint8_t kBufferMode = 0x08;
+
+const uint8_t kEccCorrected = 0x01;
+const uint8_t kEccUncorrectable = 0x02;
+const uint8_t kEccUncorrectableManyPages = 0x03;
+
+const uint8_t kJedecBytes[] = {0xEF, 0xAA, 0x21};
+
+const uint8_t kMaxPartialPrograms = 4;
+
+const uint8_t kUniqueId[16] = {0x57, 0x32, 0x35, 0x4E, 0x01, 0x47, 0x56, 0x10,
+    0x23, 0x09, 0x12, 0xA5, 0x3C, 0x81, 0x7E, 0x44};
+
+void putLittleEndian(uint8_t* bytes, uint32_t value, uint8_t size) {
+  for (uint8_t i = 0; i < size; ++i) {
+    bytes[i] = (uint8_t)(value >> (8 * i));
+  }
+}
+
+// ONFI integrity CRC: polynomial 0x8005, initial value 0x4F4E, no
+// reflection, over bytes 0 to 253 of a copy.
+uint16_t onfiCrc(const uint8_t* bytes, uint16_t size) {
+  uint16_t crc = 0x4F4E;
+  for (uint16_t i = 0; i < size; ++i) {
+    crc ^= (uint16_t)bytes[i] << 8;
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x8005) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+/**
+ * The fields of the W25N01GV parameter page (datasheet 8.2.27) the driver
+ * reads, the others are left at 0.
+ */
+void buildParameterPage(uint8_t* copy) {
+  memset(copy, 0, 256);
+  memcpy(copy, "ONFI", 4);
+  memcpy(copy + 32, "WINBOND     ", 12);
+  memcpy(copy + 44, "W25N01GV            ", 20);
+  copy[64] = 0xEF; // JEDEC manufacturer ID
+  putLittleEndian(copy + 80, SimNandFlash::kDataSize, 4);
+  putLittleEndian(copy + 84, SimNandFlash::kPageSize - SimNandFlash::kDataSize, 2);
+  putLittleEndian(copy + 92, SimNandFlash::kPagesPerBlock, 4);
+  putLittleEndian(copy + 96, SimNandFlash::kBlocks, 4);
+  copy[100] = 1; // logical units
+  copy[102] = 1; // bits per cell
+  copy[110] = kMaxPartialPrograms;
+  copy[112] = 1; // bits of ECC correctability
+  putLittleEndian(copy + 254, onfiCrc(copy, 254), 2);
+}
+
+// ECC sectors: 4 x (512 data bytes + 16 spare bytes).
+uint8_t eccSectorOf(uint16_t column) {
+  if (column < SimNandFlash::kDataSize) {
+    return column / 512;
+  }
+  return ((column - SimNandFlash::kDataSize) / 16) % 4;
+}
+
+} // namespace
+
+SimNandFlash::SimNandFlash(uint8_t chipSelectPin)
+    : SimDevice("NAND W25N01GV", chipSelectPin), pages_(kPages),
+      badBlocks_(kBlocks, false) {
+  for (uint8_t i = 0; i < 3; ++i) {
+    buildParameterPage(parameterPage_ + 256 * i);
+  }
+  powerUp();
+}
+
+void SimNandFlash::powerUp() {
+  protectionRegister_ = kProtectionRegisterAtPowerUp;
+  configurationRegister_ = kConfigurationRegisterAtPowerUp;
+  writeEnabled_ = false;
+  programFailed_ = false;
+  eraseFailed_ = false;
+  loadBuffer(0);
+  eccBits_ = 0;
+}
+
+uint8_t SimNandFlash::peek(uint32_t page, uint16_t column) const {
+  const Page& stored = pages_[page % kPages];
+  if (stored.data.empty() || column >= kPageSize) {
+    return 0xFF;
+  }
+  return stored.data[column];
+}
+
+void SimNandFlash::injectBitFlip(uint32_t page, uint16_t column, uint8_t bit) {
+  Page& stored = pages_[page % kPages];
+  stored.flips.push_back((uint16_t)(column % kPageSize) * 8 + (bit & 0x07));
+}
+
+void SimNandFlash::setFactoryBadBlock(uint16_t block) {
+  block %= kBlocks;
+  badBlocks_[block] = true;
+  Page& first = pages_[block * kPagesPerBlock];
+  if (first.data.empty()) {
+    first.data.assign(kPageSize, 0xFF);
+  }
+  first.data[kDataSize] = 0x00;
+}
+
+void SimNandFlash::corruptParameterPage(uint16_t column, uint8_t bit) {
+  parameterPage_[column % 256] ^= (uint8_t)(1 << (bit & 0x07));
+}
+
+uint8_t SimNandFlash::readRegister(uint8_t address) const {
+  switch (address & 0xF0) {
+    case kProtectionRegister:
+      return protectionRegister_;
+    case kConfigurationRegister:
+      return configurationRegister_;
+    case kStatusRegister:
+      return (eccBits_ << 4) | (programFailed_ ? 0x08 : 0) |
+          (eraseFailed_ ? 0x04 : 0) | (writeEnabled_ ? 0x02 : 0) |
+          (isBusy() ? 0x01 : 0);
+    default:
+      return 0xFF;
+  }
+}
+
+void SimNandFlash::writeRegister(uint8_t address, uint8_t value) {
+  switch (address & 0xF0) {
+    case kProtectionRegister:
+      protectionRegister_ = value;
+      break;
+    case kConfigurationRegister:
+      configurationRegister_ = (configurationRegister_ & ~kWritableConfigurationBits) |
+          (value & kWritableConfigurationBits);
+      break;
+    default:
+      break; // SR-3 is read only
+  }
+}
+
+/**
+ * BP3..BP0 = 0 protects nothing, 1 to 7 protect 8 to 512 blocks (doubling)
+ * at the top of the array, or at the bottom if TB = 1, and 8 or more protect
+ * the whole array.
+ */
+bool SimNandFlash::isBlockProtected(uint16_t block) const {
+  const uint8_t protectionBits = (protectionRegister_ >> 3) & 0x0F;
+  if (protectionBits == 0) {
+    return false;
+  }
+  if (protectionBits >= 8) {
+    return true;
+  }
+  const uint16_t protectedBlocks = 8 << (protectionBits - 1);
+  const bool fromBottom = (protectionRegister_ & 0x04) != 0;
+  return fromBottom ? block < protectedBlocks : block >= kBlocks - protectedBlocks;
+}
+
+uint8_t SimNandFlash::loadBuffer(uint32_t page) {
+  loadedPage_ = page % kPages;
+  const Page& stored = pages_[loadedPage_];
+  if (stored.data.empty()) {
+    memset(buffer_, 0xFF, kPageSize);
+  } else {
+    memcpy(buffer_, &stored.data[0], kPageSize);
+  }
+  if (stored.flips.empty()) {
+    return 0;
+  }
+  uint8_t flipsPerSector[4] = {0, 0, 0, 0};
+  for (size_t i = 0; i < stored.flips.size(); ++i) {
+    ++flipsPerSector[eccSectorOf(stored.flips[i] / 8)];
+  }
+  const bool eccEnabled = (configurationRegister_ & kEccEnabled) != 0;
+  bool correctable = true;
+  for (uint8_t i = 0; i < 4; ++i) {
+    correctable = correctable && flipsPerSector[i] <= 1;
+  }
+  if (eccEnabled && correctable) {
+    return kEccCorrected;
+  }
+  for (size_t i = 0; i < stored.flips.size(); ++i) {
+    buffer_[stored.flips[i] / 8] ^= (uint8_t)(1 << (stored.flips[i] % 8));
+  }
+  return eccEnabled ? kEccUncorrectable : 0;
+}
+
+/**
+ * The unique ID page holds the 16 byte ID and its complement 16 times, the
+ * parameter page its 256 bytes 3 times, then both are 0xFF.
+ */
+void SimNandFlash::loadOtpPage(uint32_t page) {
+  memset(buffer_, 0xFF, kPageSize);
+  if (page == 0) {
+    for (uint16_t i = 0; i < 16; ++i) {
+      for (uint8_t j = 0; j < 16; ++j) {
+        buffer_[32 * i + j] = kUniqueId[j];
+        buffer_[32 * i + 16 + j] = (uint8_t)~kUniqueId[j];
+      }
+    }
+  } else if (page == 1) {
+    memcpy(buffer_, parameterPage_, sizeof(parameterPage_));
+  }
+}
+
+void SimNandFlash::executeProgram(uint32_t page) {
+  page %= kPages;
+  programFailed_ = false;
+  if (badBlocks_[page / kPagesPerBlock]) {
+    ++badBlockOperations_;
+    programFailed_ = true;
+    return;
+  }
+  if (isBlockProtected(page / kPagesPerBlock)) {
+    programFailed_ = true;
+    return;
+  }
+  Page& stored = pages_[page];
+  if (stored.data.empty()) {
+    stored.data.assign(kPageSize, 0xFF);
+  }
+  for (uint16_t i = 0; i < kPageSize; ++i) {
+    stored.data[i] &= buffer_[i];
+  }
+  if (++stored.programCount > kMaxPartialPrograms) {
+    ++partialProgramViolations_;
+  }
+  startBusy(timing_.programNanos);
+}
+
+void SimNandFlash::eraseBlock(uint16_t block) {
+  block %= kBlocks;
+  eraseFailed_ = false;
+  if (badBlocks_[block]) {
+    ++badBlockOperations_;
+    eraseFailed_ = true;
+    return;
+  }
+  if (isBlockProtected(block)) {
+    eraseFailed_ = true;
+    return;
+  }
+  for (uint32_t page = block * kPagesPerBlock;
+      page < (uint32_t)(block + 1) * kPagesPerBlock; ++page) {
+    std::vector<uint8_t>().swap(pages_[page].data);
+    pages_[page].flips.clear();
+    pages_[page].programCount = 0;
+  }
+  startBusy(timing_.blockEraseNanos);
+}
+
+/**
+ * In continuous read mode (BUF = 0) the chip moves on to the next page by
+ * itself once the 2048 data bytes of the current one have been output; the
+ * spare area is not output. The ECC bits then describe the whole read.
+ */
+uint8_t SimNandFlash::readOutput() {
+  if (configurationRegister_ & kBufferMode) {
+    return column_ < kPageSize ? buffer_[column_++] : 0xFF;
+  }
+  if (column_ >= kDataSize) {
+    const uint8_t pageEcc = loadBuffer(loadedPage_ + 1);
+    if (pageEcc == kEccUncorrectable) {
+      eccBits_ = eccBits_ >= kEccUncorrectable ?
+          kEccUncorrectableManyPages : kEccUncorrectable;
+    } else if (pageEcc == kEccCorrected && eccBits_ == 0) {
+      eccBits_ = kEccCorrected;
+    }
+    column_ = 0;
+  }
+  return buffer_[column_++];
+}
+
+void SimNandFlash::select() {
+  opcode_ = 0;
+  index_ = 0;
+  argument_ = 0;
+  column_ = 0;
+}
+
+uint8_t SimNandFlash::exchange(uint8_t mosi) {
+  const uint32_t index = index_++;
+  if (index == 0) {
+    opcode_ = mosi;
+    const bool allowedWhileBusy = opcode_ == kReadStatus ||
+        opcode_ == kReadStatusAlternative || opcode_ == kJedecId;
+    if (isBusy() && !allowedWhileBusy) {
+      ++instructionsWhileBusy_;
+      opcode_ = 0;
+    } else if (opcode_ == kLoadProgramData && writeEnabled_) {
+      memset(buffer_, 0xFF, kPageSize);
+    }
+    return 0xFF;
+  }
+  switch (opcode_) {
+    case kReadStatus:
+    case kReadStatusAlternative:
+      if (index == 1) {
+        registerAddress_ = mosi;
+        return 0xFF;
+      }
+      return readRegister(registerAddress_);
+    case kWriteStatus:
+    case kWriteStatusAlternative:
+      if (index == 1) {
+        registerAddress_ = mosi;
+      } else if (index == 2) {
+        writeRegister(registerAddress_, mosi);
+      }
+      return 0xFF;
+    case kJedecId:
+      return index == 1 ? 0xFF : kJedecBytes[(index - 2) % 3];
+    case kPageDataRead:
+    case kProgramExecute:
+    case kBlockErase:
+      if (index >= 2 && index <= 3) {
+        argument_ = (argument_ << 8) | mosi;
+      }
+      return 0xFF;
+    case kFastReadQuadIo:
+      // The column on 4 lines takes a byte time of the bus per byte, and
+      // the 4 dummy clocks on 4 lines two.
+      if (configurationRegister_ & kBufferMode) {
+        if (index <= 2) {
+          column_ = (column_ << 8 | mosi) & 0x0FFF;
+          return 0xFF;
+        }
+        if (index <= 4) {
+          return 0xFF; // dummy
+        }
+      }
+      return readOutput();
+    case kRead:
+    case kFastRead:
+    case kFastReadDualOutput:
+    case kFastReadQuadOutput:
+    case kFastReadDualIo:
+      if (configurationRegister_ & kBufferMode) {
+        if (index <= 2) {
+          column_ = (column_ << 8 | mosi) & 0x0FFF;
+          return 0xFF;
+        }
+        if (index == 3) {
+          return 0xFF; // dummy
+        }
+      } else {
+        if (index <= 3) {
+          column_ = 0;
+          return 0xFF; // dummy
+        }
+      }
+      return readOutput();
+    case kLoadProgramData:
+    case kRandomLoadProgramData:
+      if (!writeEnabled_) {
+        return 0xFF;
+      }
+      if (index <= 2) {
+        column_ = (column_ << 8 | mosi) & 0x0FFF;
+        return 0xFF;
+      }
+      if (column_ < kPageSize) {
+        buffer_[column_++] = mosi;
+      }
+      return 0xFF;
+    default:
+      return 0xFF;
+  }
+}
+
+void SimNandFlash::deselect() {
+  switch (opcode_) {
+    case kWriteEnable:
+      writeEnabled_ = true;
+      break;
+    case kWriteDisable:
+      writeEnabled_ = false;
+      break;
+    case kDeviceReset:
+      powerUp();
+      startBusy(timing_.resetNanos);
+      break;
+    case kPageDataRead:
+      if (index_ < 4) {
+        break;
+      }
+      if (configurationRegister_ & kOtpEnabled) {
+        loadOtpPage(argument_ & 0xFFFF);
+        eccBits_ = 0;
+        startBusy(timing_.pageReadEccNanos);
+        break;
+      }
+      eccBits_ = loadBuffer(argument_ & 0xFFFF);
+      if (badBlocks_[loadedPage_ / kPagesPerBlock]) {
+        ++badBlockOperations_;
+      }
+      startBusy((configurationRegister_ & kEccEnabled) ?
+          timing_.pageReadEccNanos : timing_.pageReadNanos);
+      break;
+    case kProgramExecute:
+      if (index_ < 4 || !writeEnabled_) {
+        break;
+      }
+      executeProgram(argument_ & 0xFFFF);
+      writeEnabled_ = false;
+      break;
+    case kBlockErase:
+      if (index_ < 4 || !writeEnabled_) {
+        break;
+      }
+      eraseBlock((argument_ & 0xFFFF) / kPagesPerBlock);
+      writeEnabled_ = false;
+      break;
+    default:
+      break;
+  }
+}
@@ -0,0 +1,151 @@
+/**
+ * @file sim_nand_flash.h
+ * @brief Behavioural model of the W25N01GV SPI NAND Flash (see
+ *    memory_nand_flash.h).
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * 65536 pages of 2112 bytes (2048 data + 64 spare), 64 pages per block, one
+ * 2112 byte data buffer between the SPI interface and the array.
+ *
+ * Decoded instructions:
+ *  - 0x06 WREN, 0x04 WRDI, 0xFF device reset, 0x9F JEDEC ID,
+ *  - 0x0F/0x05 read status register and 0x1F/0x01 write status register,
+ *    with SR-1, SR-2 and SR-3 at addresses 0xA0, 0xB0 and 0xC0,
+ *  - 0x13 page data read (array to buffer, BUSY for tRD); with OTP-E = 1
+ *    at SR-2 page 0 is the unique ID page and page 1 the parameter page,
+ *    and the OTP pages 2 to 11 are erased,
+ *  - 0x03/0x0B read: with BUF = 1 a 16 bit column address and a dummy byte,
+ *    then the buffer from that column; with BUF = 0 three dummy bytes, then
+ *    the data area of every page from the loaded one onwards,
+ *  - 0x3B/0x6B fast read dual/quad output and 0xBB/0xEB fast read dual/quad
+ *    I/O, with BUF = 1 only: like 0x0B, except that 0xEB takes 2 dummy
+ *    bytes (4 clocks on 4 lines). Bytes move over 2 or 4 lines when the
+ *    driver sends them through SimBus::transferLanes(),
+ *  - 0x02 load program data (buffer reset to 0xFF) and 0x84 random load,
+ *  - 0x10 program execute (buffer to array, BUSY for tPROG) and
+ *  - 0xD8 block erase (BUSY for tBERS).
+ *
+ * Programming only clears bits, like the real array. WEL is required by
+ * loads, program execute and block erase and goes back to 0 after the last
+ * two. SR-1 powers up with every block protected (BP3..BP0 = 1111), so the
+ * protection has to be lifted before writing, and program/erase on protected
+ * blocks set P-FAIL/E-FAIL.
+ *
+ * Radiation upsets can be injected with injectBitFlip(). The internal ECC is
+ * modelled as correcting one bit per 528 byte sector: a page read reports
+ * ECC-1/ECC-0 = 01 and outputs corrected data when every sector has at most
+ * one flipped bit, and 10 (11 for several pages in continuous read) with the
+ * raw data otherwise. With ECC-E = 0 the raw bits are output.
+ *
+ * Factory bad blocks can be added with setFactoryBadBlock(): their first
+ * page holds 0x00 at column 2048, the bad block marker, and programs and
+ * erases on them fail with P-FAIL/E-FAIL.
+ *
+ * Pages are allocated on first program, so an erased page costs no host
+ * memory.
+ */
+
+#pragma once
+
+#include "./sim_bus.h"
+
+#include <stdint.h>
+#include <vector>
+
+struct SimNandTiming {
+  uint64_t pageReadNanos = 25000;       // tRD1, ECC disabled
+  uint64_t pageReadEccNanos = 60000;    // tRD2, ECC enabled
+  uint64_t programNanos = 250000;       // tPP typical
+  uint64_t blockEraseNanos = 2000000;   // tBE typical
+  uint64_t resetNanos = 5000;           // tRST while idle
+};
+
+class SimNandFlash : public SimDevice {
+public:
+  static const uint32_t kPages = 65536;
+  static const uint16_t kPageSize = 2112;
+  static const uint16_t kDataSize = 2048;
+  static const uint8_t kPagesPerBlock = 64;
+  static const uint16_t kBlocks = 1024;
+
+  SimNandFlash(uint8_t chipSelectPin);
+
+  SimNandTiming& timing() { return timing_; }
+
+  // Direct array access for the host, no bus cost and no ECC.
+  uint8_t peek(uint32_t page, uint16_t column) const;
+
+  /**
+   * @brief Flip one stored bit of a page, as a radiation upset would. The
+   *    flip stays until the page is erased.
+   */
+  void injectBitFlip(uint32_t page, uint16_t column, uint8_t bit);
+
+  /**
+   * @brief Make a block factory bad, with its bad block marker, as shipped.
+   */
+  void setFactoryBadBlock(uint16_t block);
+
+  /**
+   * @brief Flip one bit of the first of the 3 copies of the parameter page,
+   *    so that its CRC no longer matches.
+   */
+  void corruptParameterPage(uint16_t column, uint8_t bit);
+
+  // Page data reads, program executes and block erases on bad blocks.
+  uint32_t badBlockOperations() const { return badBlockOperations_; }
+
+  // Program executes on a page beyond the 4 partial programs allowed.
+  uint32_t partialProgramViolations() const { return partialProgramViolations_; }
+  // Instructions other than status and JEDEC ID reads sent while BUSY.
+  uint32_t instructionsWhileBusy() const { return instructionsWhileBusy_; }
+
+  void select() override;
+  uint8_t exchange(uint8_t mosi) override;
+  void deselect() override;
+
+private:
+  struct Page {
+    std::vector<uint8_t> data;      // empty while erased
+    std::vector<uint16_t> flips;    // bit index = column * 8 + bit
+    uint8_t programCount = 0;
+  };
+
+  void powerUp();
+  uint8_t readRegister(uint8_t address) const;
+  void writeRegister(uint8_t address, uint8_t value);
+  bool isBlockProtected(uint16_t block) const;
+  // Copies a page into the buffer applying the ECC model, returns its ECC bits.
+  uint8_t loadBuffer(uint32_t page);
+  // Copies page 0 (unique ID), 1 (parameter page) or an OTP page into the
+  // buffer, for page data reads with OTP-E = 1.
+  void loadOtpPage(uint32_t page);
+  void executeProgram(uint32_t page);
+  void eraseBlock(uint16_t block);
+  uint8_t readOutput();
+
+  SimNandTiming timing_;
+  std::vector<Page> pages_;
+  std::vector<bool> badBlocks_;
+  uint8_t buffer_[kPageSize];
+  uint8_t parameterPage_[3 * 256];
+
+  uint8_t protectionRegister_;
+  uint8_t configurationRegister_;
+  bool writeEnabled_ = false;
+  bool programFailed_ = false;
+  bool eraseFailed_ = false;
+  uint8_t eccBits_ = 0;
+  uint32_t loadedPage_ = 0;
+
+  uint8_t opcode_ = 0;
+  uint32_t index_ = 0;
+  uint8_t registerAddress_ = 0;
+  uint32_t argument_ = 0;        // page or column address being shifted in
+  uint16_t column_ = 0;
+  uint32_t continuousPage_ = 0;
+  uint32_t partialProgramViolations_ = 0;
+  uint32_t instructionsWhileBusy_ = 0;
+  uint32_t badBlockOperations_ = 0;
+};
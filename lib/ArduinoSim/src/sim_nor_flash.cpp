@@ -0,0 +1,342 @@
+#include "./sim_nor_flash.h"
+
+#include <string.h>
+
+namespace {
+
+const uint8_t kWriteEnable = 0x06;
+const uint8_t kWriteDisable = 0x04;
+const uint8_t kReadId = 0x9F;
+const uint8_t kMultipleIoReadId = 0x9E;
+const uint8_t kReadStatus = 0x05;
+const uint8_t kReadFlagStatus = 0x70;
+const uint8_t kClearFlagStatus = 0x50;
+const uint8_t kReadVolatileConfiguration = 0x85;
+const uint8_t kWriteVolatileConfiguration = 0x81;
+const uint8_t kReadNonVolatileConfiguration = 0xB5;
+const uint8_t kReadExtendedAddress = 0xC8;
+const uint8_t kWriteExtendedAddress = 0xC5;
+const uint8_t kEnter4ByteAddress = 0xB7;
+const uint8_t kExit4ByteAddress = 0xE9;
+const uint8_t kRead = 0x03;
+const uint8_t kRead4Byte = 0x13;
+const uint8_t kFastRead = 0x0B;
+const uint8_t kFastRead4Byte = 0x0C;
+const uint8_t kDualIoFastRead4Byte = 0xBC;
+const uint8_t kQuadIoFastRead4Byte = 0xEC;
+const uint8_t kDtrQuadIoFastRead4Byte = 0xEE;
+const uint8_t kPageProgram = 0x02;
+const uint8_t kPageProgram4Byte = 0x12;
+const uint8_t kErase4K = 0x20;
+const uint8_t kErase4K4Byte = 0x21;
+const uint8_t kErase32K = 0x52;
+const uint8_t kErase32K4Byte = 0x5C;
+const uint8_t kEraseSector = 0xD8;
+const uint8_t kEraseSector4Byte = 0xDC;
+const uint8_t kDieErase = 0xC4;
+const uint8_t kBulkErase = 0xC7;
+
+// Micron, serial NOR 3 V, 512 Mbit.
+const uint8_t kId[3] = {0x20, 0xBA, 0x20};
+
+// Dummy clocks of FAST READ at bits 7-4 of the volatile configuration
+// register, 0 and 15 meaning the default.
+const uint8_t kDefaultDummyClocks = 8;
+const uint8_t kDefaultQuadDummyClocks = 10; // 0xEC and 0xEE
+
+bool isFastRead(uint8_t opcode) {
+  return opcode == kFastRead || opcode == kFastRead4Byte ||
+      opcode == kDualIoFastRead4Byte || opcode == kQuadIoFastRead4Byte ||
+      opcode == kDtrQuadIoFastRead4Byte;
+}
+
+bool isRead(uint8_t opcode) {
+  return opcode == kRead || opcode == kRead4Byte || isFastRead(opcode);
+}
+
+// Bits each dummy clock takes from the bus: 1 per line, twice with DTR.
+uint8_t dummyClockBits(uint8_t opcode) {
+  switch (opcode) {
+    case kDualIoFastRead4Byte: return 2;
+    case kQuadIoFastRead4Byte: return 4;
+    case kDtrQuadIoFastRead4Byte: return 8;
+    default: return 1;
+  }
+}
+
+bool isProgram(uint8_t opcode) {
+  return opcode == kPageProgram || opcode == kPageProgram4Byte;
+}
+
+bool isAddressedErase(uint8_t opcode) {
+  return opcode == kErase4K || opcode == kErase4K4Byte ||
+      opcode == kErase32K || opcode == kErase32K4Byte ||
+      opcode == kEraseSector || opcode == kEraseSector4Byte;
+}
+
+} // namespace
+
+SimNorDie::SimNorDie(const char* name, uint8_t chipSelectPin, uint8_t holdPin,
+    const SimNorTiming& timing)
+    : SimDevice(name, chipSelectPin), timing_(timing), holdPin_(holdPin),
+      sectors_(kSectors), subsectorErases_(kBytes / kSubsectorBytes, 0),
+      failingSectors_(kSectors, false) {}
+
+uint8_t SimNorDie::peek(uint32_t address) const {
+  const std::vector<uint8_t>& sector = sectors_[address / kSectorBytes];
+  return sector.empty() ? 0xFF : sector[address % kSectorBytes];
+}
+
+void SimNorDie::poke(uint32_t address, uint8_t value) {
+  std::vector<uint8_t>& sector = sectors_[address / kSectorBytes];
+  if (sector.empty()) {
+    sector.assign(kSectorBytes, 0xFF);
+  }
+  sector[address % kSectorBytes] = value;
+}
+
+bool SimNorDie::isHeld() const {
+  return simBus.pinRead(holdPin_) == 0;
+}
+
+uint8_t SimNorDie::addressBytes() const {
+  if (opcode_ == kRead4Byte || opcode_ == kFastRead4Byte ||
+      opcode_ == kDualIoFastRead4Byte || opcode_ == kQuadIoFastRead4Byte ||
+      opcode_ == kDtrQuadIoFastRead4Byte || opcode_ == kPageProgram4Byte || opcode_ == kErase4K4Byte ||
+      opcode_ == kErase32K4Byte || opcode_ == kEraseSector4Byte) {
+    return 4;
+  }
+  return fourByteAddressing_ ? 4 : 3;
+}
+
+// Bit 7 ready, 5 erase error, 4 program error, 0 4 byte addressing.
+uint8_t SimNorDie::flagStatusRegister() const {
+  return (isBusy() ? 0x00 : 0x80) | (eraseFailed_ ? 0x20 : 0) |
+      (programFailed_ ? 0x10 : 0) | (fourByteAddressing_ ? 0x01 : 0);
+}
+
+void SimNorDie::select() {
+  active_ = !isHeld();
+  ignored_ = false;
+  opcode_ = 0;
+  index_ = 0;
+  address_ = 0;
+  exitsXip_ = true;
+  if (active_ && xip_) {
+    opcode_ = xipOpcode_;
+    index_ = 1;
+  }
+}
+
+uint8_t SimNorDie::exchange(uint8_t mosi) {
+  if (!active_) {
+    return 0xFF;
+  }
+  const uint32_t index = index_++;
+  if (index == 0) {
+    opcode_ = mosi;
+    if (isBusy() && opcode_ != kReadStatus && opcode_ != kReadFlagStatus) {
+      ++instructionsWhileBusy_;
+      ignored_ = true;
+    }
+    if (isProgram(opcode_)) {
+      memset(page_, 0xFF, sizeof(page_));
+    }
+    return 0xFF;
+  }
+  if (ignored_) {
+    return 0xFF;
+  }
+  switch (opcode_) {
+    case kReadStatus:
+      return (isBusy() ? 0x01 : 0) | (writeEnabled_ ? 0x02 : 0);
+    case kReadFlagStatus:
+      return flagStatusRegister();
+    case kReadId:
+    case kMultipleIoReadId:
+      return index <= sizeof(kId) ? kId[index - 1] : 0x00;
+    case kReadVolatileConfiguration:
+      return volatileConfiguration_;
+    case kReadNonVolatileConfiguration:
+      return 0xFF;
+    case kReadExtendedAddress:
+      return extendedAddress_;
+    case kWriteVolatileConfiguration:
+    case kWriteExtendedAddress:
+      if (index == 1) {
+        argument_ = mosi;
+      }
+      return 0xFF;
+    default:
+      break;
+  }
+  const uint8_t addressBytes = this->addressBytes();
+  if (!isRead(opcode_) && !isProgram(opcode_) && !isAddressedErase(opcode_)) {
+    return 0xFF;
+  }
+  if (index <= addressBytes) {
+    address_ = (address_ << 8) | mosi;
+    if (index == addressBytes) {
+      if (addressBytes == 3) {
+        address_ |= (uint32_t)(extendedAddress_ & 0x03) << 24;
+      }
+      address_ %= kBytes;
+    }
+    return 0xFF;
+  }
+  if (isProgram(opcode_)) {
+    page_[address_ % kPageBytes] = mosi;
+    address_ = (address_ / kPageBytes) * kPageBytes +
+        (address_ + 1) % kPageBytes;
+    return 0xFF;
+  }
+  if (!isRead(opcode_)) {
+    return 0xFF;
+  }
+  if (isFastRead(opcode_)) {
+    uint8_t dummyClocks = volatileConfiguration_ >> 4;
+    if (dummyClocks == 0 || dummyClocks == 15) {
+      dummyClocks = dummyClockBits(opcode_) >= 4 ? kDefaultQuadDummyClocks :
+          kDefaultDummyClocks;
+    }
+    const uint32_t dummyBytes =
+        ((uint32_t)dummyClocks * dummyClockBits(opcode_) + 7) / 8;
+    if (index - addressBytes <= dummyBytes) {
+      if (index == addressBytes + 1u) {
+        exitsXip_ = (mosi & 0x80) != 0;
+      }
+      return 0xFF;
+    }
+  }
+  const uint8_t output = peek(address_);
+  address_ = (address_ + 1) % kBytes;
+  return output;
+}
+
+void SimNorDie::deselect() {
+  if (!active_ || ignored_ || opcode_ == 0) {
+    return;
+  }
+  const bool needsWriteEnable = isProgram(opcode_) ||
+      isAddressedErase(opcode_) || opcode_ == kDieErase ||
+      opcode_ == kBulkErase || opcode_ == kWriteVolatileConfiguration ||
+      opcode_ == kWriteExtendedAddress;
+  if (needsWriteEnable && !writeEnabled_) {
+    ++rejectedInstructions_;
+    return;
+  }
+  const bool hasAddress = index_ > addressBytes();
+  if (isFastRead(opcode_)) {
+    if (index_ > addressBytes() + 1u) { // the confirmation bit was sent
+      xip_ = (volatileConfiguration_ & 0x08) == 0 && !exitsXip_;
+      xipOpcode_ = opcode_;
+    }
+    return;
+  }
+  switch (opcode_) {
+    case kWriteEnable:
+      writeEnabled_ = true;
+      return;
+    case kWriteDisable:
+      writeEnabled_ = false;
+      return;
+    case kClearFlagStatus:
+      programFailed_ = false;
+      eraseFailed_ = false;
+      return;
+    case kEnter4ByteAddress:
+      fourByteAddressing_ = true;
+      return;
+    case kExit4ByteAddress:
+      fourByteAddressing_ = false;
+      return;
+    case kWriteVolatileConfiguration:
+      if (index_ >= 2) {
+        volatileConfiguration_ = argument_;
+      }
+      break;
+    case kWriteExtendedAddress:
+      if (index_ >= 2) {
+        extendedAddress_ = argument_;
+      }
+      break;
+    case kPageProgram:
+    case kPageProgram4Byte:
+      if (hasAddress) {
+        programPage();
+      }
+      break;
+    case kErase4K:
+    case kErase4K4Byte:
+      if (hasAddress) {
+        erase(address_, kSubsectorBytes, timing_.subsector4KEraseNanos);
+      }
+      break;
+    case kErase32K:
+    case kErase32K4Byte:
+      if (hasAddress) {
+        erase(address_, 8 * kSubsectorBytes, timing_.subsector32KEraseNanos);
+      }
+      break;
+    case kEraseSector:
+    case kEraseSector4Byte:
+      if (hasAddress) {
+        erase(address_, kSectorBytes, timing_.sectorEraseNanos);
+      }
+      break;
+    case kDieErase:
+    case kBulkErase:
+      erase(0, kBytes, timing_.dieEraseNanos);
+      break;
+    default:
+      return;
+  }
+  writeEnabled_ = false;
+}
+
+void SimNorDie::erase(uint32_t address, uint32_t bytes, uint64_t nanos) {
+  startBusy(nanos);
+  const uint32_t first = address / bytes * bytes;
+  for (uint32_t sector = first / kSectorBytes;
+       sector <= (first + bytes - 1) / kSectorBytes; ++sector) {
+    if (failingSectors_[sector]) {
+      eraseFailed_ = true;
+      return;
+    }
+  }
+  for (uint32_t subsector = first / kSubsectorBytes;
+       subsector < (first + bytes) / kSubsectorBytes; ++subsector) {
+    ++subsectorErases_[subsector];
+  }
+  if (bytes >= kSectorBytes) {
+    for (uint32_t sector = first / kSectorBytes;
+         sector < (first + bytes) / kSectorBytes; ++sector) {
+      sectors_[sector].clear();
+      sectors_[sector].shrink_to_fit();
+    }
+    return;
+  }
+  std::vector<uint8_t>& sector = sectors_[first / kSectorBytes];
+  if (!sector.empty()) {
+    memset(&sector[first % kSectorBytes], 0xFF, bytes);
+  }
+}
+
+void SimNorDie::programPage() {
+  startBusy(timing_.pageProgramNanos);
+  const uint32_t first = address_ / kPageBytes * kPageBytes;
+  if (failingSectors_[first / kSectorBytes]) {
+    programFailed_ = true;
+    return;
+  }
+  for (uint16_t i = 0; i < kPageBytes; ++i) {
+    if (page_[i] != 0xFF) {
+      poke(first + i, peek(first + i) & page_[i]);
+    }
+  }
+}
+
+SimNorFlash::SimNorFlash(uint8_t chipSelectPin, uint8_t holdPin1,
+    uint8_t holdPin2)
+    : die1_("NOR Flash MT25TL01G die 1", chipSelectPin, holdPin1, timing_),
+      die2_("NOR Flash MT25TL01G die 2", chipSelectPin, holdPin2, timing_) {}
@@ -0,0 +1,184 @@
+/**
+ * @file sim_nor_flash.h
+ * @brief Behavioural model of the MT25TL01G SPI NOR Flash (see
+ *    memory_nor_flash.h).
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * Two 512 Mbit dies sharing chip select and clock. On the breakout board DQ0
+ * and DQ4 are both on MOSI and DQ1 and DQ5 both on MISO, and each die has
+ * its own HOLD# pin: a die whose HOLD# is LOW ignores the bus, so the driver
+ * talks to one die at a time by holding the other. Each die is a SimDevice
+ * of its own, with its own status registers and busy time.
+ *
+ * Each die is 64 MByte: 1024 sectors of 64 KByte, each one 2 subsectors of
+ * 32 KByte or 16 of 4 KByte, and 256 byte program pages. Decoded
+ * instructions:
+ *  - 0x06 WREN, 0x04 WRDI, 0x9F/0x9E READ ID,
+ *  - 0x05 READ STATUS REGISTER (WIP, WEL), 0x70 READ FLAG STATUS REGISTER
+ *    (ready, erase and program errors, 4 byte addressing) and 0x50 CLEAR
+ *    FLAG STATUS REGISTER,
+ *  - 0x85/0x81 read/write volatile configuration register (dummy clocks at
+ *    bits 7-4), 0xB5 read non volatile configuration register,
+ *  - 0xC8/0xC5 read/write extended address register and 0xB7/0xE9
+ *    enter/exit 4 byte address mode,
+ *  - 0x03 READ and 0x0B FAST READ, with a 3 or 4 byte address depending on
+ *    the address mode, and 0x13 and 0x0C, always with a 4 byte address,
+ *  - 0xBC DUAL I/O, 0xEC QUAD I/O and 0xEE DTR QUAD I/O FAST READ, with a 4
+ *    byte address. Bytes move over 2 or 4 lines, and on both clock edges
+ *    for 0xEE, when the driver sends them through SimBus::transferLanes();
+ *    the die only needs to know how many dummy bytes that makes,
+ *  - 0x02/0x12 PAGE PROGRAM, BUSY for tPP,
+ *  - 0x20/0x21 4 KByte and 0x52/0x5C 32 KByte SUBSECTOR ERASE, 0xD8/0xDC
+ *    SECTOR ERASE and 0xC4/0xC7 die erase, BUSY for their erase times.
+ *
+ * A 3 byte address takes its upper bits from the extended address
+ * register. The FAST READs wait for the dummy clocks of the volatile
+ * configuration register (8 by default, 10 for the quad I/O ones), rounded
+ * up to whole bytes on their lines.
+ *
+ * XIP: with bit 3 of the volatile configuration register at 0, a FAST READ
+ * whose first dummy clock is 0 (the XIP confirmation bit) leaves the die in
+ * XIP. Every read that follows is the same FAST READ without its opcode,
+ * starting with the address, until one with the confirmation bit at 1. No
+ * other instruction is decoded meanwhile.
+ *
+ * Programming only clears bits, like the real array; a page program wraps
+ * inside its 256 byte page. WEL is required by programs, erases and
+ * register writes, and goes back to 0 after them. failSector() makes the
+ * programs and erases of a sector fail with the error flags of the flag
+ * status register, as a worn out sector would.
+ *
+ * Sectors are allocated on first program, so an erased sector costs no host
+ * memory.
+ */
+
+#pragma once
+
+#include "./sim_bus.h"
+
+#include <stdint.h>
+#include <vector>
+
+struct SimNorTiming {
+  uint64_t pageProgramNanos = 120000;           // tPP typical, 256 bytes
+  uint64_t subsector4KEraseNanos = 50000000;    // tSSE 4 KByte typical
+  uint64_t subsector32KEraseNanos = 100000000;  // tSSE 32 KByte typical
+  uint64_t sectorEraseNanos = 150000000;        // tSE typical
+  uint64_t dieEraseNanos = 153000000000ull;     // tDE typical, 512 Mbit
+};
+
+class SimNorDie : public SimDevice {
+public:
+  static const uint32_t kBytes = 1ul << 26;
+  static const uint32_t kSectorBytes = 65536;
+  static const uint16_t kSectors = 1024;
+  static const uint16_t kSubsectorBytes = 4096;
+  static const uint16_t kPageBytes = 256;
+
+  SimNorDie(const char* name, uint8_t chipSelectPin, uint8_t holdPin,
+      const SimNorTiming& timing);
+
+  // Direct array access for the host, no bus cost. address inside the die.
+  uint8_t peek(uint32_t address) const;
+  void poke(uint32_t address, uint8_t value);
+
+  // Erases of the 4 KByte subsector of address, by any erase instruction.
+  uint32_t subsectorErases(uint32_t address) const {
+    return subsectorErases_[address / kSubsectorBytes];
+  }
+
+  void failSector(uint16_t sector) { failingSectors_[sector] = true; }
+
+  // Instructions other than status register reads sent while busy.
+  uint32_t instructionsWhileBusy() const { return instructionsWhileBusy_; }
+  // Programs, erases and register writes sent with WEL = 0.
+  uint32_t rejectedInstructions() const { return rejectedInstructions_; }
+
+  // Whether the next selection starts with an address instead of an opcode.
+  bool isInXip() const { return xip_; }
+
+  bool isHeld() const override;
+
+  void select() override;
+  uint8_t exchange(uint8_t mosi) override;
+  void deselect() override;
+
+private:
+  uint8_t addressBytes() const;
+  uint8_t flagStatusRegister() const;
+  // Erase bytes bytes from address, aligned to them.
+  void erase(uint32_t address, uint32_t bytes, uint64_t nanos);
+  void programPage();
+
+  const SimNorTiming& timing_;
+  uint8_t holdPin_;
+  std::vector<std::vector<uint8_t>> sectors_; // empty while erased
+  std::vector<uint32_t> subsectorErases_;
+  std::vector<bool> failingSectors_;
+  uint8_t page_[kPageBytes];
+
+  bool writeEnabled_ = false;
+  bool fourByteAddressing_ = false;
+  bool programFailed_ = false;
+  bool eraseFailed_ = false;
+  uint8_t volatileConfiguration_ = 0xFB;
+  uint8_t extendedAddress_ = 0;
+
+  bool active_ = false; // not held when selected
+  bool ignored_ = false;
+  uint8_t opcode_ = 0;
+  uint32_t index_ = 0;
+  uint32_t address_ = 0;
+  uint8_t argument_ = 0;
+  bool xip_ = false;
+  uint8_t xipOpcode_ = 0;
+  bool exitsXip_ = true; // XIP confirmation bit of the current read
+  uint32_t instructionsWhileBusy_ = 0;
+  uint32_t rejectedInstructions_ = 0;
+};
+
+class SimNorFlash {
+public:
+  static const uint32_t kCapacity = 2 * SimNorDie::kBytes;
+
+  /**
+   * @param holdPin1 HOLD# of the die of the lower 64 MByte, holdPin2 that
+   *    of the upper ones.
+   */
+  SimNorFlash(uint8_t chipSelectPin, uint8_t holdPin1, uint8_t holdPin2);
+
+  SimNorTiming& timing() { return timing_; }
+
+  SimNorDie& die(uint8_t index) { return index == 0 ? die1_ : die2_; }
+
+  // Linear addresses over both dies, the second one from 64 MByte.
+  uint8_t peek(uint32_t address) const {
+    return dieOf(address).peek(address % SimNorDie::kBytes);
+  }
+
+  void poke(uint32_t address, uint8_t value) {
+    die(address / SimNorDie::kBytes).poke(address % SimNorDie::kBytes, value);
+  }
+
+  /**
+   * @brief Flip one stored bit, as a radiation upset would. The flip stays
+   *    until the subsector is erased.
+   */
+  void injectBitFlip(uint32_t address, uint8_t bit) {
+    poke(address, peek(address) ^ (1 << bit));
+  }
+
+  uint32_t instructionsWhileBusy() const {
+    return die1_.instructionsWhileBusy() + die2_.instructionsWhileBusy();
+  }
+
+private:
+  const SimNorDie& dieOf(uint32_t address) const {
+    return address < SimNorDie::kBytes ? die1_ : die2_;
+  }
+
+  SimNorTiming timing_;
+  SimNorDie die1_;
+  SimNorDie die2_;
+};
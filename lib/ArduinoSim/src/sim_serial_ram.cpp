@@ -0,0 +1,125 @@
+#include "./sim_serial_ram.h"
+
+namespace {
+
+const uint8_t kWriteEnable = 0x06;
+const uint8_t kWriteDisable = 0x04;
+const uint8_t kReadStatus = 0x05;
+const uint8_t kWriteStatus = 0x01;
+const uint8_t kRead = 0x03;
+const uint8_t kWrite = 0x02;
+const uint8_t kFastRead = 0x0B;
+
+const uint8_t kWel = 0x02;
+const uint8_t kWritableStatusBits = 0x8C; // WPEN/SRWD, BP1, BP0
+
+} // namespace
+
+SimSerialRamConfig SimSerialRam::framConfig() {
+  SimSerialRamConfig config = {"FRAM CY15B108QN", 1048576, true, true, false};
+  return config;
+}
+
+SimSerialRamConfig SimSerialRam::mramConfig() {
+  SimSerialRamConfig config = {"MRAM MR25H40", 524288, false, false, true};
+  return config;
+}
+
+SimSerialRam::SimSerialRam(const SimSerialRamConfig& config,
+    uint8_t chipSelectPin)
+    : SimDevice(config.name, chipSelectPin), config_(config),
+      array_(config.capacity, 0x00) {}
+
+uint8_t SimSerialRam::statusRegister() const {
+  return protectionBits_ | (writeEnabled_ ? kWel : 0);
+}
+
+bool SimSerialRam::isProtected(uint32_t address) const {
+  switch ((protectionBits_ >> 2) & 0x03) {
+    case 1: return address >= config_.capacity / 4 * 3;
+    case 2: return address >= config_.capacity / 2;
+    case 3: return true;
+    default: return false;
+  }
+}
+
+void SimSerialRam::select() {
+  opcode_ = 0;
+  index_ = 0;
+  address_ = 0;
+  writeAccepted_ = false;
+}
+
+uint8_t SimSerialRam::exchange(uint8_t mosi) {
+  const uint32_t index = index_++;
+  if (index == 0) {
+    opcode_ = mosi;
+    if (opcode_ == kWrite) {
+      writeAccepted_ = writeEnabled_;
+      if (!writeAccepted_) {
+        ++rejectedWrites_;
+      }
+    }
+    return 0xFF;
+  }
+  switch (opcode_) {
+    case kReadStatus:
+      if (config_.statusAfterReadIsWrong && lastInstructionWasRead_) {
+        return 0xFF;
+      }
+      return statusRegister();
+    case kWriteStatus:
+      if (index == 1 && writeEnabled_) {
+        protectionBits_ = mosi & kWritableStatusBits;
+      }
+      return 0xFF;
+    case kRead:
+    case kWrite:
+    case kFastRead:
+      if (index <= 3) {
+        address_ = ((address_ << 8) | mosi) % config_.capacity;
+        return 0xFF;
+      }
+      break;
+    default:
+      return 0xFF;
+  }
+  if (opcode_ == kFastRead) {
+    if (!config_.hasFastRead || index == 4) {
+      return 0xFF; // dummy byte
+    }
+  }
+  if (opcode_ == kWrite) {
+    if (writeAccepted_ && !isProtected(address_)) {
+      array_[address_] = mosi;
+    }
+    address_ = (address_ + 1) % config_.capacity;
+    return 0xFF;
+  }
+  const uint8_t output = array_[address_];
+  address_ = (address_ + 1) % config_.capacity;
+  return output;
+}
+
+void SimSerialRam::deselect() {
+  if (opcode_ == 0) {
+    return;
+  }
+  switch (opcode_) {
+    case kWriteEnable:
+      writeEnabled_ = true;
+      break;
+    case kWriteDisable:
+      writeEnabled_ = false;
+      break;
+    case kWrite:
+    case kWriteStatus:
+      if (config_.writeClearsWel) {
+        writeEnabled_ = false;
+      }
+      break;
+    default:
+      break;
+  }
+  lastInstructionWasRead_ = opcode_ == kRead || opcode_ == kFastRead;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file sim_serial_ram.h
+ * @brief Behavioural model of the SPI FRAM (CY15B108QN, see memory_fram.h)
+ *    and SPI MRAM (MR25H40, see memory_mram.h).
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * Both memories share the same instruction set for the array: WREN, WRDI,
+ * RDSR, WRSR, READ and WRITE with a 3 byte address, and no write cycle: bytes
+ * are stored as they arrive, so they are never busy. They differ in:
+ *
+ *  - capacity (1 MByte FRAM, 512 KByte MRAM), addresses wrap at the end,
+ *  - the FRAM clears WEL at the end of every WRITE/WRSR, the MRAM keeps it,
+ *  - the FRAM has FSTRD (fast read, one dummy byte after the address),
+ *  - the MRAM outputs a wrong status register on the first RDSR that follows
+ *    a READ (see memory_mram.h).
+ *
+ * Construct it with framConfig() or mramConfig().
+ */
+
+#pragma once
+
+#include "./sim_bus.h"
+
+#include <stdint.h>
+#include <vector>
+
+struct SimSerialRamConfig {
+  const char* name;
+  uint32_t capacity;
+  bool writeClearsWel;
+  bool hasFastRead;
+  bool statusAfterReadIsWrong;
+};
+
+class SimSerialRam : public SimDevice {
+public:
+  static SimSerialRamConfig framConfig();
+  static SimSerialRamConfig mramConfig();
+
+  SimSerialRam(const SimSerialRamConfig& config, uint8_t chipSelectPin);
+
+  uint32_t capacity() const { return config_.capacity; }
+
+  // Direct array access for the host, no bus cost.
+  uint8_t peek(uint32_t address) const { return array_[address % config_.capacity]; }
+  void poke(uint32_t address, uint8_t value) { array_[address % config_.capacity] = value; }
+
+  // WRITE instructions received while WEL = 0.
+  uint32_t rejectedWrites() const { return rejectedWrites_; }
+
+  void select() override;
+  uint8_t exchange(uint8_t mosi) override;
+  void deselect() override;
+
+private:
+  uint8_t statusRegister() const;
+  bool isProtected(uint32_t address) const;
+
+  SimSerialRamConfig config_;
+  std::vector<uint8_t> array_;
+
+  bool writeEnabled_ = false;
+  uint8_t protectionBits_ = 0; // WPEN/SRWD, BP1, BP0 as in the status register
+  bool lastInstructionWasRead_ = false;
+  bool writeAccepted_ = false;
+
+  uint8_t opcode_ = 0;
+  uint32_t index_ = 0;
+  uint32_t address_ = 0;
+  uint32_t rejectedWrites_ = 0;
+};
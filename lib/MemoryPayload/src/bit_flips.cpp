@@ -0,0 +1,75 @@
+#include "./bit_flips.h"
+
+#include <string.h>
+
+#ifdef __AVR__
+
+uint32_t countFlips(const uint8_t* read, const uint8_t* expected, uint16_t size) {
+  uint32_t flips = 0;
+  for (uint16_t i = 0; i < size; ++i) {
+    flips += countBits(read[i] ^ expected[i]);
+  }
+  return flips;
+}
+
+#else
+
+// memcpy instead of a cast, the buffers do not have to be aligned.
+static inline uint64_t loadWord(const uint8_t* bytes) {
+  uint64_t word;
+  memcpy(&word, bytes, sizeof(word));
+  return word;
+}
+
+// Four accumulators so that the popcounts of a 32 byte block do not depend
+// on each other.
+uint32_t countFlips(const uint8_t* read, const uint8_t* expected, uint16_t size) {
+  uint32_t counts[4] = {0, 0, 0, 0};
+  uint16_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    for (uint8_t j = 0; j < 4; ++j) {
+      counts[j] += __builtin_popcountll(
+          loadWord(read + i + 8 * j) ^ loadWord(expected + i + 8 * j));
+    }
+  }
+  uint32_t flips = counts[0] + counts[1] + counts[2] + counts[3];
+  for (; i < size; ++i) {
+    flips += countBits(read[i] ^ expected[i]);
+  }
+  return flips;
+}
+
+uint64_t countDumpFlips(const uint8_t* dump, uint16_t pageSize, uint32_t pages,
+    uint32_t firstAddress, const PatternGenerator& pattern,
+    uint32_t* flipsPerPage) {
+  uint8_t* expected = new uint8_t[pageSize];
+  uint64_t flips = 0;
+  for (uint32_t page = 0; page < pages; ++page) {
+    const uint32_t address = firstAddress + page * pageSize;
+    pattern.fill(address, expected, pageSize);
+    flipsPerPage[page] = countFlips(dump + (uint64_t)page * pageSize, expected,
+        pageSize);
+    flips += flipsPerPage[page];
+  }
+  delete[] expected;
+  return flips;
+}
+
+#endif
+
+// The positions are only looked for in chunks that have flips.
+void FlipCountSink::write(uint32_t offset, const uint8_t* chunk, uint8_t size) {
+  uint8_t expected[kStreamChunkBytes];
+  pattern_.fill(baseAddress_ + offset, expected, size);
+  const uint32_t flips = countFlips(chunk, expected, size);
+  flips_ += flips;
+  if (flips == 0 || positions_ == nullptr) {
+    return;
+  }
+  for (uint8_t i = 0; i < size; ++i) {
+    const uint8_t xorMask = chunk[i] ^ expected[i];
+    if (xorMask != 0) {
+      positions_->record(baseAddress_ + offset + i, xorMask);
+    }
+  }
+}
@@ -0,0 +1,82 @@
+/**
+ * @file bit_flips.h
+ * @brief Count of the bits that differ between what a memory output and
+ *    what a pattern expects, for the raw (no ECC) reads of the NAND Flash.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * A MismatchSink records every byte that differs, which is what a verify
+ * wants. Counting upsets only needs the amount of flipped bits, the
+ * popcount of read XOR expected, and positions only now and then.
+ *
+ * countFlips() is the kernel. On the AVR it works a byte at a time with a
+ * SWAR popcount, the ATmega328 having no wider registers to gain from. On
+ * other targets it XORs 8 bytes at a time as 64 bit words with four
+ * independent accumulators, which compilers turn into vector popcounts
+ * (e.g. -mavx512vpopcntdq) or at least popcnt instructions. That is the
+ * path countDumpFlips() uses on the host for the raw page dumps sent down
+ * from the satellite.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "./chunk_stream.h"
+#include "./mismatch_sink.h"
+#include "./pattern_generator.h"
+
+// Bits at 1 in value.
+inline uint8_t countBits(uint8_t value) {
+  value = value - ((value >> 1) & 0x55);
+  value = (value & 0x33) + ((value >> 2) & 0x33);
+  return (value + (value >> 4)) & 0x0F;
+}
+
+// Bits that differ between read[i] and expected[i] for i < size.
+uint32_t countFlips(const uint8_t* read, const uint8_t* expected, uint16_t size);
+
+/**
+ * @brief Counts the flipped bits of a read against a pattern, chunk by
+ *    chunk, so that a page can be checked without a page sized buffer.
+ *    Optionally records the address and XOR mask of every differing byte.
+ */
+class FlipCountSink : public ChunkSink {
+public:
+  /**
+   * @param baseAddress address of the first byte of the read, the one the
+   *    pattern is asked for at offset 0.
+   * @param positions where the differing bytes go, nullptr for counts only.
+   */
+  FlipCountSink(const PatternGenerator& pattern, uint32_t baseAddress,
+      MismatchSink* positions = nullptr)
+      : pattern_(pattern), baseAddress_(baseAddress), positions_(positions),
+        flips_(0) {}
+
+  void write(uint32_t offset, const uint8_t* chunk, uint8_t size) override;
+
+  uint32_t flips() const { return flips_; }
+
+private:
+  const PatternGenerator& pattern_;
+  uint32_t baseAddress_;
+  MismatchSink* positions_;
+  uint32_t flips_;
+};
+
+#ifndef __AVR__
+/**
+ * @brief Flipped bits of every page of a raw dump of consecutive pages, on
+ *    the host.
+ *
+ * @param dump pages * pageSize bytes, as read from the memory.
+ * @param firstAddress address of dump[0] for the pattern, pages follow each
+ *    other every pageSize addresses (linear NAND Flash addresses, see
+ *    MemoryNANDFlash::verifyRange()).
+ * @param flipsPerPage receives pages counts.
+ * @return flipped bits of the whole dump.
+ */
+uint64_t countDumpFlips(const uint8_t* dump, uint16_t pageSize, uint32_t pages,
+    uint32_t firstAddress, const PatternGenerator& pattern,
+    uint32_t* flipsPerPage);
+#endif
@@ -0,0 +1,78 @@
+#include "./bus_scheduler.h"
+
+#include <Arduino.h>
+
+// Longest delayMicroseconds() that is accurate on the AVR.
+static const uint32_t kMaxIdleMicros = 16383;
+
+BusScheduler::BusScheduler() : taskCount_(0), nextTask_(0), idleMicros_(0) {}
+
+bool BusScheduler::addTask(BusTask& task) {
+  if (taskCount_ == kMaxTasks) {
+    Serial.println("Error: No room for another task in BusScheduler's addTask(...).");
+    return false;
+  }
+  tasks_[taskCount_] = &task;
+  dueMicros_[taskCount_] = micros();
+  ++taskCount_;
+  return true;
+}
+
+void BusScheduler::begin() {
+  for (uint8_t i = 0; i < taskCount_; ++i) {
+    pinMode(tasks_[i]->chipSelectPin(), OUTPUT);
+    digitalWrite(tasks_[i]->chipSelectPin(), HIGH);
+  }
+}
+
+bool BusScheduler::isIdle() const {
+  for (uint8_t i = 0; i < taskCount_; ++i) {
+    if (!tasks_[i]->isFinished()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Due times are compared through the signed difference with micros() so
+ * that they keep working when micros() wraps around every 71 minutes.
+ *
+ * The search for a due task starts after the last one that ran, so every
+ * task that is always due (a scrub) gets its turn and a task whose memory
+ * has become ready waits for at most one step of each of the others.
+ */
+void BusScheduler::run(uint32_t budgetMicros) {
+  const uint32_t startMicros = micros();
+  while (micros() - startMicros < budgetMicros && !isIdle()) {
+    const uint32_t now = micros();
+    int32_t earliestWait = 0x7FFFFFFF;
+    bool ran = false;
+    for (uint8_t checked = 0; checked < taskCount_ && !ran; ++checked) {
+      const uint8_t index = (nextTask_ + checked) % taskCount_;
+      if (tasks_[index]->isFinished()) {
+        continue;
+      }
+      const int32_t wait = (int32_t)(dueMicros_[index] - now);
+      if (wait > 0) {
+        earliestWait = wait < earliestWait ? wait : earliestWait;
+        continue;
+      }
+      const uint32_t delayMicros = tasks_[index]->step();
+      dueMicros_[index] = micros() + delayMicros;
+      nextTask_ = (index + 1) % taskCount_;
+      ran = true;
+    }
+    if (!ran) {
+      uint32_t idle = budgetMicros - (now - startMicros);
+      if ((uint32_t)earliestWait < idle) {
+        idle = earliestWait;
+      }
+      if (idle > kMaxIdleMicros) {
+        idle = kMaxIdleMicros;
+      }
+      delayMicroseconds(idle);
+      idleMicros_ += idle;
+    }
+  }
+}
@@ -0,0 +1,92 @@
+/**
+ * @file bus_scheduler.h
+ * @brief Shares the SPI bus between the memories so that none of them waits
+ *    on another one's write cycle, program, erase or page load.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * All the memories are on the same SPI lines, and while one of them is
+ * busy after starting a long operation (5 ms EEPROM write cycle, NAND Flash
+ * program, erase or page load) the bus is free for the others. Blocking on
+ * waitUntilReady() leaves it idle instead.
+ *
+ * The work on the bus is split in BusTasks. A step() does one bounded piece
+ * of work (start an operation, read the status of a busy memory, verify a
+ * block...) and returns how long until the task needs the bus again: the
+ * expected duration of the operation it has just started, a poll interval
+ * if its memory is still busy, or 0 if it can go on right away. The
+ * scheduler gives the bus to the due tasks in turns, so a busy memory is
+ * only polled when due and the time in between goes to the other tasks.
+ *
+ * A single transaction is in flight at any time, as every task finishes its
+ * transaction inside step().
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+
+class BusTask {
+public:
+  explicit BusTask(uint8_t chipSelectPin) : chipSelectPin_(chipSelectPin) {}
+  virtual ~BusTask() {}
+
+  /**
+   * @brief Use the bus for one bounded piece of work.
+   *
+   * @return microseconds until the task needs the bus again, 0 to be
+   *    scheduled again as soon as it is its turn.
+   */
+  virtual uint32_t step() = 0;
+
+  // Finished tasks are not scheduled anymore.
+  virtual bool isFinished() const { return false; }
+
+  uint8_t chipSelectPin() const { return chipSelectPin_; }
+
+private:
+  uint8_t chipSelectPin_;
+};
+
+class BusScheduler {
+public:
+  static const uint8_t kMaxTasks = 8;
+
+  BusScheduler();
+
+  /**
+   * @brief Add a task to the scheduler. Its memory's chip select pin is
+   *    driven by the scheduler from begin() on.
+   *
+   * @return false if there are already kMaxTasks tasks.
+   */
+  bool addTask(BusTask& task);
+
+  /**
+   * @brief Set every chip select pin as a HIGH output, so that no memory is
+   *    selected before its task starts.
+   */
+  void begin();
+
+  /**
+   * @brief Run the due tasks in turns until budgetMicros have gone by. When
+   *    no task is due the bus is left idle until the next one is.
+   *
+   * A call takes at most budgetMicros plus one step() of a task.
+   */
+  void run(uint32_t budgetMicros);
+
+  // true once every task has finished.
+  bool isIdle() const;
+
+  // Time run() waited with no task due.
+  uint32_t idleMicros() const { return idleMicros_; }
+
+private:
+  BusTask* tasks_[kMaxTasks];
+  uint32_t dueMicros_[kMaxTasks];
+  uint8_t taskCount_;
+  uint8_t nextTask_; // round robin start
+  uint32_t idleMicros_;
+};
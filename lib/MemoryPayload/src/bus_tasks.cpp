@@ -0,0 +1,128 @@
+#include "./bus_tasks.h"
+
+#include <Arduino.h>
+
+// Typical durations of the datasheets, the first poll happens after them.
+static const uint32_t kEepromWriteCycleMicros = 4000; // tW is 5 ms at most
+static const uint32_t kNandPageReadMicros = 25; // ECC on takes up to 60 us
+static const uint32_t kNandProgramMicros = 250;
+static const uint32_t kNandBlockEraseMicros = 2000;
+
+// Time between two polls once the typical duration has gone by.
+static const uint32_t kEepromPollMicros = 250;
+static const uint32_t kNandPollMicros = 20;
+
+EepromWriteTask::EepromWriteTask(MemoryEEPROM& eeprom,
+    const PatternGenerator& pattern, uint32_t firstAddress, uint32_t length)
+    : BusTask(CHIP_SELECT_EEPROM), eeprom_(eeprom), pattern_(pattern),
+      address_(firstAddress), endAddress_(firstAddress + length),
+      writing_(false), finished_(length == 0) {}
+
+uint32_t EepromWriteTask::step() {
+  if (writing_) {
+    if (eeprom_.poll() == MemoryOperationStatus::kPending) {
+      return kEepromPollMicros;
+    }
+    writing_ = false;
+  }
+  if (address_ >= endAddress_) {
+    finished_ = true;
+    return 0;
+  }
+  uint8_t page[256];
+  pattern_.fill(address_, page, sizeof(page));
+  if (eeprom_.startWrite(page, sizeof(page), address_) == MemoryOperationStatus::kError) {
+    return kEepromPollMicros; // still busy, try the same page again
+  }
+  address_ += 256;
+  writing_ = true;
+  return kEepromWriteCycleMicros;
+}
+
+NandWriteTask::NandWriteTask(MemoryNANDFlash& nand,
+    const PatternGenerator& pattern, uint32_t firstPage, uint32_t pages,
+    uint8_t* pageBuffer)
+    : BusTask(CHIP_SELECT_NAND_FLASH), nand_(nand), pattern_(pattern),
+      page_(firstPage), endPage_(firstPage + pages), pageBuffer_(pageBuffer),
+      busy_(false), erased_(false), finished_(pages == 0), failures_(0) {}
+
+// A block is erased when the first of its pages is reached, and the step
+// after the erase programs that page. Bad blocks (see
+// MemoryNANDFlash::setBadBlockTable()) are neither erased nor programmed.
+uint32_t NandWriteTask::step() {
+  if (busy_) {
+    const MemoryOperationStatus status = nand_.poll();
+    if (status == MemoryOperationStatus::kPending) {
+      return kNandPollMicros;
+    }
+    if (status == MemoryOperationStatus::kError) {
+      ++failures_;
+    }
+    busy_ = false;
+  }
+  if (page_ >= endPage_) {
+    finished_ = true;
+    return 0;
+  }
+  const NandGeometry& geometry = nand_.geometry();
+  if (nand_.isBadBlock(geometry.blockOf(page_))) {
+    page_ = geometry.firstPageOf(geometry.blockOf(page_) + 1);
+    if (page_ > endPage_) {
+      page_ = endPage_;
+    }
+    return 0;
+  }
+  if (geometry.pageInBlock(page_) == 0 && !erased_) {
+    nand_.startErase(page_);
+    erased_ = true;
+    busy_ = true;
+    return kNandBlockEraseMicros;
+  }
+  pattern_.fill(page_ * geometry.pageBytes(), pageBuffer_, geometry.pageBytes());
+  nand_.startWrite(pageBuffer_, page_);
+  ++page_;
+  erased_ = false;
+  busy_ = true;
+  return kNandProgramMicros;
+}
+
+NandScrubTask::NandScrubTask(MemoryNANDFlash& nand,
+    const PatternGenerator& pattern, uint32_t firstPage, uint32_t pages)
+    : BusTask(CHIP_SELECT_NAND_FLASH), nand_(nand), pattern_(pattern),
+      firstPage_(firstPage), pages_(pages), page_(firstPage), loading_(false),
+      passes_(0), bytesVerified_(0), uncorrectablePages_(0) {}
+
+// Pages of bad blocks are skipped a block per step.
+uint32_t NandScrubTask::step() {
+  const NandGeometry& geometry = nand_.geometry();
+  if (!loading_ && nand_.isBadBlock(geometry.blockOf(page_))) {
+    page_ = geometry.firstPageOf(geometry.blockOf(page_) + 1);
+    if (page_ >= firstPage_ + pages_) {
+      page_ = firstPage_;
+      ++passes_;
+    }
+    return 0;
+  }
+  if (!loading_) {
+    nand_.startRead(page_);
+    loading_ = true;
+    return kNandPageReadMicros;
+  }
+  const MemoryOperationStatus status = nand_.poll();
+  if (status == MemoryOperationStatus::kPending) {
+    return kNandPollMicros;
+  }
+  if (status == MemoryOperationStatus::kError) {
+    ++uncorrectablePages_;
+  }
+  loading_ = false;
+  nand_.verifyBuffer(page_ * geometry.pageBytes(), geometry.pageBytes(),
+      pattern_, sink_);
+  bytesVerified_ += geometry.pageBytes();
+  ++page_;
+  if (page_ == firstPage_ + pages_) {
+    page_ = firstPage_;
+    ++passes_;
+  }
+  return 0;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file bus_tasks.h
+ * @brief BusTasks (see bus_scheduler.h) for the work the payload does on
+ *    each memory.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * ScrubTask        verifies one step of a ScrubEngine per step(), it never
+ *                  waits on its memory (FRAM, MRAM or a ready EEPROM).
+ * EepromWriteTask  writes a pattern page by page, one write cycle each.
+ * NandWriteTask    erases the blocks of a range of pages and programs the
+ *                  pattern into them.
+ * NandScrubTask    loads every page into the buffer and verifies it.
+ *
+ * The tasks with long operations start them with the start...() methods of
+ * the drivers, return their typical duration and then check them with
+ * poll(), a single status register read each time.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#include "./bus_scheduler.h"
+#include "./memory_eeprom.h"
+#include "./memory_nand_flash.h"
+#include "./mismatch_sink.h"
+#include "./pattern_generator.h"
+#include "./scrub_engine.h"
+
+template <typename Memory>
+class ScrubTask : public BusTask {
+public:
+  ScrubTask(ScrubEngine<Memory>& engine, uint8_t chipSelectPin)
+      : BusTask(chipSelectPin), engine_(engine) {}
+
+  uint32_t step() override {
+    engine_.run(0); // a single step
+    return 0;
+  }
+
+private:
+  ScrubEngine<Memory>& engine_;
+};
+
+class EepromWriteTask : public BusTask {
+public:
+  /**
+   * @param firstAddress lowest address of the first page, multiple of 256.
+   * @param length amount of bytes to write, multiple of 256.
+   */
+  EepromWriteTask(MemoryEEPROM& eeprom, const PatternGenerator& pattern,
+      uint32_t firstAddress, uint32_t length);
+
+  uint32_t step() override;
+  bool isFinished() const override { return finished_; }
+
+private:
+  MemoryEEPROM& eeprom_;
+  const PatternGenerator& pattern_;
+  uint32_t address_;
+  uint32_t endAddress_;
+  bool writing_;
+  bool finished_;
+};
+
+class NandWriteTask : public BusTask {
+public:
+  /**
+   * @param firstPage first page of a block, a multiple of the pages per
+   *    block of MemoryNANDFlash::geometry() (64).
+   * @param pages amount of pages to program, their blocks are erased first.
+   * @param pageBuffer PAGE_SIZE_NAND_FLASH bytes where each page is
+   *    generated before it is loaded, shared with other users as it is
+   *    only needed inside step().
+   */
+  NandWriteTask(MemoryNANDFlash& nand, const PatternGenerator& pattern,
+      uint32_t firstPage, uint32_t pages, uint8_t* pageBuffer);
+
+  uint32_t step() override;
+  bool isFinished() const override { return finished_; }
+
+  // Programs and erases the memory reported as failed (P-FAIL, E-FAIL).
+  uint32_t failures() const { return failures_; }
+
+private:
+  MemoryNANDFlash& nand_;
+  const PatternGenerator& pattern_;
+  uint32_t page_;
+  uint32_t endPage_;
+  uint8_t* pageBuffer_;
+  bool busy_;
+  bool erased_;
+  bool finished_;
+  uint32_t failures_;
+};
+
+class NandScrubTask : public BusTask {
+public:
+  /**
+   * @param firstPage first page verified, every pass goes from firstPage to
+   *    firstPage + pages - 1.
+   */
+  NandScrubTask(MemoryNANDFlash& nand, const PatternGenerator& pattern,
+      uint32_t firstPage, uint32_t pages);
+
+  uint32_t step() override;
+
+  uint32_t passes() const { return passes_; }
+  uint64_t bytesVerified() const { return bytesVerified_; }
+  MismatchSink& sink() { return sink_; }
+
+  // Page loads with more errors than ECC could correct.
+  uint32_t uncorrectablePages() const { return uncorrectablePages_; }
+
+private:
+  MemoryNANDFlash& nand_;
+  const PatternGenerator& pattern_;
+  MismatchSink sink_;
+  uint32_t firstPage_;
+  uint32_t pages_;
+  uint32_t page_;
+  bool loading_;
+  uint32_t passes_;
+  uint64_t bytesVerified_;
+  uint32_t uncorrectablePages_;
+};
@@ -0,0 +1,65 @@
+/**
+ * @file chip_select.h
+ * @brief Chip select line written straight to its port register.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * digitalWrite() looks the pin up in three PROGMEM tables and disables the
+ * interrupts around the write, a few microseconds on the ATmega328, paid
+ * twice by every instruction sent to a memory. ChipSelect<Pin> takes the
+ * pin as a template argument, so its PORTx register and bit mask are
+ * resolved at compile time and select()/deselect() become a single cbi/sbi
+ * instruction (2 cycles, atomic, no interrupt guard needed).
+ *
+ * Arduino Nano pin numbering: 0..7 are PORTD, 8..13 PORTB and 14..19
+ * (A0..A5) PORTC.
+ *
+ * In the native simulator the write goes through simPortWrite(), charged at
+ * the cost of a port write. Other targets fall back to digitalWrite().
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+
+template <uint8_t Pin>
+class ChipSelect {
+public:
+  // Make the pin an output and leave the memory deselected.
+  static void begin() {
+    pinMode(Pin, OUTPUT);
+    deselect();
+  }
+
+  static void select() {
+#ifdef __AVR__
+    port() &= (uint8_t)~kMask;
+#elif defined(SPACERAD_NATIVE_SIMULATOR)
+    simPortWrite(Pin, LOW);
+#else
+    digitalWrite(Pin, LOW);
+#endif
+  }
+
+  static void deselect() {
+#ifdef __AVR__
+    port() |= kMask;
+#elif defined(SPACERAD_NATIVE_SIMULATOR)
+    simPortWrite(Pin, HIGH);
+#else
+    digitalWrite(Pin, HIGH);
+#endif
+  }
+
+private:
+#ifdef __AVR__
+  static_assert(Pin < 20, "ChipSelect only knows the pins of the Arduino Nano");
+
+  static const uint8_t kMask = 1 << (Pin < 8 ? Pin : (Pin < 14 ? Pin - 8 : Pin - 14));
+
+  static volatile uint8_t& port() {
+    return Pin < 8 ? PORTD : (Pin < 14 ? PORTB : PORTC);
+  }
+#endif
+};
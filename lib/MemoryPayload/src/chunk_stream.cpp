@@ -0,0 +1,18 @@
+#include "./chunk_stream.h"
+
+// CRC of every 4 bit value, reflected polynomial 0xEDB88320.
+static const uint32_t kCrc32Nibbles[16] PROGMEM = {
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+  0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+  0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+void Crc32Sink::write(uint32_t offset, const uint8_t* chunk, uint8_t size) {
+  for (uint8_t i = 0; i < size; ++i) {
+    crc_ ^= chunk[i];
+    crc_ = (crc_ >> 4) ^ pgm_read_dword(&kCrc32Nibbles[crc_ & 0x0F]);
+    crc_ = (crc_ >> 4) ^ pgm_read_dword(&kCrc32Nibbles[crc_ & 0x0F]);
+  }
+  bytes_ += size;
+}
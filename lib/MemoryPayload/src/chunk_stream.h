@@ -0,0 +1,120 @@
+/**
+ * @file chunk_stream.h
+ * @brief Sinks and sources for the readStream()/writeStream() methods of the
+ *    drivers, which move ranges of any length in small chunks.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * readNBytes() and writeNBytes() need the whole range in RAM and take an
+ * int size, 16 bits on the AVR. The stream methods take a uint32_t length
+ * instead and go through a kStreamChunkBytes buffer on the stack: a read
+ * hands every chunk to a ChunkSink as soon as it arrives, and a write asks
+ * a ChunkSource for every chunk right before sending it. So a whole memory
+ * can be read or written with a single call and no page sized buffer.
+ *
+ * The chunks are handled while the memory is selected, between two bytes of
+ * the same instruction, so a sink or source must not use the SPI bus.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <stdint.h>
+
+#include "./pattern_generator.h"
+
+static const uint8_t kStreamChunkBytes = 32;
+
+class ChunkSink {
+public:
+  virtual ~ChunkSink() {}
+
+  /**
+   * @param offset position of chunk[0] from the start of the range.
+   * @param chunk the bytes read, only valid during the call.
+   */
+  virtual void write(uint32_t offset, const uint8_t* chunk, uint8_t size) = 0;
+};
+
+class ChunkSource {
+public:
+  virtual ~ChunkSource() {}
+
+  // Fill chunk with the size bytes of the range that start at offset.
+  virtual void read(uint32_t offset, uint8_t* chunk, uint8_t size) = 0;
+};
+
+/**
+ * @brief Source of the bytes a pattern expects from baseAddress onwards,
+ *    to write a pattern with writeStream().
+ */
+class PatternSource : public ChunkSource {
+public:
+  PatternSource(const PatternGenerator& pattern, uint32_t baseAddress)
+      : pattern_(pattern), baseAddress_(baseAddress) {}
+
+  void read(uint32_t offset, uint8_t* chunk, uint8_t size) override {
+    pattern_.fill(baseAddress_ + offset, chunk, size);
+  }
+
+private:
+  const PatternGenerator& pattern_;
+  uint32_t baseAddress_;
+};
+
+/**
+ * @brief CRC-32 (IEEE 802.3, the one of zip files) of every byte written to
+ *    it, to check a range against a reference without storing it. Computed
+ *    4 bits at a time with a 16 entry table in PROGMEM.
+ */
+class Crc32Sink : public ChunkSink {
+public:
+  Crc32Sink() : crc_(0xFFFFFFFF), bytes_(0) {}
+
+  void write(uint32_t offset, const uint8_t* chunk, uint8_t size) override;
+
+  uint32_t crc() const { return ~crc_; }
+  uint32_t bytes() const { return bytes_; }
+  void clear() {
+    crc_ = 0xFFFFFFFF;
+    bytes_ = 0;
+  }
+
+private:
+  uint32_t crc_;
+  uint32_t bytes_;
+};
+
+/**
+ * @brief Receive length bytes from the selected memory, one chunk at a time.
+ *
+ * @param offset of the first byte inside the range given to the sink.
+ */
+inline void receiveChunks(SPIClass& bus, ChunkSink& sink, uint32_t offset,
+    uint32_t length) {
+  uint8_t chunk[kStreamChunkBytes];
+  while (length > 0) {
+    const uint8_t size = length < kStreamChunkBytes ? length : kStreamChunkBytes;
+    bus.transfer(chunk, size);
+    sink.write(offset, chunk, size);
+    offset += size;
+    length -= size;
+  }
+}
+
+/**
+ * @brief Send length bytes to the selected memory, one chunk at a time. The
+ *    chunk is scratch space, so the buffer version of transfer can be used.
+ */
+inline void sendChunks(SPIClass& bus, ChunkSource& source, uint32_t offset,
+    uint32_t length) {
+  uint8_t chunk[kStreamChunkBytes];
+  while (length > 0) {
+    const uint8_t size = length < kStreamChunkBytes ? length : kStreamChunkBytes;
+    source.read(offset, chunk, size);
+    bus.transfer(chunk, size);
+    offset += size;
+    length -= size;
+  }
+}
@@ -127,10 +127,14 @@
 #include <Arduino.h>
 #include <stdint.h> // to avoid uint8_t unknown type syntax highlight error
 #include <Array.h>
+#include "./memory_operation_status.h"
+#include "./spi_memory.h"
 #include <SPI.h>
 
 // Pins
+#ifndef CHIP_SELECT_EEPROM
 #define CHIP_SELECT_EEPROM 18
+#endif
 
 // opcodes
 #define WREN_EEPROM 6
@@ -148,43 +152,28 @@
 
 extern SPIClass hspi;
 
-class MemoryEEPROM {
+struct EepromTraits {
+  static const char* name() { return "EEPROM"; }
+  static SPIClass& bus() { return hspi; }
+  static const uint8_t kChipSelectPin = CHIP_SELECT_EEPROM;
+  static const uint32_t kClockHz = SPI_TRANSFER_SPEED_EEPROM;
+  static const uint32_t kCapacity = 262144;
+  static const uint8_t kAddressBytes = 3;
+  static const uint8_t kWriteEnableOpcode = WREN_EEPROM;
+  static const uint8_t kWriteDisableOpcode = WRDI_EEPROM;
+  static const uint8_t kReadStatusOpcode = RDSR_EEPROM;
+  static const uint8_t kReadOpcode = READ_EEPROM;
+  static const uint8_t kWriteOpcode = WRITE_EEPROM;
+};
+
+// isWriteEnabled(), enableWrite(), disableWrite(), readStatusRegister(),
+// verifyRange(), addEnableWrite(), addRead() and execute() come from SpiMemory.
+// Writes are not batched, each one starts a write cycle that has to end
+// before the next instruction.
+class MemoryEEPROM : public SpiMemory<EepromTraits> {
 public:
   MemoryEEPROM() {}
   ~MemoryEEPROM() {}
-  
-  /**
-   * @brief Perform a RDSR read status register instruction. Check if the WEL
-   * flag in the status register is at 1 (allow write instructions) or at 0
-   * (dissallow write instructions)
-   * 
-   * Cannot fail because it simply checks status register by a RDSR instruction.
-   * 
-   * @return true if WEL = 1
-   * @return false if WEL = 0
-   */
-  bool isWriteEnabled();
-
-  /**
-   * @brief Status register has a WEL flag that at 1 allows memory to be written,
-   * but at 0 it does not allow it. This changes the flag to 1.
-   * 
-   * NOTE: this will fail if the memory is currently in a write cycle.
-   * @pre Memory not busy
-   */
-  void enableWrite();
-
-  /**
-   * @brief Status register has a WEL flag that at 1 allows memory to be written,
-   * but at 0 it does not allow it. This changes the flag to 0.
-   * 
-   * Makes no effect on current write cycle; it will be successfuly finished,
-   * but there won't be a next write cycle after this method is called.
-   * 
-   * NOTE: this will fail if the memory is currently in a write cycle.
-   * @pre Memory not busy
-   */
-  void disableWrite();
 
   /**
    * @brief The memory can be in a write cycle, which means that a non status
@@ -218,7 +207,7 @@ public:
    * @pre 0 <= address <= 2^18 - 1
    * @pre Memory is not busy
    */
-  uint8_t readByte(size_t address);
+  uint8_t readByte(uint32_t address);
 
   /**
    * @brief read a page. Most significant is read first.
@@ -233,42 +222,98 @@ public:
    * to read the whole 256 byte page.
    * @pre 0 <= lowestAddress <= ((2^18 - 1) - 255)
    */
-  Array<uint8_t, 256> readPage(size_t lowestAddress);
+  Array<uint8_t, 256> readPage(uint32_t lowestAddress);
 
   /**
-   * @brief Write a byte.
+   * @brief Read size consecutive bytes. Returns without reading if the
+   *    memory is in a write cycle, instead of reading wrong values.
+   *
+   * @param initialAddress lower than 2^18. Past the last address the read
+   *    wraps to 0.
+   * @return kDone, or kError if initialAddress is invalid or the memory is
+   *    busy.
+   */
+  MemoryOperationStatus startRead(uint32_t initialAddress, uint8_t* buffer,
+      int size);
+
+  /**
+   * @brief Enable write and send a WRITE of size bytes, which starts a write
+   *    cycle of up to 5 ms when chip select goes back to HIGH. Use poll() to
+   *    know when it has finished, instead of delay().
+   *
+   * @param initialAddress lower than 2^18.
+   * @param size amount of bytes, all of them inside the page of
+   *    initialAddress (256 byte pages).
+   * @return kPending, or kError if the range is invalid or the memory is
+   *    still in a previous write cycle.
+   * @pre Region to write at is not protected.
+   * @post Memory is busy writing
+   */
+  MemoryOperationStatus startWrite(uint8_t* buffer, int size,
+      uint32_t initialAddress);
+
+  /**
+   * @brief Read the status register once.
+   *
+   * @return kPending during a write cycle, kDone otherwise.
+   */
+  MemoryOperationStatus poll();
+
+  /**
+   * @brief readStream() of SpiMemory (see chunk_stream.h) that returns
+   *    without reading if the memory is in a write cycle.
+   *
+   * @return kDone, or kError if initialAddress is invalid or the memory is
+   *    busy.
+   */
+  MemoryOperationStatus readStream(uint32_t initialAddress, uint32_t length,
+      ChunkSink& sink);
+
+  /**
+   * @brief Write length bytes from initialAddress, asking source for them
+   *    kStreamChunkBytes at a time (see chunk_stream.h). Every page touched
+   *    gets one WRITE instruction and its write cycle is waited for before
+   *    the next one, so this blocks for about 5 ms per page.
+   *
+   * @param length any amount of bytes, 2^18 for the whole memory. Past the
+   *    last address the write wraps to 0.
+   * @return kDone once the last write cycle has finished, or kError if
+   *    initialAddress is invalid.
+   * @pre Region to write at is not protected.
+   */
+  MemoryOperationStatus writeStream(uint32_t initialAddress, uint32_t length,
+      ChunkSource& source);
+
+  /**
+   * @brief Write a byte, with startWrite(), which sends the write enable.
+   * 
+   * Nothing is written, and nothing reported, if a write cycle is still in
+   * progress: startWrite() returns kError then, which this call drops. Use
+   * startWrite() and poll() to see a refused write.
    * 
    * @param uint8_t byteToWrite
    * @param address lower than 2^18, since the eeprom's memory array is of
    *  256 Kbyte.
    * @pre 0 <= address <= 2^18 - 1
-   * @pre Memory not busy.
-   * @pre Write is enabled
    * @pre Region to write at is not protected.
-   * @post Memory is busy writing
+   * @post Memory is busy writing, unless it was busy already
    */
-  void writeByte(uint8_t byteToWrite, size_t address);
+  void writeByte(uint8_t byteToWrite, uint32_t address);
 
   /**
    * @brief write a page with a single internal Write cycle.
    * 
-   * In this EEPROM, pages are of size 256 byte.
+   * In this EEPROM, pages are of size 256 byte. Like writeByte(), it goes
+   * through startWrite() and does nothing while a write cycle is in
+   * progress.
    * 
    * @param content bytes that will substitute the old bytes in memory. 
    * @param lowestAddress lower than (2^18 - 255), since the eeprom's memory
    * array is of 256 Kbyte, and the address is incremented 255 times to be able
    * to read the whole 256 byte page.
    * @pre 0 <= lowestAddress <= ((2^18 - 1) - 255)
-   * @pre Memory not busy.
-   * @pre Write is enabled
    * @pre Region to write at is not protected.
-   * @post Memory is busy writing
+   * @post Memory is busy writing, unless it was busy already
    */
-  void writePage(Array<uint8_t, 256> content, size_t lowestAddress);
-
-private:
-  // because readByte, readPage, writeByte, writePage are similar and will
-  // likely stay similar. So this is a auxiliary function for them.
-  void transferNBytes(uint8_t opcode, size_t address, uint8_t* buffer,
-      int amountOfBytes);
+  void writePage(Array<uint8_t, 256> content, uint32_t lowestAddress);
 };
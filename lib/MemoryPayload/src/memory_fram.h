@@ -145,9 +145,13 @@
 #include <Arduino.h>
 #include <stdint.h> // to avoid uint8_t unknown type syntax highlight error
 #include <Array.h>
+#include "./memory_operation_status.h"
+#include "./spi_memory.h"
 
 // Pins
+#ifndef CHIP_SELECT_FRAM
 #define CHIP_SELECT_FRAM 3
+#endif
 
 // opcodes
 #define WREN_FRAM 6
@@ -168,38 +172,27 @@
 
 #define SPI_TRANSFER_SPEED_FRAM 8000000 // 8 MHz typical
 
-class MemoryFRAM {
+struct FramTraits {
+  static const char* name() { return "FRAM"; }
+  static SPIClass& bus() { return SPI; }
+  static const uint8_t kChipSelectPin = CHIP_SELECT_FRAM;
+  static const uint32_t kClockHz = SPI_TRANSFER_SPEED_FRAM;
+  static const uint32_t kCapacity = 1048576;
+  static const uint8_t kAddressBytes = 3;
+  static const uint8_t kWriteEnableOpcode = WREN_FRAM;
+  static const uint8_t kWriteDisableOpcode = WRDI_FRAM;
+  static const uint8_t kReadStatusOpcode = RDSR_FRAM;
+  static const uint8_t kReadOpcode = READ_FRAM;
+  static const uint8_t kWriteOpcode = WRITE_FRAM;
+};
+
+// isWriteEnabled(), enableWrite(), disableWrite(), readStatusRegister(),
+// verifyRange(), readStream(), addEnableWrite(), addRead() and execute() come
+// from SpiMemory.
+class MemoryFRAM : public SpiMemory<FramTraits> {
 public:
   MemoryFRAM() {}
   ~MemoryFRAM() {}
-  
-  /**
-   * @brief Perform a RDSR read status register instruction. Check if the WEL
-   * flag in the status register is at 1 (allow write instructions) or at 0
-   * (dissallow write instructions)
-   * 
-   * Cannot fail because it simply checks status register by a RDSR instruction.
-   * 
-   * @return true if WEL = 1
-   * @return false if WEL = 0
-   */
-  bool isWriteEnabled();
-
-  /**
-   * @brief Status register has a WEL flag that at 1 allows memory to be written,
-   * but at 0 it does not allow it. This changes the flag to 1.
-   */
-  void enableWrite();
-
-  /**
-   * @brief Status register has a WEL flag that at 1 allows memory to be written,
-   * but at 0 it does not allow it. This changes the flag to 0.
-   * 
-   * Makes no effect on current write cycle; it will be successfuly finished,
-   * but there won't be a next write cycle after this method is called.
-   * 
-   */
-  void disableWrite();
 
   /**
    * @brief Read a single byte. Most significant is read first.
@@ -208,7 +201,7 @@ public:
    *  8 MBit.
    * @pre 0 <= address <= 2^20 - 1
    */
-  uint8_t readByte(size_t address);
+  uint8_t readByte(uint32_t address);
 
   /**
    * @brief Read N consecutive bytes by incrementing an initialAddress
@@ -221,7 +214,55 @@ public:
    * @param size amount of bytes to read.
    * @pre 0 <= initialAddress <= 2^20 - 1
    */
-  void readNBytes(size_t initialAddress, uint8_t* buffer, int size);
+  void readNBytes(uint32_t initialAddress, uint8_t* buffer, int size);
+
+  /**
+   * @brief Non blocking version of readNBytes(). The FRAM has no busy state,
+   *    so the bytes are already in buffer when it returns.
+   *
+   * @return kDone, or kError if initialAddress is invalid.
+   */
+  MemoryOperationStatus startRead(uint32_t initialAddress, uint8_t* buffer,
+      int size);
+
+  /**
+   * @brief Non blocking version of writeNBytes(), write is enabled first. Every byte is
+   *    written as it arrives, there is no write cycle to wait for.
+   *
+   * @return kDone, or kError if initialAddress is invalid.
+   * @pre Region to write at is not protected.
+   */
+  MemoryOperationStatus startWrite(uint8_t* buffer, int size,
+      uint32_t initialAddress);
+
+  /**
+   * @brief Status of the last operation started. Always kDone, since no
+   *    FRAM operation outlasts its instruction. Here so that every driver
+   *    can be polled the same way.
+   */
+  MemoryOperationStatus poll() { return MemoryOperationStatus::kDone; }
+
+  /**
+   * @brief Write length bytes from initialAddress with a single WRITE
+   *    instruction, asking source for them kStreamChunkBytes at a time (see
+   *    chunk_stream.h). Past the last address the write wraps to 0.
+   *
+   * @param length any amount of bytes, 2^20 for the whole memory.
+   * @return kDone, or kError if initialAddress is invalid.
+   * @pre Region to write at is not protected.
+   */
+  MemoryOperationStatus writeStream(uint32_t initialAddress, uint32_t length,
+      ChunkSource& source);
+
+  /**
+   * @brief Queue a WREN and a WRITE of size bytes to initialAddress, the
+   *    batched version of writeNBytes() (see spi_command_batch.h).
+   *
+   * @return false, with nothing queued, if initialAddress is invalid or the
+   *    batch has no room for both instructions.
+   */
+  bool addWrite(SpiCommandBatch& batch, uint8_t* buffer, uint16_t size,
+      uint32_t initialAddress);
 
   /**
    * @brief Write a byte.
@@ -236,7 +277,7 @@ public:
    * @pre 0 <= address <= 2^20 - 1
    * @pre Region to write at is not protected.
    */
-  void writeByte(uint8_t byteToWrite, size_t address);
+  void writeByte(uint8_t byteToWrite, uint32_t address);
 
   /**
    * @brief Write N consecutive bytes by incrementing an initialAddress
@@ -257,15 +298,10 @@ public:
    * @pre 0 <= address <= 2^20 - 1
    * @pre Region to write at is not protected.
    */
-  void writeNBytes(uint8_t* buffer, int size, size_t initialAddress);
+  void writeNBytes(uint8_t* buffer, int size, uint32_t initialAddress);
 
   // Consecutive reads. there is a fast-read instruction version that
   // adds a dummy byte that cannot be 1010XXXX, so 5 bytes total instead
   // of 4 to execute that instruction.
   // TODO: void fastRead(...);
-private:
-  // because readByte, readNBytes, writeByte, writeNBytes are similar and will
-  // likely stay similar. So this is a auxiliary function for them.
-  void transferNBytes(uint8_t opcode, size_t address, uint8_t* buffer,
-      int amountOfBytes);
 };
@@ -3,88 +3,50 @@
 #include <Arduino.h>
 #include "SPI.h"
 
-/**
- * WEL flag is second from the right on the byte word of the status register,
- * so apply a mask to the status register accordingly.
- * 
- * dummy data 0x00 is passed to transfer because I only want to read.
- */
-bool MemoryMRAM::isWriteEnabled() {
-  SPI.beginTransaction(SPISettings(SPI_TRANSFER_SPEED_MRAM, MSBFIRST, SPI_MODE0));
-  digitalWrite(CHIP_SELECT_MRAM, LOW);
-  SPI.transfer(RDSR_MRAM);
-  byte statusRegister = SPI.transfer(0x00);
-  digitalWrite(CHIP_SELECT_MRAM, HIGH);
-  SPI.endTransaction();
-  return 0x02 & statusRegister == 0x02;
+uint8_t MemoryMRAM::readByte(uint32_t address) {
+  uint8_t memoryOutputByte = 0;
+  startRead(address, &memoryOutputByte, 1);
+  return memoryOutputByte;
 }
 
-void MemoryMRAM::enableWrite() {
-  SPI.beginTransaction(SPISettings(SPI_TRANSFER_SPEED_MRAM, MSBFIRST, SPI_MODE0));
-  digitalWrite(CHIP_SELECT_MRAM, LOW);
-  SPI.transfer(WREN_MRAM);
-  digitalWrite(CHIP_SELECT_MRAM, HIGH);
-  SPI.endTransaction();
+void MemoryMRAM::readNBytes(uint32_t initialAddress, uint8_t* buffer, int size) {
+  startRead(initialAddress, buffer, size);
 }
 
-void MemoryMRAM::disableWrite() {
-  SPI.beginTransaction(SPISettings(SPI_TRANSFER_SPEED_MRAM, MSBFIRST, SPI_MODE0));
-  digitalWrite(CHIP_SELECT_MRAM, LOW);
-  SPI.transfer(WRDI_MRAM);
-  digitalWrite(CHIP_SELECT_MRAM, HIGH);
-  SPI.endTransaction();
+void MemoryMRAM::writeByte(uint8_t byteToWrite, uint32_t address) {
+  startWrite(&byteToWrite, 1, address);
 }
 
-uint8_t MemoryMRAM::readByte(size_t address) {
-  if (address > 1048575 || address < 0) {
-    Serial.println("Error: Invalid address passed to MRAM'S readByte(address).");
-    return 0;
-  }
-  uint8_t memoryOutputByte = 0;
-  transferNBytes(READ_MRAM, address, &memoryOutputByte, 1);
-  return memoryOutputByte;
+void MemoryMRAM::writeNBytes(uint8_t* buffer, int size, uint32_t initialAddress) {
+  startWrite(buffer, size, initialAddress);
 }
 
-void MemoryMRAM::readNBytes(size_t initialAddress, uint8_t* buffer, int size) {
-  if (initialAddress > 1048575 || initialAddress < 0) {
-    Serial.println("Error: Invalid initialAddress passed to MRAM'S readNBytes(...).");
-    return;
+MemoryOperationStatus MemoryMRAM::startRead(uint32_t initialAddress,
+    uint8_t* buffer, int size) {
+  if (!isValidAddress(initialAddress)) {
+    printInvalidAddress("startRead");
+    return MemoryOperationStatus::kError;
   }
   transferNBytes(READ_MRAM, initialAddress, buffer, size);
+  return MemoryOperationStatus::kDone;
 }
 
-void MemoryMRAM::writeByte(uint8_t byteToWrite, size_t address) {
-  if (address > 1048575 || address < 0) {
-    Serial.println("Error: Invalid address passed to MRAM'S writeByte(byteToWriet, address).");
-    return;
+MemoryOperationStatus MemoryMRAM::startWrite(uint8_t* buffer, int size,
+    uint32_t initialAddress) {
+  if (!isValidAddress(initialAddress)) {
+    printInvalidAddress("startWrite");
+    return MemoryOperationStatus::kError;
   }
-  transferNBytes(WRITE_MRAM, address, &byteToWrite, 1);
+  transferNBytes(WRITE_MRAM, initialAddress, buffer, size);
+  return MemoryOperationStatus::kDone;
 }
 
-void MemoryMRAM::writeNBytes(uint8_t* buffer, int size, size_t initialAddress) {
-  if (initialAddress > 1048575 || initialAddress < 0) {
-    Serial.println("Error: Invalid initialAddress passed to MRAM'S writeNBytes(...).");
-    return;
-  }
-  transferNBytes(WRITE_MRAM, initialAddress, buffer, size);
+bool MemoryMRAM::addWrite(SpiCommandBatch& batch, uint8_t* buffer,
+    uint16_t size, uint32_t initialAddress) {
+  return addWriteInstruction(batch, buffer, size, initialAddress);
 }
 
-/**
- * The address is of 3 bytes starting from most significant, so I apply byte wise
- * operation right shift and then convert it to byte, the result should be the
- * different bytes of the original address. Only 3 are relevant, the remaining
- * byte of address up to 32 bits is simply ignored.
- * 
- */
-void MemoryMRAM::transferNBytes(uint8_t opcode, size_t address, uint8_t* buffer,
-    int amountOfBytes) {
-  SPI.beginTransaction(SPISettings(SPI_TRANSFER_SPEED_MRAM, MSBFIRST, SPI_MODE0));
-  digitalWrite(CHIP_SELECT_MRAM, LOW);
-  SPI.transfer(opcode);
-  SPI.transfer((byte)(address >> 16));
-  SPI.transfer((byte)(address >> 8));
-  SPI.transfer((byte)address);
-  SPI.transfer(&buffer, amountOfBytes);
-  digitalWrite(CHIP_SELECT_MRAM, HIGH);
-  SPI.endTransaction();
-}
\ No newline at end of file
+MemoryOperationStatus MemoryMRAM::writeStream(uint32_t initialAddress,
+    uint32_t length, ChunkSource& source) {
+  return writeStreamInstruction(initialAddress, length, source, false);
+}
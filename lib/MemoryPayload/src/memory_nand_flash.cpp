@@ -1,8 +1,27 @@
 #include "./memory_nand_flash.h"
+#include "./spi_stream.h"
 
 #include <Arduino.h>
 #include "SPI.h"
 
+// Instruction of each NandReadMode: opcode, lanes of the column and of the
+// data, and dummy bytes after the column, sent on its lanes (8 dummy clocks
+// on 1 lane, 4 on 2 or 4).
+struct NandReadInstruction {
+  uint8_t opcode;
+  uint8_t addressLanes;
+  uint8_t dataLanes;
+  uint8_t dummyBytes;
+};
+
+static const NandReadInstruction kReadInstructions[] = {
+  {FAST_READ_NAND_FLASH, 1, 1, 1},
+  {FAST_READ_DUAL_OUTPUT_NAND_FLASH, 1, 2, 1},
+  {FAST_READ_QUAD_OUTPUT_NAND_FLASH, 1, 4, 1},
+  {FAST_READ_DUAL_IO_NAND_FLASH, 2, 2, 1},
+  {FAST_READ_QUAD_IO_NAND_FLASH, 4, 4, 2},
+};
+
 /**
  * WEL flag is second from the right on the byte word of the StatusRegister-3,
  * so apply a mask to the status register accordingly.
@@ -10,41 +29,29 @@
  * dummy data 0x00 is passed to transfer because I only want to read.
  */
 bool MemoryNANDFlash::isWriteEnabled() {
-  SPI.beginTransaction(SPISettings(SPI_TRANSFER_SPEED_NAND_FLASH, MSBFIRST, SPI_MODE0));
-  digitalWrite(CHIP_SELECT_NAND_FLASH, LOW);
-  SPI.transfer(RDSR_NAND_FLASH);
-  SPI.transfer(0x02); // Unsure if SR Address 2 is for SR-2 or for SR-3, but want SR-3.
+  beginCommand(RDSR_NAND_FLASH);
+  SPI.transfer(STATUS_REGISTER_NAND_FLASH);
   byte statusRegister = SPI.transfer(0x00);
-  digitalWrite(CHIP_SELECT_NAND_FLASH, HIGH);
-  SPI.endTransaction();
-  return 0x02 & statusRegister == 0x02;
+  endCommand();
+  return (statusRegister & 0x02) == 0x02;
 }
 
 void MemoryNANDFlash::enableWrite() {
-  SPI.beginTransaction(SPISettings(SPI_TRANSFER_SPEED_NAND_FLASH, MSBFIRST, SPI_MODE0));
-  digitalWrite(CHIP_SELECT_NAND_FLASH, LOW);
-  SPI.transfer(WREN_NAND_FLASH);
-  digitalWrite(CHIP_SELECT_NAND_FLASH, HIGH);
-  SPI.endTransaction();
+  beginCommand(WREN_NAND_FLASH);
+  endCommand();
 }
 
 void MemoryNANDFlash::disableWrite() {
-  SPI.beginTransaction(SPISettings(SPI_TRANSFER_SPEED_NAND_FLASH, MSBFIRST, SPI_MODE0));
-  digitalWrite(CHIP_SELECT_NAND_FLASH, LOW);
-  SPI.transfer(WRDI_NAND_FLASH);
-  digitalWrite(CHIP_SELECT_NAND_FLASH, HIGH);
-  SPI.endTransaction();
+  beginCommand(WRDI_NAND_FLASH);
+  endCommand();
 }
 
 bool MemoryNANDFlash::isBusy() {
-  SPI.beginTransaction(SPISettings(SPI_TRANSFER_SPEED_NAND_FLASH, MSBFIRST, SPI_MODE0));
-  digitalWrite(CHIP_SELECT_NAND_FLASH, LOW);
-  SPI.transfer(RDSR_NAND_FLASH);
-  byte statusRegister = 0;
-  SPI.transfer(statusRegister);
-  digitalWrite(CHIP_SELECT_NAND_FLASH, HIGH);
-  SPI.endTransaction();
-  return 0x01 & statusRegister == 0x01;
+  beginCommand(RDSR_NAND_FLASH);
+  SPI.transfer(STATUS_REGISTER_NAND_FLASH);
+  byte statusRegister = SPI.transfer(0x00);
+  endCommand();
+  return (statusRegister & 0x01) == 0x01;
 }
 
 /**
@@ -53,160 +60,892 @@ bool MemoryNANDFlash::isBusy() {
  * instruction once and check the output continually.
 */
 void MemoryNANDFlash::waitUntilReady() {
-  SPI.beginTransaction(SPISettings(SPI_TRANSFER_SPEED_NAND_FLASH, MSBFIRST, SPI_MODE0));
-  digitalWrite(CHIP_SELECT_NAND_FLASH, LOW);
-  SPI.transfer(RDSR_NAND_FLASH);
+  beginCommand(RDSR_NAND_FLASH);
+  SPI.transfer(STATUS_REGISTER_NAND_FLASH);
   byte statusRegister = SPI.transfer(0x00);
-  while (0x01 & statusRegister == 0x01) {
-    SPI.transfer(statusRegister);
+  while ((statusRegister & 0x01) == 0x01) {
+    statusRegister = SPI.transfer(0x00);
   }
-  digitalWrite(CHIP_SELECT_NAND_FLASH, HIGH);
-  SPI.endTransaction();
+  endCommand();
 }
 
-// apply 11111110 mask because last bit of configRegister is the busy one, and
-// I want it at 0.
-// Unsure if SR Address 1 is for SR-1 or for SR-2, but want 2.
+// BUF is the fourth bit from the right of SR-2, apply 11110111 mask to set it
+// to 0.
 void MemoryNANDFlash::setContinuousMode() {
-  SPI.beginTransaction(SPISettings(SPI_TRANSFER_SPEED_NAND_FLASH, MSBFIRST, SPI_MODE0));
-  byte configRegister = readStatusRegiter(1);
-  delay(1); // unsure if necessary, but it's a high to low immediately
-  byte newConfigRegister = (configRegister & 0xFE);
-  digitalWrite(CHIP_SELECT_NAND_FLASH, LOW);
-  SPI.transfer(WRSR_NAND_FLASH);
-  SPI.transfer(0x01); 
+  byte configRegister = readStatusRegiter(CONFIGURATION_REGISTER_NAND_FLASH);
+  byte newConfigRegister = (configRegister & 0xF7);
+  beginCommand(WRSR_NAND_FLASH);
+  SPI.transfer(CONFIGURATION_REGISTER_NAND_FLASH);
   SPI.transfer(newConfigRegister);
-  digitalWrite(CHIP_SELECT_NAND_FLASH, HIGH);
-  SPI.endTransaction();
+  endCommand();
 }
 
-// OR operation 00000001 because last bit of configRegister is the busy one, and
-// I want it at 1.
-// Unsure if SR Address 1 is for SR-1 or for SR-2, but want SR-2.
+// BUF is the fourth bit from the right of SR-2, OR operation 00001000 to set
+// it to 1.
 void MemoryNANDFlash::setBufferMode() {
-  SPI.beginTransaction(SPISettings(SPI_TRANSFER_SPEED_NAND_FLASH, MSBFIRST, SPI_MODE0));
-  byte configRegister = readStatusRegiter(1);
-  delay(1); // unsure if necessary, but it's a high to low immediately
-  byte newConfigRegister = (configRegister | 0x01);
-  digitalWrite(CHIP_SELECT_NAND_FLASH, LOW);
-  SPI.transfer(WRSR_NAND_FLASH);
-  SPI.transfer(0x01);
+  byte configRegister = readStatusRegiter(CONFIGURATION_REGISTER_NAND_FLASH);
+  byte newConfigRegister = (configRegister | 0x08);
+  beginCommand(WRSR_NAND_FLASH);
+  SPI.transfer(CONFIGURATION_REGISTER_NAND_FLASH);
   SPI.transfer(newConfigRegister);
-  digitalWrite(CHIP_SELECT_NAND_FLASH, HIGH);
-  SPI.endTransaction();
+  endCommand();
+}
+
+// ECC-E is the fifth bit from the right of SR-2, 00010000.
+void MemoryNANDFlash::disableEcc() {
+  byte configRegister = readStatusRegiter(CONFIGURATION_REGISTER_NAND_FLASH);
+  byte newConfigRegister = (configRegister & 0xEF);
+  beginCommand(WRSR_NAND_FLASH);
+  SPI.transfer(CONFIGURATION_REGISTER_NAND_FLASH);
+  SPI.transfer(newConfigRegister);
+  endCommand();
+  invalidateBuffer();
+}
+
+void MemoryNANDFlash::enableEcc() {
+  byte configRegister = readStatusRegiter(CONFIGURATION_REGISTER_NAND_FLASH);
+  byte newConfigRegister = (configRegister | 0x10);
+  beginCommand(WRSR_NAND_FLASH);
+  SPI.transfer(CONFIGURATION_REGISTER_NAND_FLASH);
+  SPI.transfer(newConfigRegister);
+  endCommand();
+  invalidateBuffer();
+}
+
+// SR-1 = 0 leaves BP3..BP0 and TB at 0, which means no protected block, and
+// keeps WP-E and the SRP bits at their power up value of 0.
+void MemoryNANDFlash::disableBlockProtection() {
+  beginCommand(WRSR_NAND_FLASH);
+  SPI.transfer(PROTECTION_REGISTER_NAND_FLASH);
+  SPI.transfer(0x00);
+  endCommand();
 }
 
 // Out of 27 relevant bits of an address, 16 are page address, 11 byte addresses
-// within page, so I pass the 16 most significant address bits to the page load
-// into buffer function.
-//
-// loadPageIntoBuffer(pageAddress (address >> 11 in this case)); must be called
-// beforehand.
+// within page, so the 16 most significant address bits are the page to have
+// in the buffer and the 11 least significant bits the column within it.
+// columnShift is 11 for the 2048 data bytes of the W25N01GV.
 uint8_t MemoryNANDFlash::readByte(size_t address) {
-  if (address > 134217727 || address < 0) {
-    Serial.println("Error: Invalid address passed to NAND_FLASH's readByte(address).");
+  const uint32_t pageAddress = (uint32_t)address >> geometry_.columnShift;
+  if (pageAddress >= geometry_.pages()) {
+    Serial.println(F("Error: Invalid address passed to NAND_FLASH's readByte(address)."));
     return 0;
   }
-  SPI.beginTransaction(SPISettings(SPI_TRANSFER_SPEED_NAND_FLASH, MSBFIRST, SPI_MODE0));
-  digitalWrite(CHIP_SELECT_NAND_FLASH, LOW);
-  SPI.transfer(READ_NAND_FLASH);
-  SPI.transfer16(address);
+  ensurePageInBuffer(pageAddress);
+  beginCommand(READ_NAND_FLASH);
+  SPI.transfer16(address & (geometry_.dataBytes - 1));
   SPI.transfer(0x00); // dummy
   byte outputByte = SPI.transfer(0x00);
-  digitalWrite(CHIP_SELECT_NAND_FLASH, HIGH);
-  SPI.endTransaction();
+  endCommand();
   return outputByte;
 }
 
-// 11 shifts to left so that it starts at the first address of the page.
-// Also, 2112 is page length (2048 + 64 bytes of ecc)
+// The page is read from column 0 of the buffer once loaded, 2112 bytes
+// (2048 + 64 bytes of ecc). An uncorrectable ECC error does not stop the
+// read, the bytes are returned as they are.
 void MemoryNANDFlash::readPage(size_t pageAddress, uint8_t* buffer) {
-  if (pageAddress > 65535 || pageAddress < 0) {
-    Serial.println("Error: Invalid pageAddress passed to MRAM's readNBytes(...).");
+  if (pageAddress >= geometry_.pages()) {
+    Serial.println(F("Error: Invalid pageAddress passed to NAND Flash's readPage(...)."));
     return;
   }
-  loadPageIntoBuffer(pageAddress);
-  delay(1); // unsure if needed
-  waitUntilReady();
-  delay(1); // unsure if needed
-  SPI.beginTransaction(SPISettings(SPI_TRANSFER_SPEED_NAND_FLASH, MSBFIRST, SPI_MODE0));
-  digitalWrite(CHIP_SELECT_NAND_FLASH, LOW);
-  SPI.transfer(READ_NAND_FLASH);
-  SPI.transfer16(pageAddress << 11);
+  ensurePageInBuffer(pageAddress);
+  readBuffer(buffer, 0, geometry_.pageBytes());
+}
+
+// A range can start and end in the middle of a page, so the first and last
+// pages are read from their column onwards and up to the end of the range.
+uint32_t MemoryNANDFlash::verifyRange(uint32_t initialAddress, uint32_t length,
+    const PatternGenerator& pattern, MismatchSink& sink) {
+  const uint32_t arrayBytes = geometry_.arrayBytes();
+  const uint16_t pageBytes = geometry_.pageBytes();
+  if (initialAddress >= arrayBytes) {
+    Serial.println(F("Error: Invalid initialAddress passed to NAND Flash's verifyRange(...)."));
+    return 0;
+  }
+  if (length > arrayBytes - initialAddress) {
+    length = arrayBytes - initialAddress;
+  }
+  uint32_t mismatches = 0;
+  uint32_t address = initialAddress;
+  const uint32_t endAddress = initialAddress + length;
+  while (address < endAddress) {
+    const uint16_t pageAddress = address / pageBytes;
+    const uint16_t column = address % pageBytes;
+    uint32_t bytesInPage = pageBytes - column;
+    if (bytesInPage > endAddress - address) {
+      bytesInPage = endAddress - address;
+    }
+    if (isBadBlock(geometry_.blockOf(pageAddress))) {
+      address += bytesInPage;
+      continue;
+    }
+    ensurePageInBuffer(pageAddress);
+    mismatches += verifyBuffer(address, bytesInPage, pattern, sink);
+    address += bytesInPage;
+  }
+  return mismatches;
+}
+
+uint32_t MemoryNANDFlash::verifyBuffer(uint32_t address, uint16_t length,
+    const PatternGenerator& pattern, MismatchSink& sink) {
+  const uint16_t column = address % geometry_.pageBytes();
+  if (length > geometry_.pageBytes() - column) {
+    Serial.println(F("Error: Range past the end of the page passed to NAND Flash's verifyBuffer(...)."));
+    return 0;
+  }
+  beginBufferRead(column);
+  uint32_t mismatches;
+  if (readBus_ == nullptr) {
+    SpiStream stream(SPI);
+    mismatches = streamVerify(stream, address, length, 0xFFFFFFFF, pattern,
+        sink);
+  } else {
+    mismatches = verifyChunks(*readBus_,
+        kReadInstructions[(uint8_t)readMode_].dataLanes, address, length,
+        pattern, sink);
+  }
+  endBufferRead();
+  return mismatches;
+}
+
+MemoryOperationStatus MemoryNANDFlash::readStream(uint32_t initialAddress,
+    uint32_t length, ChunkSink& sink) {
+  const uint32_t arrayBytes = geometry_.arrayBytes();
+  const uint16_t pageBytes = geometry_.pageBytes();
+  if (initialAddress >= arrayBytes) {
+    Serial.println(F("Error: Invalid initialAddress passed to NAND Flash's readStream(...)."));
+    return MemoryOperationStatus::kError;
+  }
+  if (length > arrayBytes - initialAddress) {
+    length = arrayBytes - initialAddress;
+  }
+  MemoryOperationStatus result = MemoryOperationStatus::kDone;
+  uint32_t offset = 0;
+  while (offset < length) {
+    const uint32_t address = initialAddress + offset;
+    const uint16_t pageAddress = address / pageBytes;
+    const uint16_t column = address % pageBytes;
+    uint32_t bytesInPage = pageBytes - column;
+    if (bytesInPage > length - offset) {
+      bytesInPage = length - offset;
+    }
+    if (ensurePageInBuffer(pageAddress) == MemoryOperationStatus::kError) {
+      result = MemoryOperationStatus::kError;
+    }
+    beginBufferRead(column);
+    receiveBuffer(sink, offset, bytesInPage);
+    endBufferRead();
+    offset += bytesInPage;
+  }
+  return result;
+}
+
+MemoryOperationStatus MemoryNANDFlash::writeStream(uint32_t initialAddress,
+    uint32_t length, ChunkSource& source) {
+  const uint32_t arrayBytes = geometry_.arrayBytes();
+  const uint16_t pageBytes = geometry_.pageBytes();
+  if (initialAddress >= arrayBytes) {
+    Serial.println(F("Error: Invalid initialAddress passed to NAND Flash's writeStream(...)."));
+    return MemoryOperationStatus::kError;
+  }
+  if (length > arrayBytes - initialAddress) {
+    length = arrayBytes - initialAddress;
+  }
+  MemoryOperationStatus result = MemoryOperationStatus::kDone;
+  uint32_t offset = 0;
+  while (offset < length) {
+    const uint32_t address = initialAddress + offset;
+    const uint16_t pageAddress = address / pageBytes;
+    const uint16_t column = address % pageBytes;
+    uint32_t bytesInPage = pageBytes - column;
+    if (bytesInPage > length - offset) {
+      bytesInPage = length - offset;
+    }
+    if (isBadBlock(geometry_.blockOf(pageAddress))) {
+      offset += bytesInPage;
+      continue;
+    }
+    if (!trackProgram(pageAddress, F("writeStream"))) {
+      result = MemoryOperationStatus::kError;
+      offset += bytesInPage;
+      continue;
+    }
+    invalidateBuffer();
+    // The buffer is reset to 0xFF, so a range that starts or ends inside a
+    // page leaves the rest of it untouched.
+    beginCommand(WREN_NAND_FLASH);
+    nextCommand(LOAD_PROGRAM_DATA);
+    SPI.transfer16(column);
+    sendChunks(SPI, source, offset, bytesInPage);
+    nextCommand(PROGRAM_EXECUTE);
+    SPI.transfer(0x00); // dummy
+    SPI.transfer16(pageAddress);
+    endCommand();
+    pendingOperation_ = PROGRAM_EXECUTE;
+    MemoryOperationStatus status;
+    while ((status = poll()) == MemoryOperationStatus::kPending) {
+    }
+    if (status == MemoryOperationStatus::kError) {
+      result = MemoryOperationStatus::kError;
+    }
+    offset += bytesInPage;
+  }
+  return result;
+}
+
+// Every instruction follows the previous one with nextCommand(), the
+// memory is only deselected in between.
+MemoryOperationStatus MemoryNANDFlash::rewriteBlock(uint16_t block,
+    ChunkSource& source, NandBlockReport& report) {
+  report.eraseMicros = 0;
+  report.programMicros = 0;
+  report.slowestPageMicros = 0;
+  report.failedPages = 0;
+  report.eraseFailed = false;
+  if (block >= geometry_.blocks) {
+    Serial.println(F("Error: Invalid block passed to NAND Flash's rewriteBlock(...)."));
+    return MemoryOperationStatus::kError;
+  }
+  const uint16_t firstPage = geometry_.firstPageOf(block);
+  const uint16_t pageBytes = geometry_.pageBytes();
+  if (isBadBlock(block)) {
+    return MemoryOperationStatus::kError;
+  }
+  if (programTracker_ != nullptr) {
+    programTracker_->recordErase(block);
+  }
+  invalidateBuffer();
+  beginCommand(WREN_NAND_FLASH);
+  nextCommand(BLOCK_ERASE_NAND_FLASH);
   SPI.transfer(0x00); // dummy
-  SPI.transfer(buffer, 2112);
-  digitalWrite(CHIP_SELECT_NAND_FLASH, HIGH);
-  SPI.endTransaction();
+  SPI.transfer16(firstPage);
+  const uint32_t eraseStart = micros();
+  byte statusRegister = nextCommandStatusWhenReady();
+  report.eraseMicros = micros() - eraseStart;
+  if ((statusRegister & 0x04) == 0x04) {
+    endCommand();
+    report.eraseFailed = true;
+    return MemoryOperationStatus::kError;
+  }
+  MemoryOperationStatus result = MemoryOperationStatus::kDone;
+  const uint32_t programStart = micros();
+  for (uint16_t page = 0; page < geometry_.pagesPerBlock(); ++page) {
+    if (!trackProgram(firstPage + page, F("rewriteBlock"))) {
+      result = MemoryOperationStatus::kError;
+      break;
+    }
+    nextCommand(WREN_NAND_FLASH);
+    nextCommand(LOAD_PROGRAM_DATA);
+    SPI.transfer16(0x00); // column 0
+    sendChunks(SPI, source, (uint32_t)page * pageBytes, pageBytes);
+    nextCommand(PROGRAM_EXECUTE);
+    SPI.transfer(0x00); // dummy
+    SPI.transfer16(firstPage + page);
+    const uint32_t pageStart = micros();
+    statusRegister = nextCommandStatusWhenReady();
+    const uint32_t pageMicros = micros() - pageStart;
+    if (pageMicros > report.slowestPageMicros) {
+      report.slowestPageMicros = pageMicros;
+    }
+    if ((statusRegister & 0x08) == 0x08) {
+      ++report.failedPages;
+      result = MemoryOperationStatus::kError;
+    }
+  }
+  report.programMicros = micros() - programStart;
+  endCommand();
+  return result;
+}
+
+// The pattern is asked for the linear address of every byte, so a page
+// holds the same bytes whichever way it was written.
+MemoryOperationStatus MemoryNANDFlash::fill(const PatternGenerator& pattern,
+    NandFillProgress& progress, uint16_t blocks) {
+  for (uint16_t i = 0; i < blocks && progress.nextBlock() < geometry_.blocks;
+      ++i) {
+    const uint16_t block = progress.nextBlock();
+    if (isBadBlock(block)) {
+      progress.completeBlock(0, 0, false);
+      continue;
+    }
+    PatternSource source(pattern,
+        geometry_.firstPageOf(block) * geometry_.pageBytes());
+    NandBlockReport report;
+    const MemoryOperationStatus status = rewriteBlock(block, source, report);
+    progress.completeBlock(report.eraseMicros, report.slowestPageMicros,
+        status == MemoryOperationStatus::kError);
+  }
+  return progress.nextBlock() < geometry_.blocks ?
+      MemoryOperationStatus::kPending : MemoryOperationStatus::kDone;
+}
+
+// In continuous mode READ takes 3 dummy bytes and no column, and the output
+// starts at column 0 of the page in the buffer.
+MemoryOperationStatus MemoryNANDFlash::readContinuous(uint32_t firstPage,
+    uint32_t pages, ChunkSink& sink) {
+  if (firstPage >= geometry_.pages()) {
+    Serial.println(F("Error: Invalid firstPage passed to NAND Flash's readContinuous(...)."));
+    return MemoryOperationStatus::kError;
+  }
+  if (pages > geometry_.pages() - firstPage) {
+    pages = geometry_.pages() - firstPage;
+  }
+  setContinuousMode();
+  startRead(firstPage);
+  // The buffer ends up holding a later page, or part of it.
+  invalidateBuffer();
+  // Not poll(), the ECC result of the first page is part of the one read
+  // at the end.
+  waitUntilReady();
+  pendingOperation_ = 0;
+  beginCommand(READ_NAND_FLASH);
+  for (uint8_t i = 0; i < 3; ++i) {
+    SPI.transfer(0x00); // dummy
+  }
+  receiveChunks(SPI, sink, 0, pages * geometry_.dataBytes);
+  endCommand();
+  // ECC-1 = 1 if any page of the read had more errors than ECC corrects.
+  const byte statusRegister = readStatusRegiter(STATUS_REGISTER_NAND_FLASH);
+  recordEcc(firstPage, statusRegister);
+  setBufferMode();
+  if ((statusRegister & 0x20) == 0x20) {
+    return MemoryOperationStatus::kError;
+  }
+  return MemoryOperationStatus::kDone;
+}
+
+uint32_t MemoryNANDFlash::verifyContinuous(uint32_t dataAddress,
+    uint32_t length, const PatternGenerator& pattern, MismatchSink& sink) {
+  const uint32_t dataBytes = geometry_.dataAreaBytes();
+  if (dataAddress >= dataBytes) {
+    Serial.println(F("Error: Invalid dataAddress passed to NAND Flash's verifyContinuous(...)."));
+    return 0;
+  }
+  if (length > dataBytes - dataAddress) {
+    length = dataBytes - dataAddress;
+  }
+  // One continuous read per run of good blocks.
+  const uint32_t blockDataBytes =
+      (uint32_t)geometry_.pagesPerBlock() * geometry_.dataBytes;
+  uint32_t mismatches = 0;
+  while (length > 0) {
+    const bool bad = isBadBlock(dataAddress / blockDataBytes);
+    uint32_t runEnd = (dataAddress / blockDataBytes + 1) * blockDataBytes;
+    while (!bad && runEnd - dataAddress < length &&
+        !isBadBlock(runEnd / blockDataBytes)) {
+      runEnd += blockDataBytes;
+    }
+    const uint32_t runLength = runEnd - dataAddress < length ?
+        runEnd - dataAddress : length;
+    if (!bad) {
+      mismatches += verifyContinuousRun(dataAddress, runLength, pattern, sink);
+    }
+    dataAddress += runLength;
+    length -= runLength;
+  }
+  return mismatches;
+}
+
+uint32_t MemoryNANDFlash::verifyContinuousRun(uint32_t dataAddress,
+    uint32_t length, const PatternGenerator& pattern, MismatchSink& sink) {
+  uint32_t page = dataAddress >> geometry_.columnShift;
+  uint16_t column = dataAddress & (geometry_.dataBytes - 1);
+  setContinuousMode();
+  startRead(page);
+  invalidateBuffer(); // see readContinuous()
+  waitUntilReady();
+  pendingOperation_ = 0;
+  const uint32_t firstPage = page;
+  beginCommand(READ_NAND_FLASH);
+  for (uint8_t i = 0; i < 3; ++i) {
+    SPI.transfer(0x00); // dummy
+  }
+  for (uint16_t i = 0; i < column; ++i) {
+    SPI.transfer(0x00); // before dataAddress
+  }
+  SpiStream stream(SPI);
+  uint32_t mismatches = 0;
+  while (length > 0) {
+    uint32_t bytesInPage = geometry_.dataBytes - column;
+    if (bytesInPage > length) {
+      bytesInPage = length;
+    }
+    mismatches += streamVerify(stream, page * geometry_.pageBytes() + column,
+        bytesInPage, 0xFFFFFFFF, pattern, sink);
+    length -= bytesInPage;
+    ++page;
+    column = 0;
+  }
+  endCommand();
+  recordEcc(firstPage, readStatusRegiter(STATUS_REGISTER_NAND_FLASH));
+  setBufferMode();
+  return mismatches;
+}
+
+// A fresh load of every page, the one in the buffer might have been loaded
+// before the upsets being looked for.
+uint32_t MemoryNANDFlash::verifyEcc(uint32_t initialAddress, uint32_t length,
+    const PatternGenerator& pattern, MismatchSink& sink) {
+  const uint32_t arrayBytes = geometry_.arrayBytes();
+  const uint16_t pageBytes = geometry_.pageBytes();
+  if (initialAddress >= arrayBytes) {
+    Serial.println(F("Error: Invalid initialAddress passed to NAND Flash's verifyEcc(...)."));
+    return 0;
+  }
+  if (length > arrayBytes - initialAddress) {
+    length = arrayBytes - initialAddress;
+  }
+  uint32_t mismatches = 0;
+  uint32_t address = initialAddress;
+  const uint32_t endAddress = initialAddress + length;
+  while (address < endAddress) {
+    const uint16_t pageAddress = address / pageBytes;
+    const uint16_t column = address % pageBytes;
+    uint32_t bytesInPage = pageBytes - column;
+    if (bytesInPage > endAddress - address) {
+      bytesInPage = endAddress - address;
+    }
+    if (isBadBlock(geometry_.blockOf(pageAddress))) {
+      address += bytesInPage;
+      continue;
+    }
+    startRead(pageAddress);
+    MemoryOperationStatus status;
+    while ((status = poll()) == MemoryOperationStatus::kPending) {
+    }
+    if (status == MemoryOperationStatus::kError) {
+      mismatches += verifyBuffer(address, bytesInPage, pattern, sink);
+    }
+    address += bytesInPage;
+  }
+  return mismatches;
+}
+
+// Always a fresh load, like verifyEcc().
+uint16_t MemoryNANDFlash::countPageFlips(uint32_t pageAddress,
+    const PatternGenerator& pattern, MismatchSink* positions) {
+  if (pageAddress >= geometry_.pages()) {
+    Serial.println(F("Error: Invalid pageAddress passed to NAND Flash's countPageFlips(...)."));
+    return 0;
+  }
+  if (isBadBlock(geometry_.blockOf(pageAddress))) {
+    return 0;
+  }
+  startRead(pageAddress);
+  while (poll() == MemoryOperationStatus::kPending) {
+  }
+  FlipCountSink sink(pattern, pageAddress * geometry_.pageBytes(), positions);
+  beginBufferRead(0);
+  receiveBuffer(sink, 0, geometry_.pageBytes());
+  endBufferRead();
+  return sink.flips();
 }
 
 void MemoryNANDFlash::eraseBlock(size_t pageAddress) {
-  if (pageAddress > 1023 || pageAddress < 0) {
-    Serial.println("Error: Invalid pageAddress passed to NAND Flash's eraseBlock(...).");
+  startErase(pageAddress);
+}
+
+void MemoryNANDFlash::writePage(uint8_t* buffer, size_t pageAddress) {
+  startWrite(buffer, pageAddress);
+}
+
+MemoryOperationStatus MemoryNANDFlash::startRead(uint32_t pageAddress) {
+  if (pageAddress >= geometry_.pages()) {
+    Serial.println(F("Error: Invalid pageAddress passed to NAND Flash's startRead(...)."));
+    return MemoryOperationStatus::kError;
   }
-  SPI.beginTransaction(SPISettings(SPI_TRANSFER_SPEED_NAND_FLASH, MSBFIRST, SPI_MODE0));
-  digitalWrite(CHIP_SELECT_NAND_FLASH, LOW);
-  SPI.transfer(BLOCK_ERASE_NAND_FLASH);
+  beginCommand(PAGE_READ_NAND_FLASH);
   SPI.transfer(0x00); // dummy
   SPI.transfer16(pageAddress);
-  digitalWrite(CHIP_SELECT_NAND_FLASH, HIGH);
-  SPI.endTransaction();
+  endCommand();
+  pendingOperation_ = PAGE_READ_NAND_FLASH;
+  residentPage_ = pageAddress;
+  residentUncorrectable_ = false;
+  return MemoryOperationStatus::kPending;
 }
 
 // 2112 bytes is the size of a page (2^11 bytes + ECC's 64 bytes)
 // I do random load instead of load just in case some byte to write is wrong,
 // in which case, the random version sets it to 0xFF. normal load works too.
-void MemoryNANDFlash::writePage(uint8_t* buffer, size_t pageAddress) {
-  if (pageAddress > 65535 || pageAddress < 0) {
-    Serial.println("Error: Invalid pageAddress passed to NAND Flash's writePage(...).");
-    return;
+// Bytes are sent one by one because the buffer version of transfer would
+// replace the caller's bytes with the received ones.
+// Write enable, load and execute share a single transaction.
+MemoryOperationStatus MemoryNANDFlash::startWrite(uint8_t* buffer,
+    uint32_t pageAddress) {
+  if (pageAddress >= geometry_.pages()) {
+    Serial.println(F("Error: Invalid pageAddress passed to NAND Flash's startWrite(...)."));
+    return MemoryOperationStatus::kError;
+  }
+  if (isBadBlock(geometry_.blockOf(pageAddress)) || !trackProgram(pageAddress, F("startWrite"))) {
+    return MemoryOperationStatus::kError;
   }
-  SPI.beginTransaction(SPISettings(SPI_TRANSFER_SPEED_NAND_FLASH, MSBFIRST, SPI_MODE0));
-  digitalWrite(CHIP_SELECT_NAND_FLASH, LOW);
-  SPI.transfer(RANDOM_LOAD_PROGRAM_DATA);
+  invalidateBuffer(); // overwritten by the load
+  beginCommand(WREN_NAND_FLASH);
+  nextCommand(RANDOM_LOAD_PROGRAM_DATA);
+  SPI.transfer16(0x00); // start from address 0 of buffer page, no dummy byte
+  for (size_t i = 0; i < geometry_.pageBytes(); ++i) {
+    SPI.transfer(buffer[i]);
+  }
+  nextCommand(PROGRAM_EXECUTE);
   SPI.transfer(0x00); // dummy
-  SPI.transfer16(0x00); // start from address 0 of buffer page
-  SPI.transfer(buffer, 2112);
-  digitalWrite(CHIP_SELECT_NAND_FLASH, HIGH);
-  delay(1); // unsure if needed
-  digitalWrite(CHIP_SELECT_NAND_FLASH, LOW);
-  SPI.transfer(PROGRAM_EXECUTE);
+  SPI.transfer16(pageAddress);
+  endCommand();
+  pendingOperation_ = PROGRAM_EXECUTE;
+  return MemoryOperationStatus::kPending;
+}
+
+// Load program data, unlike the random load, resets the buffer to 0xFF
+// before taking the bytes at column.
+MemoryOperationStatus MemoryNANDFlash::startProgramPartial(uint32_t pageAddress,
+    uint16_t column, const uint8_t* data, uint16_t size) {
+  if (pageAddress >= geometry_.pages()) {
+    Serial.println(F("Error: Invalid pageAddress passed to NAND Flash's startProgramPartial(...)."));
+    return MemoryOperationStatus::kError;
+  }
+  if (column >= geometry_.pageBytes() || size > geometry_.pageBytes() - column) {
+    Serial.println(F("Error: Invalid range passed to NAND Flash's startProgramPartial(...)."));
+    return MemoryOperationStatus::kError;
+  }
+  if (isBadBlock(geometry_.blockOf(pageAddress)) ||
+      !trackProgram(pageAddress, F("startProgramPartial"))) {
+    return MemoryOperationStatus::kError;
+  }
+  invalidateBuffer();
+  beginCommand(WREN_NAND_FLASH);
+  nextCommand(LOAD_PROGRAM_DATA);
+  SPI.transfer16(column);
+  for (uint16_t i = 0; i < size; ++i) {
+    SPI.transfer(data[i]);
+  }
+  nextCommand(PROGRAM_EXECUTE);
   SPI.transfer(0x00); // dummy
   SPI.transfer16(pageAddress);
-  digitalWrite(CHIP_SELECT_NAND_FLASH, HIGH);
-  SPI.endTransaction();
+  endCommand();
+  pendingOperation_ = PROGRAM_EXECUTE;
+  return MemoryOperationStatus::kPending;
+}
+
+MemoryOperationStatus MemoryNANDFlash::startErase(uint32_t pageAddress) {
+  if (pageAddress >= geometry_.pages()) {
+    Serial.println(F("Error: Invalid pageAddress passed to NAND Flash's startErase(...)."));
+    return MemoryOperationStatus::kError;
+  }
+  if (isBadBlock(geometry_.blockOf(pageAddress))) {
+    return MemoryOperationStatus::kError;
+  }
+  // The buffer keeps its bytes, but they may no longer be in the array.
+  invalidateBuffer();
+  if (programTracker_ != nullptr) {
+    programTracker_->recordErase(geometry_.blockOf(pageAddress));
+  }
+  beginCommand(WREN_NAND_FLASH);
+  nextCommand(BLOCK_ERASE_NAND_FLASH);
+  SPI.transfer(0x00); // dummy
+  SPI.transfer16(pageAddress);
+  endCommand();
+  pendingOperation_ = BLOCK_ERASE_NAND_FLASH;
+  return MemoryOperationStatus::kPending;
+}
+
+// SR-3: BUSY is bit 0, E-FAIL bit 2, P-FAIL bit 3 and ECC-1, ECC-0 bits 5
+// and 4. ECC-1 = 1 means the page had more errors than ECC could correct.
+MemoryOperationStatus MemoryNANDFlash::poll() {
+  const byte statusRegister = readStatusRegiter(STATUS_REGISTER_NAND_FLASH);
+  if ((statusRegister & 0x01) == 0x01) {
+    return MemoryOperationStatus::kPending;
+  }
+  const uint8_t finishedOperation = pendingOperation_;
+  pendingOperation_ = 0;
+  if (finishedOperation == PAGE_READ_NAND_FLASH) {
+    residentUncorrectable_ = (statusRegister & 0x20) == 0x20;
+    recordEcc(residentPage_, statusRegister);
+  }
+  if ((finishedOperation == PROGRAM_EXECUTE && (statusRegister & 0x08) == 0x08) ||
+      (finishedOperation == BLOCK_ERASE_NAND_FLASH && (statusRegister & 0x04) == 0x04) ||
+      (finishedOperation == PAGE_READ_NAND_FLASH && (statusRegister & 0x20) == 0x20)) {
+    return MemoryOperationStatus::kError;
+  }
+  return MemoryOperationStatus::kDone;
+}
+
+// The buffer version of transfer leaves the received bytes in buffer.
+void MemoryNANDFlash::readBuffer(uint8_t* buffer, uint16_t column,
+    uint16_t size) {
+  if (column >= geometry_.pageBytes() || size > geometry_.pageBytes() - column) {
+    Serial.println(F("Error: Invalid range passed to NAND Flash's readBuffer(...)."));
+    return;
+  }
+  beginBufferRead(column);
+  if (readBus_ == nullptr) {
+    SPI.transfer(buffer, size);
+  } else {
+    const uint8_t lanes = kReadInstructions[(uint8_t)readMode_].dataLanes;
+    while (size > 0) {
+      const uint8_t chunk = size < 255 ? size : 255;
+      readBus_->receive(buffer, chunk, lanes);
+      buffer += chunk;
+      size -= chunk;
+    }
+  }
+  endBufferRead();
+}
+
+bool MemoryNANDFlash::setReadBus(LaneBus* bus, NandReadMode mode) {
+  if (bus != nullptr &&
+      kReadInstructions[(uint8_t)mode].dataLanes > bus->maxLanes()) {
+    Serial.println(F("Error: Read mode wider than the bus passed to NAND Flash's setReadBus(...)."));
+    return false;
+  }
+  readBus_ = bus;
+  readMode_ = mode;
+  return true;
+}
+
+// Over SPI it stays READ, 2 bytes of column and a dummy byte.
+void MemoryNANDFlash::beginBufferRead(uint16_t column) {
+  if (readBus_ == nullptr) {
+    beginCommand(READ_NAND_FLASH);
+    SPI.transfer16(column);
+    SPI.transfer(0x00); // dummy
+    return;
+  }
+  const NandReadInstruction& instruction =
+      kReadInstructions[(uint8_t)readMode_];
+  readBus_->beginTransaction();
+  ChipSelect<CHIP_SELECT_NAND_FLASH>::select();
+  readBus_->send(&instruction.opcode, 1, 1);
+  const uint8_t header[4] = {(uint8_t)(column >> 8), (uint8_t)column, 0x00,
+      0x00};
+  readBus_->send(header, 2 + instruction.dummyBytes, instruction.addressLanes);
+}
+
+void MemoryNANDFlash::receiveBuffer(ChunkSink& sink, uint32_t offset,
+    uint32_t length) {
+  if (readBus_ == nullptr) {
+    receiveChunks(SPI, sink, offset, length);
+  } else {
+    receiveChunks(*readBus_, kReadInstructions[(uint8_t)readMode_].dataLanes,
+        sink, offset, length);
+  }
+}
+
+void MemoryNANDFlash::endBufferRead() {
+  if (readBus_ == nullptr) {
+    endCommand();
+    return;
+  }
+  ChipSelect<CHIP_SELECT_NAND_FLASH>::deselect();
+  readBus_->endTransaction();
+}
+
+// READ is followed by the 2 bytes of the column and a dummy byte.
+bool MemoryNANDFlash::addReadBuffer(SpiCommandBatch& batch, uint8_t* buffer,
+    uint16_t column, uint16_t size) {
+  if (column >= geometry_.pageBytes() || size > geometry_.pageBytes() - column) {
+    Serial.println(F("Error: Invalid range passed to NAND Flash's addReadBuffer(...)."));
+    return false;
+  }
+  const uint8_t header[] = {READ_NAND_FLASH, (uint8_t)(column >> 8),
+      (uint8_t)column, 0x00};
+  return batch.add(header, sizeof(header),
+      SpiCommandBatch::DataPhase::kReceive, buffer, size);
+}
+
+void MemoryNANDFlash::execute(const SpiCommandBatch& batch) {
+  batch.execute<CHIP_SELECT_NAND_FLASH>(SPI, settings_);
 }
 
 byte MemoryNANDFlash::readStatusRegiter(size_t address) {
-  if (address > 3 || address < 0) {
-    Serial.println("Error: Invalid adddress, NAND FLASH'S readStatusRegister().");
+  if (address != PROTECTION_REGISTER_NAND_FLASH &&
+      address != CONFIGURATION_REGISTER_NAND_FLASH &&
+      address != STATUS_REGISTER_NAND_FLASH) {
+    Serial.println(F("Error: Invalid adddress, NAND FLASH'S readStatusRegister()."));
     return 0x00;
   }
-  SPI.beginTransaction(SPISettings(SPI_TRANSFER_SPEED_NAND_FLASH, MSBFIRST, SPI_MODE0));
-  digitalWrite(CHIP_SELECT_NAND_FLASH, LOW);
-  SPI.transfer(RDSR_NAND_FLASH);
+  beginCommand(RDSR_NAND_FLASH);
   SPI.transfer(address);
   byte registerContent = SPI.transfer(0x00); // dummy
-  digitalWrite(CHIP_SELECT_NAND_FLASH, HIGH);
-  SPI.endTransaction();
+  endCommand();
   return registerContent;
 }
 
-/**
- * send opcode byte, then dummy byte, then extract page address for a buffer
- * page read which is required before accessing the specific byte, so shift
- * 11 bits to the right (27 relevant bit address). Then the buffer is
- * ready for reading after the BUSY flag is back to 0.
- */
 void MemoryNANDFlash::loadPageIntoBuffer(size_t pageAddress) {
-  if (pageAddress > 65535 || pageAddress < 0) {
-    Serial.println("Error: Invalid pageAddress passed to NAND Flash's loadPageIntoBuffer(...).");
-    return;
+  startRead(pageAddress);
+}
+
+MemoryOperationStatus MemoryNANDFlash::ensurePageInBuffer(uint16_t pageAddress) {
+  if (!isPageInBuffer(pageAddress)) {
+    startRead(pageAddress);
+    while (poll() == MemoryOperationStatus::kPending) {
+    }
   }
-  SPI.beginTransaction(SPISettings(SPI_TRANSFER_SPEED_NAND_FLASH, MSBFIRST, SPI_MODE0));
-  digitalWrite(CHIP_SELECT_NAND_FLASH, LOW);
-  SPI.transfer(PAGE_READ_NAND_FLASH);
-  SPI.transfer(0x00);
-  SPI.transfer16(pageAddress);
-  digitalWrite(CHIP_SELECT_NAND_FLASH, HIGH);
+  return residentUncorrectable_ ? MemoryOperationStatus::kError
+                                : MemoryOperationStatus::kDone;
+}
+
+bool MemoryNANDFlash::trackProgram(uint32_t pageAddress,
+    const __FlashStringHelper* method) {
+  if (programTracker_ == nullptr) {
+    return true;
+  }
+  const uint16_t block = geometry_.blockOf(pageAddress);
+  const uint8_t page = geometry_.pageInBlock(pageAddress);
+  if (!programTracker_->canProgram(block, page)) {
+    Serial.print(F("Error: Page out of order, programmed 4 times or no room in the program tracker, NAND Flash's "));
+    Serial.print(method);
+    Serial.println(F("(...)."));
+    return false;
+  }
+  programTracker_->recordProgram(block, page);
+  return true;
+}
+
+// The marker is read raw, ECC would take the spare byte for its own.
+uint16_t MemoryNANDFlash::scanBadBlocks(NandBadBlockTable& table) {
+  table.clear();
+  disableEcc();
+  for (uint16_t block = 0; block < geometry_.blocks; ++block) {
+    startRead(geometry_.firstPageOf(block));
+    while (poll() == MemoryOperationStatus::kPending) {
+    }
+    uint8_t marker = 0xFF;
+    readBuffer(&marker, geometry_.dataBytes, 1);
+    if (marker != 0xFF) {
+      table.markBad(block);
+    }
+  }
+  enableEcc();
+  return table.badBlocks();
+}
+
+// LUT-F is the seventh bit from the right of SR-3, 01000000.
+bool MemoryNANDFlash::isLookUpTableFull() {
+  return (readStatusRegiter(STATUS_REGISTER_NAND_FLASH) & 0x40) == 0x40;
+}
+
+// The copies are read one at a time through the parser, 256 bytes would not
+// fit comfortably in the RAM of the Nano.
+bool MemoryNANDFlash::detectGeometry() {
+  const uint8_t manufacturerId = readJedecId() >> 16;
+  loadOtpPage(1);
+  NandParameterPage parameterPage;
+  NandGeometry detected;
+  bool found = false;
+  for (uint8_t copy = 0; copy < 3 && !found; ++copy) {
+    parameterPage.clear();
+    beginCommand(READ_NAND_FLASH);
+    SPI.transfer16(copy * NandParameterPage::kCopyBytes);
+    SPI.transfer(0x00); // dummy
+    receiveChunks(SPI, parameterPage, 0, NandParameterPage::kCopyBytes);
+    endCommand();
+    found = parameterPage.geometry(detected);
+  }
+  leaveOtpMode();
+  if (!found) {
+    Serial.println(F("Error: No valid copy of the parameter page, NAND Flash's detectGeometry()."));
+    return false;
+  }
+  if (parameterPage.manufacturerId() != manufacturerId) {
+    Serial.println(F("Error: Parameter page and JEDEC ID manufacturers differ, NAND Flash's detectGeometry()."));
+    return false;
+  }
+  if (!detected.isSupported()) {
+    Serial.println(F("Error: Geometry larger than the driver supports, NAND Flash's detectGeometry()."));
+    return false;
+  }
+  geometry_ = detected;
+  return true;
+}
+
+// JEDEC ID is followed by a dummy byte, then manufacturer and device ID.
+uint32_t MemoryNANDFlash::readJedecId() {
+  beginCommand(JEDEC_ID_NAND_FLASH);
+  SPI.transfer(0x00); // dummy
+  uint32_t id = 0;
+  for (uint8_t i = 0; i < 3; ++i) {
+    id = (id << 8) | SPI.transfer(0x00);
+  }
+  endCommand();
+  return id;
+}
+
+// Each copy is 16 bytes of ID and 16 of complement, 32 bytes apart.
+bool MemoryNANDFlash::readUniqueId(uint8_t* id) {
+  loadOtpPage(0);
+  bool found = false;
+  for (uint8_t copy = 0; copy < 16 && !found; ++copy) {
+    beginCommand(READ_NAND_FLASH);
+    SPI.transfer16(copy * 32);
+    SPI.transfer(0x00); // dummy
+    found = true;
+    for (uint8_t i = 0; i < 16; ++i) {
+      id[i] = SPI.transfer(0x00);
+    }
+    for (uint8_t i = 0; i < 16; ++i) {
+      if ((uint8_t)(id[i] ^ SPI.transfer(0x00)) != 0xFF) {
+        found = false;
+      }
+    }
+    endCommand();
+  }
+  leaveOtpMode();
+  return found;
+}
+
+// OTP-E is the seventh bit from the right of SR-2, 01000000. Waiting without
+// poll() keeps the OTP page out of the ECC histogram.
+void MemoryNANDFlash::loadOtpPage(uint8_t page) {
+  byte configRegister = readStatusRegiter(CONFIGURATION_REGISTER_NAND_FLASH);
+  beginCommand(WRSR_NAND_FLASH);
+  SPI.transfer(CONFIGURATION_REGISTER_NAND_FLASH);
+  SPI.transfer(configRegister | 0x40);
+  nextCommand(PAGE_READ_NAND_FLASH);
+  SPI.transfer(0x00); // dummy
+  SPI.transfer16(page);
+  endCommand();
+  invalidateBuffer();
+  waitUntilReady();
+}
+
+void MemoryNANDFlash::leaveOtpMode() {
+  byte configRegister = readStatusRegiter(CONFIGURATION_REGISTER_NAND_FLASH);
+  beginCommand(WRSR_NAND_FLASH);
+  SPI.transfer(CONFIGURATION_REGISTER_NAND_FLASH);
+  SPI.transfer(configRegister & 0xBF);
+  endCommand();
+}
+
+// ECC-1 and ECC-0 are bits 5 and 4 of SR-3.
+void MemoryNANDFlash::recordEcc(uint32_t pageAddress, byte statusRegister) {
+  if (eccHistogram_ != nullptr) {
+    eccHistogram_->record(geometry_.blockOf(pageAddress),
+        (statusRegister >> 4) & 0x03);
+  }
+}
+
+void MemoryNANDFlash::beginCommand(uint8_t opcode) {
+  SPI.beginTransaction(settings_);
+  ChipSelect<CHIP_SELECT_NAND_FLASH>::select();
+  SPI.transfer(opcode);
+}
+
+void MemoryNANDFlash::nextCommand(uint8_t opcode) {
+  ChipSelect<CHIP_SELECT_NAND_FLASH>::deselect();
+  ChipSelect<CHIP_SELECT_NAND_FLASH>::select();
+  SPI.transfer(opcode);
+}
+
+byte MemoryNANDFlash::nextCommandStatusWhenReady() {
+  nextCommand(RDSR_NAND_FLASH);
+  SPI.transfer(STATUS_REGISTER_NAND_FLASH);
+  byte statusRegister = SPI.transfer(0x00);
+  while ((statusRegister & 0x01) == 0x01) {
+    statusRegister = SPI.transfer(0x00);
+  }
+  return statusRegister;
+}
+
+void MemoryNANDFlash::endCommand() {
+  ChipSelect<CHIP_SELECT_NAND_FLASH>::deselect();
   SPI.endTransaction();
 }
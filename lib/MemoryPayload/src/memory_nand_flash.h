@@ -104,9 +104,10 @@
  * ECC-E = 1 ECC is on. (default) Read instruction checks ECC addresss of each
  *    page for data validation.
  *
- * BUFF = 0 means Buffer Read Mode. Partial page read starting from byte address
- *    within block. Stops after page fully read (output line to high impedance).
- * BUFF = 1 means Continuos Read Mode; full page read independently of the byte
+ * BUFF = 1 means Buffer Read Mode. (default) Partial page read starting from
+ *    byte address within block. Stops after page fully read (output line to
+ *    high impedance).
+ * BUFF = 0 means Continuos Read Mode; full page read independently of the byte
  *    address within block. Next page after finish current page.
  *
  * ### SR-3 (Status Only Register)
@@ -172,9 +173,25 @@
 #include <Arduino.h>
 #include <stdint.h> // to avoid uint8_t unknown type syntax highlight error
 #include <Array.h>
+#include <SPI.h>
+#include "./bit_flips.h"
+#include "./chip_select.h"
+#include "./chunk_stream.h"
+#include "./memory_operation_status.h"
+#include "./mismatch_sink.h"
+#include "./nand_bad_block_table.h"
+#include "./nand_ecc_histogram.h"
+#include "./nand_fill_progress.h"
+#include "./nand_geometry.h"
+#include "./nand_program_tracker.h"
+#include "./pattern_generator.h"
+#include "./spi_command_batch.h"
+#include "./spi_lanes.h"
 
 // Pins
+#ifndef CHIP_SELECT_NAND_FLASH
 #define CHIP_SELECT_NAND_FLASH 3
+#endif
 
 // opcodes used
 #define WREN_NAND_FLASH 6
@@ -184,14 +201,66 @@
 #define READ_NAND_FLASH 3
 #define PAGE_READ_NAND_FLASH 19
 #define BLOCK_ERASE_NAND_FLASH 216
+#define LOAD_PROGRAM_DATA 2
 #define RANDOM_LOAD_PROGRAM_DATA 132
 #define PROGRAM_EXECUTE 16
+#define JEDEC_ID_NAND_FLASH 159
+#define FAST_READ_NAND_FLASH 11
+#define FAST_READ_DUAL_OUTPUT_NAND_FLASH 59
+#define FAST_READ_QUAD_OUTPUT_NAND_FLASH 107
+#define FAST_READ_DUAL_IO_NAND_FLASH 187
+#define FAST_READ_QUAD_IO_NAND_FLASH 235
+
+// status register addresses
+#define PROTECTION_REGISTER_NAND_FLASH 0xA0 // SR-1
+#define CONFIGURATION_REGISTER_NAND_FLASH 0xB0 // SR-2
+#define STATUS_REGISTER_NAND_FLASH 0xC0 // SR-3
+
+// 2048 data bytes and 64 spare bytes, the largest page the driver takes (see
+// MemoryNANDFlash::detectGeometry()).
+#define PAGE_SIZE_NAND_FLASH 2112
 
 #define SPI_TRANSFER_SPEED_NAND_FLASH 104000000 // 104 MHz
 
+/**
+ * @brief Read instructions of the buffer for MemoryNANDFlash::setReadBus(),
+ *    lanes of the column and of the data:
+ *  - kFast: FAST READ (0Bh), 1 and 1.
+ *  - kDualOutput: FAST READ DUAL OUTPUT (3Bh), 1 and 2.
+ *  - kQuadOutput: FAST READ QUAD OUTPUT (6Bh), 1 and 4.
+ *  - kDualIo: FAST READ DUAL I/O (BBh), 2 and 2.
+ *  - kQuadIo: FAST READ QUAD I/O (EBh), 4 and 4.
+ * The opcode always takes 1 lane.
+ */
+enum class NandReadMode : uint8_t {
+  kFast,
+  kDualOutput,
+  kQuadOutput,
+  kDualIo,
+  kQuadIo,
+};
+
+/**
+ * @brief What MemoryNANDFlash::rewriteBlock() measured, times from the
+ *    instruction to BUSY = 0 as seen on SR-3.
+ */
+struct NandBlockReport {
+  uint32_t eraseMicros;
+  uint32_t programMicros; // the 64 pages, loads included
+  uint32_t slowestPageMicros; // tPROG of the slowest page
+  uint8_t failedPages; // P-FAIL = 1
+  bool eraseFailed; // E-FAIL = 1, no page is programmed then
+};
+
 class MemoryNANDFlash {
 public:
-  MemoryNANDFlash() {}
+  MemoryNANDFlash()
+      : settings_(SPI_TRANSFER_SPEED_NAND_FLASH, MSBFIRST, SPI_MODE0),
+        pendingOperation_(0), residentPage_(kNoResidentPage),
+        residentUncorrectable_(false), geometry_(kW25N01GVGeometry),
+        eccHistogram_(nullptr), badBlockTable_(nullptr),
+        programTracker_(nullptr), readBus_(nullptr),
+        readMode_(NandReadMode::kFast) {}
   ~MemoryNANDFlash() {}
 
   /**
@@ -264,20 +333,90 @@ public:
    */
   void setBufferMode();
 
+  /**
+   * @brief Clear ECC-E at SR-2, so that page loads stop correcting errors
+   *    and the whole 2112 bytes, spare area included, are output as stored:
+   *    the raw mode of countPageFlips(). The page in the buffer is
+   *    forgotten, it was loaded with the other setting.
+   *
+   * NOTE: with ECC-E = 0 a program leaves the 64 spare bytes as loaded
+   * instead of writing the ECC into them.
+   *
+   * @pre Memory is not busy
+   */
+  void disableEcc();
+
+  /**
+   * @brief Set ECC-E at SR-2 back to its power up value, 1.
+   *
+   * @pre Memory is not busy
+   */
+  void enableEcc();
+
+  /**
+   * @brief Clear the BP3..BP0 and TB bits of SR-1 so that every block can be
+   *    programmed and erased.
+   *
+   * SR-1 is volatile and powers up with the whole array protected, so this is
+   * required once after every power up before writing.
+   *
+   * @pre Memory is not busy
+   */
+  void disableBlockProtection();
+
+  /**
+   * @brief Read the parameter page (see nand_geometry.h) and address the
+   *    array with the geometry it describes from now on, so that a different
+   *    part on the board is not written past its end or with the wrong page
+   *    size. Call once at startup, before the bad block scan.
+   *
+   * OTP-E at SR-2 is set for the page data read of the parameter page and
+   * cleared afterwards. The first of its 3 copies that passes its CRC is
+   * used, and its manufacturer has to match readJedecId().
+   *
+   * @return false, printing why and keeping the W25N01GV geometry, if no
+   *    copy can be trusted or the geometry does not fit the driver
+   *    (NandGeometry::isSupported()).
+   * @pre Memory is not busy
+   */
+  bool detectGeometry();
+
+  const NandGeometry& geometry() const { return geometry_; }
+
+  /**
+   * @brief JEDEC ID instruction: manufacturer (0xEF for Winbond) in bits 23
+   *    to 16 and the 2 bytes of the device ID (0xAA21) below.
+   */
+  uint32_t readJedecId();
+
+  /**
+   * @brief Read the 16 byte unique ID of the chip from the unique ID page
+   *    (page 0 with OTP-E = 1), where it is stored 16 times, each one
+   *    followed by its complement. The first copy that matches its
+   *    complement is used.
+   *
+   * @return false if no copy matches, id then holds the last one.
+   * @pre Memory is not busy
+   */
+  bool readUniqueId(uint8_t* id);
+
   /**
    * @brief Read a single byte. Most significant is read first.
    *
-   * Puts the memory in Continuous mode and reads.
-   * 
+   * The page of address is loaded into the buffer only if it is not the one
+   * already there (see isPageInBuffer()), so spot checks of several bytes of
+   * a page cost a single READ each after the first.
+   *
    * NOTE: take into account that a page contains 64 bytes for ECC, and the
    * automatic address increment can output those 64 bytes, which are at the
    * highest address of the page.
    * 
    * TODO: check if the 64 ECC bytes can be accessed.
    *
-   * @param address lower than 2^27, since the eeprom's memory array is of
-   *  1 GBit.
+   * @param address page address << geometry().columnShift | column, page
+   *    address << 11 | column for the W25N01GV.
    * @pre 0 <= address <= 2^27 - 1
+   * @pre Memory is not busy
    * @pre Buffer read mode is on (BUF=1 at SR-2) (required in order to access
    *    specific byte instead of always from start of page)
    */
@@ -297,6 +436,8 @@ public:
    *    in the memory array.
    * @param buffer destination of the bytes being read from the NAND.
    * @param size amount of bytes to read.
+   * The page is only loaded if it is not already in the buffer.
+   *
    * @pre 0 <= pageAddress <= 2^16 - 1
    * @pre length(buffer) >= 2112
    * @pre Memory is not busy
@@ -305,6 +446,202 @@ public:
    */
   void readPage(size_t pageAddress, uint8_t* buffer);
 
+  /**
+   * @brief Compare length consecutive bytes of the array against the bytes
+   *    the pattern expects, without storing what was read.
+   *
+   * Addresses are linear over the 2112 bytes of every page, spare area
+   * included: the byte at column c of page p is at p * 2112 + c, so the
+   * whole array is 0 to 65536 * 2112 - 1 and a page is written with
+   * pattern.fill(p * 2112, buffer, 2112). 2112 and 65536 are the page size
+   * and pages of geometry(). Each page touched is loaded into
+   * the buffer and read with a single READ instruction, comparing each byte
+   * while the next one shifts in (see spi_stream.h).
+   *
+   * NOTE: with ECC-E = 1 (power up value) the memory corrects a single bit
+   * error per sector before it reaches the bus, so those flips are not seen.
+   *
+   * @param initialAddress lower than geometry().arrayBytes().
+   * @param length amount of bytes to verify, stops at the end of the array.
+   * @param pattern gives the expected byte of every address.
+   * @param sink records the address and XOR mask of every mismatch.
+   * @return amount of bytes that did not match.
+   * @pre Memory is not busy
+   * @pre Buffer read mode is on (BUF=1 at SR-2)
+   */
+  uint32_t verifyRange(uint32_t initialAddress, uint32_t length,
+      const PatternGenerator& pattern, MismatchSink& sink);
+
+  /**
+   * @brief Same as verifyRange() for bytes of the page that is already in
+   *    the buffer, so that the page load can be started with
+   *    loadPageIntoBuffer() and polled with isBusy() by the caller.
+   *
+   * @param address linear address (see verifyRange()) of the first byte,
+   *    inside the page loaded in the buffer.
+   * @param length amount of bytes to verify, up to the end of the page.
+   * @return amount of bytes that did not match.
+   * @pre The page of address is loaded in the buffer
+   * @pre Memory is not busy
+   * @pre Buffer read mode is on (BUF=1 at SR-2)
+   */
+  uint32_t verifyBuffer(uint32_t address, uint16_t length,
+      const PatternGenerator& pattern, MismatchSink& sink);
+
+  /**
+   * @brief Read length bytes from the linear address initialAddress (see
+   *    verifyRange()), handing them to sink kStreamChunkBytes at a time
+   *    (see chunk_stream.h). Each page touched is loaded into the buffer and
+   *    read with a single READ instruction.
+   *
+   * @param length any amount of bytes, stops at the end of the array.
+   * @return kDone, or kError if initialAddress is invalid or a page had
+   *    more errors than ECC could correct (its bytes are still read).
+   * @pre Memory is not busy
+   * @pre Buffer read mode is on (BUF=1 at SR-2)
+   */
+  MemoryOperationStatus readStream(uint32_t initialAddress, uint32_t length,
+      ChunkSink& sink);
+
+  /**
+   * @brief Program length bytes from the linear address initialAddress,
+   *    asking source for them kStreamChunkBytes at a time. Each page touched
+   *    gets one load and program execute, waited for before the next page.
+   *
+   * The load resets the buffer to 0xFF (load program data), so the bytes
+   * of a page outside the range stay as they were after the erase.
+   *
+   * @param length any amount of bytes, stops at the end of the array.
+   * @return kDone, or kError if initialAddress is invalid or a program
+   *    failed (P-FAIL), in which case the rest of the range is still
+   *    programmed.
+   * @pre The pages of the range have been erased beforehand
+   * @pre Memory is not busy
+   */
+  MemoryOperationStatus writeStream(uint32_t initialAddress, uint32_t length,
+      ChunkSource& source);
+
+  /**
+   * @brief Erase a block and program its 64 pages, lowest first, with the
+   *    2112 bytes source gives for each one (offset page * 2112 from the
+   *    start of the block), all in a single SPI transaction.
+   *
+   * After the erase and after each program execute the status register is
+   * read continuously, as waitUntilReady() does, and the SR-3 byte that
+   * shows BUSY = 0 already holds E-FAIL or P-FAIL, so neither costs another
+   * instruction. The load of the next page follows in the same transaction
+   * as soon as BUSY goes to 0; the chip has a single data buffer and takes
+   * no load while busy, so that is as close as a load can get to the
+   * previous program. The block is then rewritten at the pace of tBERS and
+   * tPROG plus the SPI time of the loads.
+   *
+   * NOTE: the bus stays taken for the whole block (about 20 ms), use
+   * NandWriteTask (see bus_tasks.h) to share it while programming.
+   *
+   * @param block lower than geometry().blocks.
+   * @param report receives the times and failures.
+   * @return kDone, or kError if block is invalid or bad, refused by the
+   *    program tracker, the erase failed or a page failed to program (the
+   *    following pages are still programmed).
+   * @pre Memory is not busy
+   * @pre block is unprotected (TB, BP2, BP1, BP0 flags)
+   */
+  MemoryOperationStatus rewriteBlock(uint16_t block, ChunkSource& source,
+      NandBlockReport& report);
+
+  /**
+   * @brief Write pattern to the whole array, spare areas included, up to
+   *    blocks blocks per call: from progress.nextBlock() on, every good
+   *    block is rewritten with rewriteBlock(), so each page is generated
+   *    chunk by chunk while it is loaded, with no page sized buffer.
+   *
+   * Call it until it returns kDone, saving progress in between (see
+   * nand_fill_progress.h) so that a reset does not start the fill over.
+   * Bad blocks (see setBadBlockTable()) are skipped. A block that fails is
+   * counted in progress and the fill goes on.
+   *
+   * @param blocks blocks to go over in this call, bad ones included;
+   *    geometry().blocks for the whole array at once.
+   * @return kPending while blocks remain, kDone after the last one.
+   * @pre Memory is not busy
+   * @pre The array is unprotected (see disableBlockProtection())
+   */
+  MemoryOperationStatus fill(const PatternGenerator& pattern,
+      NandFillProgress& progress, uint16_t blocks);
+
+  /**
+   * @brief Read the data area (2048 bytes, no spare) of pages consecutive
+   *    pages with a single READ in continuous mode (BUF = 0), handing the
+   *    bytes to sink kStreamChunkBytes at a time (see chunk_stream.h).
+   *
+   * Only the first page is loaded with a page data read. From then on the
+   * memory loads the next page by itself while the current one is being
+   * output, so the read runs at the speed of the SPI clock instead of
+   * paying a command and tRD per page. Buffer mode is set back afterwards.
+   *
+   * ECC-1/ECC-0 then describe the whole read, so it is a single result for
+   * the ECC histogram, counted for the block of firstPage. Reads that stay
+   * inside a block keep the histogram exact.
+   *
+   * @param firstPage lower than 2^16.
+   * @param pages stops at the last page of the array.
+   * @return kDone, or kError if firstPage is invalid or some page had more
+   *    errors than ECC could correct (its bytes are still read).
+   * @pre Memory is not busy
+   */
+  MemoryOperationStatus readContinuous(uint32_t firstPage, uint32_t pages,
+      ChunkSink& sink);
+
+  /**
+   * @brief verifyRange() of the data areas only, with a single continuous
+   *    read (see readContinuous()).
+   *
+   * @param dataAddress position in the geometry().dataAreaBytes() data
+   *    bytes of the array: the byte at column c < 2048 of page p is at
+   *    p * 2048 + c.
+   *    Mismatches are recorded with the linear address of verifyRange(),
+   *    p * 2112 + c, which is also the address pattern is asked for.
+   * @param length stops at the end of the array.
+   * @return amount of bytes that did not match.
+   * @pre Memory is not busy
+   */
+  uint32_t verifyContinuous(uint32_t dataAddress, uint32_t length,
+      const PatternGenerator& pattern, MismatchSink& sink);
+
+  /**
+   * @brief Same as verifyRange(), but trusting the internal ECC: every page
+   *    of the range is loaded from the array and only compared on the MCU
+   *    if ECC-1 reports more errors than it could correct. The ECC result
+   *    of every load goes to the histogram (see setEccHistogram()).
+   *
+   * A page whose errors were corrected is output corrected, so it would
+   * not mismatch anyway and is counted by the histogram only.
+   *
+   * @return amount of bytes that did not match, in uncorrectable pages.
+   * @pre Memory is not busy
+   * @pre Buffer read mode is on (BUF=1 at SR-2)
+   * @pre ECC is on (ECC-E=1 at SR-2, its power up value)
+   */
+  uint32_t verifyEcc(uint32_t initialAddress, uint32_t length,
+      const PatternGenerator& pattern, MismatchSink& sink);
+
+  /**
+   * @brief Load the page from the array and count the bits of its 2112
+   *    bytes that differ from the pattern (see bit_flips.h). With ECC off
+   *    (disableEcc()) every flip is seen, also those ECC would correct.
+   *
+   * @param pageAddress lower than 2^16.
+   * @param positions receives the linear address (see verifyRange()) and
+   *    XOR mask of every byte with flips, nullptr for the count only.
+   * @return flipped bits in the page, 0 if pageAddress is invalid.
+   * @pre Memory is not busy
+   * @pre Buffer read mode is on (BUF=1 at SR-2)
+   * @pre With ECC off, the page was programmed with ECC off too, so that
+   *    its spare bytes hold the pattern instead of the ECC.
+   */
+  uint16_t countPageFlips(uint32_t pageAddress, const PatternGenerator& pattern,
+      MismatchSink* positions = nullptr);
+
   /**
    * @brief Loads a page to the buffer. Required before READ instructions.
    * 
@@ -367,7 +704,276 @@ public:
    */
   void writePage(uint8_t* buffer, size_t pageAddress);
 
+  /**
+   * @brief Start loading a page into the buffer (page data read). Finished
+   *    when poll() stops returning kPending, then the buffer can be read
+   *    with readBuffer() or verifyBuffer().
+   *
+   * @param pageAddress lower than 2^16.
+   * @return kPending, or kError if pageAddress is invalid.
+   * @pre Memory is not busy
+   * @post Memory is temporarily busy (up to 60 us with ECC-E = 1)
+   */
+  MemoryOperationStatus startRead(uint32_t pageAddress);
+
+  /**
+   * @brief Enable write, load the 2112 bytes of buffer and start programming
+   *    them into the page. Finished when poll() stops returning kPending.
+   *
+   * @param pageAddress lower than 2^16.
+   * @return kPending, or kError if pageAddress is invalid or in a bad
+   *    block (see setBadBlockTable()).
+   * @pre length(buffer) >= 2112
+   * @pre Memory is not busy
+   * @pre Page has been erased beforehand.
+   * @post Memory is temporarily busy (up to 700 us)
+   */
+  MemoryOperationStatus startWrite(uint8_t* buffer, uint32_t pageAddress);
+
+  /**
+   * @brief Enable write, load size bytes at column of a buffer reset to
+   *    0xFF (load program data) and start programming them into the page,
+   *    a partial program. Finished when poll() stops returning kPending.
+   *
+   * Only the loaded bytes go over the bus, and the rest of the page is left
+   * as it was, since programming 0xFF changes no bit. So records can be
+   * appended to a page, up to 4 times (see nand_program_tracker.h), each
+   * one to bytes still erased.
+   *
+   * @param column lower than 2112.
+   * @return kPending, or kError if the range or pageAddress are invalid,
+   *    the page is in a bad block or the program tracker refuses it.
+   * @pre column + size <= 2112
+   * @pre Memory is not busy
+   * @pre The bytes of the range are erased (0xFF)
+   * @post Memory is temporarily busy (up to 700 us)
+   */
+  MemoryOperationStatus startProgramPartial(uint32_t pageAddress,
+      uint16_t column, const uint8_t* data, uint16_t size);
+
+  /**
+   * @brief Enable write and start erasing the block of the page. Finished
+   *    when poll() stops returning kPending.
+   *
+   * @param pageAddress lower than 2^16, any page of the block.
+   * @return kPending, or kError if pageAddress is invalid or in a bad
+   *    block (see setBadBlockTable()).
+   * @pre Memory is not busy
+   * @post Memory is temporarily busy (up to 10 ms)
+   */
+  MemoryOperationStatus startErase(uint32_t pageAddress);
+
+  /**
+   * @brief Read SR-3 once and check the operation started last.
+   *
+   * @return kPending while BUSY = 1. Once it is 0, kError if the memory
+   *    reports it failed (P-FAIL after a program, E-FAIL after an erase,
+   *    ECC-1 = 1, uncorrectable data, after a page load) and kDone
+   *    otherwise, also when no operation was started.
+   */
+  MemoryOperationStatus poll();
+
+  /**
+   * @brief Whether the buffer holds the page, loaded by the last page data
+   *    read and not changed since by a program, erase or continuous read.
+   *
+   * The driver keeps track of the page in the buffer, so readByte(),
+   * readPage(), verifyRange() and readStream() skip the page load, and its
+   * busy time, when the page they need is already there. Re-reading a page
+   * after a mismatch then reads the same buffer again, which tells a bus
+   * error from a change in the buffer, not in the array.
+   */
+  bool isPageInBuffer(uint32_t pageAddress) const {
+    return residentPage_ == pageAddress;
+  }
+
+  /**
+   * @brief Forget the page in the buffer, so that the next read loads it
+   *    again from the array. Needed after a power cycle or reset of the
+   *    memory, which the driver cannot see, and to read a page again from
+   *    the array instead of from the buffer.
+   */
+  void invalidateBuffer() { residentPage_ = kNoResidentPage; }
+
+  /**
+   * @brief Count the ECC result of every page load from now on in
+   *    histogram, nullptr to stop. A continuous read is a single result,
+   *    counted for the block of its first page (see readContinuous()).
+   */
+  void setEccHistogram(NandEccHistogram* histogram) {
+    eccHistogram_ = histogram;
+  }
+
+  /**
+   * @brief Read the factory bad block marker of every block, the first
+   *    spare byte of its first page with ECC off, into table. ECC is on
+   *    afterwards.
+   *
+   * Must run before any block is erased, an erase clears the marker (see
+   * nand_bad_block_table.h).
+   *
+   * @return amount of bad blocks found.
+   * @pre Memory is not busy
+   */
+  uint16_t scanBadBlocks(NandBadBlockTable& table);
+
+  /**
+   * @brief Skip the blocks of table from now on, nullptr to stop:
+   *  - startErase() and startWrite() return kError without sending anything
+   *    and eraseBlock() and writePage() do nothing,
+   *  - writeStream() goes over their pages without programming them,
+   *  - verifyRange(), verifyEcc(), verifyContinuous() and countPageFlips()
+   *    report no mismatch or flip in them without reading them.
+   * Plain reads (readByte(), readPage(), readBuffer(), readStream(),
+   * readContinuous()) still read them.
+   */
+  void setBadBlockTable(const NandBadBlockTable* table) {
+    badBlockTable_ = table;
+  }
+
+  /**
+   * @brief Check every program against tracker from now on, and count it
+   *    there, nullptr to stop. startWrite(), startProgramPartial() and each
+   *    page of writeStream() are one program each; startErase() frees the
+   *    block. A refused program is not sent and ends in kError.
+   */
+  void setProgramTracker(NandProgramTracker* tracker) {
+    programTracker_ = tracker;
+  }
+
+  /**
+   * @brief Read the buffer through bus with the instruction of mode from now
+   *    on, nullptr to go back to READ over SPI. Used by readBuffer(),
+   *    verifyBuffer(), readStream() and countPageFlips(), and so by
+   *    verifyRange(), verifyEcc() and the scrubbers; the other instructions
+   *    stay on SPI.
+   *
+   * @return false, changing nothing, if mode needs more lanes than
+   *    bus->maxLanes().
+   * @pre Buffer read mode is on (BUF=1 at SR-2), the instructions of mode
+   *    do not exist in continuous read mode
+   * @pre WP-E = 0 at SR-1 for the quad modes
+   */
+  bool setReadBus(LaneBus* bus, NandReadMode mode = NandReadMode::kFast);
+
+  // The block, geometry().blockOf(page address), is in the bad block table.
+  bool isBadBlock(uint16_t block) const {
+    return badBlockTable_ != nullptr && badBlockTable_->isBad(block);
+  }
+
+  /**
+   * @brief LUT-F at SR-3: every entry of the bad block look up table of the
+   *    chip is in use, so no more blocks can be remapped by it.
+   */
+  bool isLookUpTableFull();
+
+  /**
+   * @brief Read size bytes of the buffer from column onwards.
+   *
+   * @param column lower than 2112.
+   * @pre column + size <= 2112
+   * @pre A page has been loaded into the buffer
+   * @pre Memory is not busy
+   * @pre Buffer read mode is on (BUF=1 at SR-2)
+   */
+  void readBuffer(uint8_t* buffer, uint16_t column, uint16_t size);
+
+  /**
+   * @brief Queue the read of size bytes of the buffer from column onwards,
+   *    the batched version of readBuffer() (see spi_command_batch.h).
+   *
+   * @return false, with nothing queued, if the range is invalid or the
+   *    batch is full.
+   */
+  bool addReadBuffer(SpiCommandBatch& batch, uint8_t* buffer, uint16_t column,
+      uint16_t size);
+
+  // Send every instruction of the batch under a single transaction.
+  void execute(const SpiCommandBatch& batch);
+
 private:
+  // Built once instead of on every instruction.
+  const SPISettings settings_;
+
+  // Opcode of the operation poll() has to check, 0 if none.
+  uint8_t pendingOperation_;
+
+  static const uint32_t kNoResidentPage = 0xFFFFFFFF;
+
+  // Page in the buffer, or kNoResidentPage if unknown. Set when its load is
+  // started, since nothing can be read from the buffer while busy.
+  uint32_t residentPage_;
+
+  // ECC-1 was 1 at the end of the load of residentPage_.
+  bool residentUncorrectable_;
+
+  NandGeometry geometry_;
+
+  NandEccHistogram* eccHistogram_;
+
+  const NandBadBlockTable* badBlockTable_;
+
+  NandProgramTracker* programTracker_;
+
+  LaneBus* readBus_;
+
+  NandReadMode readMode_;
+
+  // Select the memory and send the read instruction of the buffer for
+  // column, up to its first data byte.
+  void beginBufferRead(uint16_t column);
+
+  // Receive length bytes of the buffer read begun into sink, offset being
+  // that of the first one.
+  void receiveBuffer(ChunkSink& sink, uint32_t offset, uint32_t length);
+
+  // Deselect the memory and end the transaction of the buffer read.
+  void endBufferRead();
+
+  /**
+   * Check the page against the program tracker and count the program.
+   *
+   * @return false, printing why, if the tracker refuses it.
+   */
+  bool trackProgram(uint32_t pageAddress, const __FlashStringHelper* method);
+
+  // Set OTP-E, load the OTP page (0 unique ID, 1 parameter page) and wait
+  // for it. No ECC result is recorded and the buffer is left unknown.
+  void loadOtpPage(uint8_t page);
+
+  // Clear OTP-E, so that page data reads load the array again.
+  void leaveOtpMode();
+
+  // verifyContinuous() of a range without bad blocks.
+  uint32_t verifyContinuousRun(uint32_t dataAddress, uint32_t length,
+      const PatternGenerator& pattern, MismatchSink& sink);
+
+  // Hand ECC-1/ECC-0 of the SR-3 value statusRegister to the histogram.
+  void recordEcc(uint32_t pageAddress, byte statusRegister);
+
+  /**
+   * Load the page into the buffer and wait for it, unless it is there
+   * already.
+   *
+   * @return kError if the page had more errors than ECC could correct,
+   *    also when it was already in the buffer.
+   */
+  MemoryOperationStatus ensurePageInBuffer(uint16_t pageAddress);
+
+  // Start a transaction, select the memory (see chip_select.h) and send the
+  // opcode.
+  void beginCommand(uint8_t opcode);
+
+  // End the instruction being sent and start another one in the same
+  // transaction.
+  void nextCommand(uint8_t opcode);
+
+  // Deselect the memory and end the transaction.
+  void endCommand();
+
+  // Read SR-3 in the transaction being sent until BUSY = 0, returning that
+  // last value.
+  byte nextCommandStatusWhenReady();
 
   /**
    * @brief Read Protection Register (SR-1), Configuration Register (SR-2) or
@@ -375,9 +981,58 @@ private:
    * 
    * This method never fails even if memory is busy.
    * 
-   * @param address either 0 or 1 or 2 depending on SR-1, SR-2 or SR-3. (Unsure
-   *    if it's actually 1, 2, 3 respectively.
+   * @param address PROTECTION_REGISTER_NAND_FLASH (SR-1),
+   *    CONFIGURATION_REGISTER_NAND_FLASH (SR-2) or STATUS_REGISTER_NAND_FLASH
+   *    (SR-3), which are 0xA0, 0xB0 and 0xC0 according to the datasheet.
    * @return byte of register's content
    */
   byte readStatusRegiter(size_t address);
 };
+
+/**
+ * @brief The data bytes of the NAND Flash as an address space of their own,
+ *    whose verifyRange() is MemoryNANDFlash::verifyContinuous(), so that a
+ *    ScrubEngine can walk the whole array with continuous reads.
+ *
+ * Each step of the engine pays for one page load and then runs at the SPI
+ * clock, so steps of several pages take most of the per page latency out of
+ * a pass. The spare areas are not verified.
+ */
+class NandFlashDataArea {
+public:
+  explicit NandFlashDataArea(MemoryNANDFlash& nand) : nand_(nand) {}
+
+  uint32_t verifyRange(uint32_t initialAddress, uint32_t length,
+      const PatternGenerator& pattern, MismatchSink& sink) {
+    return nand_.verifyContinuous(initialAddress, length, pattern, sink);
+  }
+
+  // Of the geometry detected so far, the capacity of the ScrubEngine.
+  uint32_t capacity() const { return nand_.geometry().dataAreaBytes(); }
+
+private:
+  MemoryNANDFlash& nand_;
+};
+
+/**
+ * @brief The NAND Flash with MemoryNANDFlash::verifyEcc() as its
+ *    verifyRange(), so that a ScrubEngine walks the array loading every page
+ *    and only compares on the MCU the pages ECC could not correct.
+ *
+ * A clean page costs a page data read and the polls of SR-3 instead of
+ * reading its 2112 bytes over SPI.
+ */
+class NandFlashEccScrub {
+public:
+  explicit NandFlashEccScrub(MemoryNANDFlash& nand) : nand_(nand) {}
+
+  uint32_t verifyRange(uint32_t initialAddress, uint32_t length,
+      const PatternGenerator& pattern, MismatchSink& sink) {
+    return nand_.verifyEcc(initialAddress, length, pattern, sink);
+  }
+
+  uint32_t capacity() const { return nand_.geometry().arrayBytes(); }
+
+private:
+  MemoryNANDFlash& nand_;
+};
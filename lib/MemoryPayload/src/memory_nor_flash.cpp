@@ -0,0 +1,633 @@
+#include "./memory_nor_flash.h"
+#include "./spi_stream.h"
+
+#include <Arduino.h>
+#include "SPI.h"
+
+// FAST READ of each NorTransferProfile: opcode, lines of the address, dummy
+// clocks and data, double transfer rate, dummy clocks it needs at its
+// highest clock, and that clock.
+struct NorReadInstruction {
+  uint8_t opcode;
+  uint8_t lanes;
+  bool doubleTransferRate;
+  uint8_t dummyCycles;
+  uint32_t maxClockHz;
+};
+
+static const NorReadInstruction kReadInstructions[] = {
+  {FAST_READ_4_BYTE_NOR_FLASH, 1, false, 8, SPI_TRANSFER_SPEED_NOR_FLASH},
+  {DUAL_IO_FAST_READ_4_BYTE_NOR_FLASH, 2, false, 8,
+      SPI_TRANSFER_SPEED_NOR_FLASH},
+  {QUAD_IO_FAST_READ_4_BYTE_NOR_FLASH, 4, false, 10,
+      SPI_TRANSFER_SPEED_NOR_FLASH},
+  {DTR_QUAD_IO_FAST_READ_4_BYTE_NOR_FLASH, 4, true, 10,
+      SPI_TRANSFER_SPEED_NOR_FLASH_DTR},
+};
+
+// Bits a dummy clock takes, so dummy bytes are cycles * bits / 8.
+static uint8_t bitsPerClock(const NorReadInstruction& instruction) {
+  return instruction.doubleTransferRate ? 2 * instruction.lanes :
+      instruction.lanes;
+}
+
+void MemoryNORFlash::begin() {
+  ChipSelect<HOLD_NOR_FLASH_DIE_1>::begin();
+  ChipSelect<HOLD_NOR_FLASH_DIE_2>::begin();
+  currentDie_ = kNoDie;
+  useDie(0);
+}
+
+uint32_t MemoryNORFlash::eraseBytes(NorEraseSize size) {
+  return NorErasePlanner::eraseBytes(size);
+}
+
+// Register instructions are refused in a read session, where the dies
+// would take them as an address. Nothing can be pending then (see
+// beginReadSession()), so the registers are given as ready and idle.
+uint8_t MemoryNORFlash::readStatusRegister(uint8_t die) {
+  if (inReadSession_) {
+    printInReadSession(F("readStatusRegister"));
+    return 0x00;
+  }
+  beginCommand(die, RDSR_NOR_FLASH);
+  const uint8_t statusRegister = SPI.transfer(0x00);
+  endCommand();
+  return statusRegister;
+}
+
+uint8_t MemoryNORFlash::readFlagStatusRegister(uint8_t die) {
+  if (inReadSession_) {
+    printInReadSession(F("readFlagStatusRegister"));
+    return 0x80;
+  }
+  beginCommand(die, RDFSR_NOR_FLASH);
+  const uint8_t flagStatusRegister = SPI.transfer(0x00);
+  endCommand();
+  return flagStatusRegister;
+}
+
+void MemoryNORFlash::clearFlagStatusRegister(uint8_t die) {
+  if (inReadSession_) {
+    printInReadSession(F("clearFlagStatusRegister"));
+    return;
+  }
+  beginCommand(die, CLFSR_NOR_FLASH);
+  endCommand();
+}
+
+uint32_t MemoryNORFlash::readJedecId(uint8_t die) {
+  if (inReadSession_) {
+    printInReadSession(F("readJedecId"));
+    return 0;
+  }
+  beginCommand(die, READ_ID_NOR_FLASH);
+  uint32_t id = 0;
+  for (uint8_t i = 0; i < 3; ++i) {
+    id = (id << 8) | SPI.transfer(0x00);
+  }
+  endCommand();
+  return id;
+}
+
+uint8_t MemoryNORFlash::readVolatileConfiguration(uint8_t die) {
+  if (inReadSession_) {
+    printInReadSession(F("readVolatileConfiguration"));
+    return 0x00;
+  }
+  beginCommand(die, RDVCR_NOR_FLASH);
+  const uint8_t configuration = SPI.transfer(0x00);
+  endCommand();
+  return configuration;
+}
+
+// Dummy clocks are bits 7-4 of the volatile configuration register, the
+// rest (XIP, wrap) is kept.
+bool MemoryNORFlash::setDummyCycles(uint8_t cycles) {
+  if (cycles == 0 || cycles > 14 ||
+      cycles * bitsPerClock(kReadInstructions[(uint8_t)profile_]) % 8 != 0) {
+    Serial.println(F("Error: Invalid cycles passed to NOR Flash's setDummyCycles(...)."));
+    return false;
+  }
+  if (inReadSession_) {
+    printInReadSession(F("setDummyCycles"));
+    return false;
+  }
+  for (uint8_t die = 0; die < 2; ++die) {
+    const uint8_t configuration = readVolatileConfiguration(die);
+    beginCommand(die, WREN_NOR_FLASH);
+    nextCommand(WRVCR_NOR_FLASH);
+    SPI.transfer((uint8_t)(cycles << 4) | (configuration & 0x0F));
+    endCommand();
+  }
+  dummyCycles_ = cycles;
+  return true;
+}
+
+bool MemoryNORFlash::setTransferProfile(LaneBus* bus,
+    NorTransferProfile profile) {
+  const NorReadInstruction& instruction = kReadInstructions[(uint8_t)profile];
+  if (instruction.lanes > (bus == nullptr ? 1 : bus->maxLanes()) ||
+      (instruction.doubleTransferRate &&
+      (bus == nullptr || !bus->hasDoubleTransferRate()))) {
+    Serial.println(F("Error: Profile wider than the bus passed to NOR Flash's setTransferProfile(...)."));
+    return false;
+  }
+  if (inReadSession_) {
+    printInReadSession(F("setTransferProfile"));
+    return false;
+  }
+  readBus_ = bus;
+  profile_ = profile;
+  return setDummyCycles(instruction.dummyCycles);
+}
+
+uint32_t MemoryNORFlash::maxClockHz(NorTransferProfile profile) {
+  return kReadInstructions[(uint8_t)profile].maxClockHz;
+}
+
+bool MemoryNORFlash::isBusy() {
+  if (inReadSession_) {
+    printInReadSession(F("isBusy"));
+    return false;
+  }
+  return (readFlagStatusRegister(0) & 0x80) == 0 ||
+      (readFlagStatusRegister(1) & 0x80) == 0;
+}
+
+/**
+ * The flag status register is output constantly until chip select is put
+ * back on HIGH, so the instruction is sent once per die and its output
+ * checked continually.
+ */
+void MemoryNORFlash::waitUntilReady() {
+  if (inReadSession_) {
+    printInReadSession(F("waitUntilReady"));
+    return;
+  }
+  for (uint8_t die = 0; die < 2; ++die) {
+    beginCommand(die, RDFSR_NOR_FLASH);
+    while ((SPI.transfer(0x00) & 0x80) == 0) {
+    }
+    endCommand();
+  }
+}
+
+uint8_t MemoryNORFlash::readByte(uint32_t address) {
+  uint8_t memoryOutputByte = 0;
+  readNBytes(address, &memoryOutputByte, 1);
+  return memoryOutputByte;
+}
+
+// The buffer version of transfer leaves the received bytes in buffer. A
+// LaneBus takes at most 255 bytes per receive().
+void MemoryNORFlash::readNBytes(uint32_t initialAddress, uint8_t* buffer,
+    uint16_t size) {
+  if (initialAddress >= kCapacity || size > kCapacity - initialAddress) {
+    Serial.println(F("Error: Invalid range passed to NOR Flash's readNBytes(...)."));
+    return;
+  }
+  while (size > 0) {
+    const uint16_t bytes = bytesInDie(initialAddress, size);
+    beginRead(initialAddress);
+    if (readBus_ == nullptr) {
+      SPI.transfer(buffer, bytes);
+    } else {
+      const uint8_t lanes = kReadInstructions[(uint8_t)profile_].lanes;
+      for (uint16_t offset = 0; offset < bytes; offset += 255) {
+        const uint16_t left = bytes - offset;
+        readBus_->receive(buffer + offset, left < 255 ? left : 255, lanes);
+      }
+    }
+    endRead(initialAddress + bytes);
+    initialAddress += bytes;
+    buffer += bytes;
+    size -= bytes;
+  }
+}
+
+uint32_t MemoryNORFlash::verifyRange(uint32_t initialAddress, uint32_t length,
+    const PatternGenerator& pattern, MismatchSink& sink) {
+  if (initialAddress >= kCapacity) {
+    printInvalidAddress(F("verifyRange"));
+    return 0;
+  }
+  uint32_t mismatches = 0;
+  uint32_t address = initialAddress;
+  while (length > 0) {
+    const uint32_t bytes = bytesInDie(address, length);
+    beginRead(address);
+    if (readBus_ == nullptr) {
+      SpiStream stream(SPI);
+      mismatches += streamVerify(stream, address, bytes, 0xFFFFFFFF, pattern,
+          sink);
+    } else {
+      mismatches += verifyChunks(*readBus_,
+          kReadInstructions[(uint8_t)profile_].lanes, address, bytes, pattern,
+          sink);
+    }
+    endRead(address + bytes);
+    address = (address + bytes) % kCapacity;
+    length -= bytes;
+  }
+  return mismatches;
+}
+
+MemoryOperationStatus MemoryNORFlash::readStream(uint32_t initialAddress,
+    uint32_t length, ChunkSink& sink) {
+  if (initialAddress >= kCapacity) {
+    printInvalidAddress(F("readStream"));
+    return MemoryOperationStatus::kError;
+  }
+  uint32_t address = initialAddress;
+  uint32_t offset = 0;
+  while (offset < length) {
+    const uint32_t bytes = bytesInDie(address, length - offset);
+    beginRead(address);
+    if (readBus_ == nullptr) {
+      receiveChunks(SPI, sink, offset, bytes);
+    } else {
+      receiveChunks(*readBus_, kReadInstructions[(uint8_t)profile_].lanes,
+          sink, offset, bytes);
+    }
+    endRead(address + bytes);
+    address = (address + bytes) % kCapacity;
+    offset += bytes;
+  }
+  return MemoryOperationStatus::kDone;
+}
+
+// XIP is enabled before the transaction of the reads is taken.
+void MemoryNORFlash::beginReadSession() {
+  if (inReadSession_) {
+    return;
+  }
+  if (pendingDies_ != 0) {
+    Serial.println(F("Error: NOR Flash's beginReadSession(...) called with a program or erase pending."));
+    return;
+  }
+  writeXipBit(0);
+  beginReadTransaction();
+  inReadSession_ = true;
+  xipDies_ = 0;
+  openDie_ = kNoDie;
+}
+
+// A read of address 0 with the dummy clocks at 1, the first of them being
+// the XIP confirmation bit, and no data clocked.
+void MemoryNORFlash::endReadSession() {
+  if (!inReadSession_) {
+    return;
+  }
+  closeRead();
+  for (uint8_t die = 0; die < 2; ++die) {
+    if ((xipDies_ & (1 << die)) == 0) {
+      continue;
+    }
+    useDie(die);
+    ChipSelect<CHIP_SELECT_NOR_FLASH>::select();
+    sendReadAddress(0, 0xFF);
+    endReadTransfer();
+    ChipSelect<CHIP_SELECT_NOR_FLASH>::deselect();
+  }
+  endReadTransaction();
+  inReadSession_ = false;
+  xipDies_ = 0;
+  writeXipBit(1);
+}
+
+// Write enable and program share a single transaction.
+MemoryOperationStatus MemoryNORFlash::writeStream(uint32_t initialAddress,
+    uint32_t length, ChunkSource& source) {
+  if (initialAddress >= kCapacity || length > kCapacity - initialAddress) {
+    Serial.println(F("Error: Invalid range passed to NOR Flash's writeStream(...)."));
+    return MemoryOperationStatus::kError;
+  }
+  if (inReadSession_) {
+    printInReadSession(F("writeStream"));
+    return MemoryOperationStatus::kError;
+  }
+  MemoryOperationStatus result = MemoryOperationStatus::kDone;
+  uint32_t offset = 0;
+  while (offset < length) {
+    const uint32_t address = initialAddress + offset;
+    uint32_t bytesInPage = kPageBytes - address % kPageBytes;
+    if (bytesInPage > length - offset) {
+      bytesInPage = length - offset;
+    }
+    beginCommand(dieOf(address), WREN_NOR_FLASH);
+    nextCommand(PAGE_PROGRAM_4_BYTE_NOR_FLASH);
+    sendAddress(address);
+    sendChunks(SPI, source, offset, bytesInPage);
+    endCommand();
+    pendingDies_ |= 1 << dieOf(address);
+    MemoryOperationStatus status;
+    while ((status = poll(dieOf(address))) == MemoryOperationStatus::kPending) {
+    }
+    if (status == MemoryOperationStatus::kError) {
+      result = MemoryOperationStatus::kError;
+    }
+    offset += bytesInPage;
+  }
+  return result;
+}
+
+// Bytes are sent one by one because the buffer version of transfer would
+// replace the caller's bytes with the received ones.
+MemoryOperationStatus MemoryNORFlash::startWrite(const uint8_t* buffer,
+    uint16_t size, uint32_t initialAddress) {
+  if (initialAddress >= kCapacity ||
+      (initialAddress % kPageBytes) + size > kPageBytes) {
+    Serial.println(F("Error: Invalid range passed to NOR Flash's startWrite(...)."));
+    return MemoryOperationStatus::kError;
+  }
+  if (inReadSession_) {
+    printInReadSession(F("startWrite"));
+    return MemoryOperationStatus::kError;
+  }
+  if (poll(dieOf(initialAddress)) != MemoryOperationStatus::kDone) {
+    return MemoryOperationStatus::kError;
+  }
+  beginCommand(dieOf(initialAddress), WREN_NOR_FLASH);
+  nextCommand(PAGE_PROGRAM_4_BYTE_NOR_FLASH);
+  sendAddress(initialAddress);
+  for (uint16_t i = 0; i < size; ++i) {
+    SPI.transfer(buffer[i]);
+  }
+  endCommand();
+  pendingDies_ |= 1 << dieOf(initialAddress);
+  return MemoryOperationStatus::kPending;
+}
+
+MemoryOperationStatus MemoryNORFlash::startErase(NorEraseSize size,
+    uint32_t address) {
+  if (address >= kCapacity || address % eraseBytes(size) != 0) {
+    printInvalidAddress(F("startErase"));
+    return MemoryOperationStatus::kError;
+  }
+  if (inReadSession_) {
+    printInReadSession(F("startErase"));
+    return MemoryOperationStatus::kError;
+  }
+  if (poll(dieOf(address)) != MemoryOperationStatus::kDone) {
+    return MemoryOperationStatus::kError;
+  }
+  beginCommand(dieOf(address), WREN_NOR_FLASH);
+  switch (size) {
+    case NorEraseSize::kSubsector4KB:
+      nextCommand(SUBSECTOR_ERASE_4KB_4_BYTE_NOR_FLASH);
+      sendAddress(address);
+      break;
+    case NorEraseSize::kSubsector32KB:
+      nextCommand(SUBSECTOR_ERASE_32KB_4_BYTE_NOR_FLASH);
+      sendAddress(address);
+      break;
+    case NorEraseSize::kSector:
+      nextCommand(SECTOR_ERASE_4_BYTE_NOR_FLASH);
+      sendAddress(address);
+      break;
+    case NorEraseSize::kDie:
+      nextCommand(BULK_ERASE_NOR_FLASH);
+      break;
+  }
+  endCommand();
+  pendingDies_ |= 1 << dieOf(address);
+  return MemoryOperationStatus::kPending;
+}
+
+// Erase error is bit 5 and program error bit 4 of the flag status register.
+MemoryOperationStatus MemoryNORFlash::poll(uint8_t die) {
+  if (die > 1 || (pendingDies_ & (1 << die)) == 0) {
+    return MemoryOperationStatus::kDone;
+  }
+  const uint8_t flagStatusRegister = readFlagStatusRegister(die);
+  if ((flagStatusRegister & 0x80) == 0) {
+    return MemoryOperationStatus::kPending;
+  }
+  pendingDies_ &= ~(1 << die);
+  if ((flagStatusRegister & 0x30) != 0) {
+    clearFlagStatusRegister(die);
+    return MemoryOperationStatus::kError;
+  }
+  return MemoryOperationStatus::kDone;
+}
+
+// Both dies are checked even once one of them gives an error, so that an
+// error of the other one is not left for a later call.
+MemoryOperationStatus MemoryNORFlash::poll() {
+  const MemoryOperationStatus first = poll(0);
+  const MemoryOperationStatus second = poll(1);
+  if (first == MemoryOperationStatus::kError ||
+      second == MemoryOperationStatus::kError) {
+    return MemoryOperationStatus::kError;
+  }
+  if (first == MemoryOperationStatus::kPending ||
+      second == MemoryOperationStatus::kPending) {
+    return MemoryOperationStatus::kPending;
+  }
+  return MemoryOperationStatus::kDone;
+}
+
+/**
+ * A plan erases each subsector once and in address order, so a sector is
+ * counted on the first erase that reaches it. A failed erase is not
+ * programmed, the rewrite of its range would fail as well.
+ */
+MemoryOperationStatus MemoryNORFlash::rewrite(NorErasePlanner& planner,
+    const PatternGenerator& pattern) {
+  if (inReadSession_) {
+    printInReadSession(F("rewrite"));
+    return MemoryOperationStatus::kError;
+  }
+  MemoryOperationStatus result = MemoryOperationStatus::kDone;
+  uint16_t countedSector = NorEraseCounts::kSectors;
+  NorEraseCommand command;
+  while (planner.next(command)) {
+    MemoryOperationStatus status = startErase(command.size, command.address);
+    while (status == MemoryOperationStatus::kPending) {
+      status = poll(dieOf(command.address));
+    }
+    if (status == MemoryOperationStatus::kDone) {
+      PatternSource source(pattern, command.address);
+      status = writeStream(command.address, eraseBytes(command.size), source);
+    }
+    if (status == MemoryOperationStatus::kError) {
+      result = MemoryOperationStatus::kError;
+    }
+    if (eraseCounts_ == nullptr) {
+      continue;
+    }
+    if (command.size == NorEraseSize::kDie) {
+      eraseCounts_->recordDieErase(dieOf(command.address));
+    } else if (command.address / kSectorBytes != countedSector) {
+      countedSector = command.address / kSectorBytes;
+      eraseCounts_->recordSectorErase(countedSector);
+    }
+  }
+  return result;
+}
+
+// ChipSelect writes the not(HOLD) pins as well: select() holds the die and
+// deselect() lets it listen. The other die is held first, so that both
+// never drive MISO at once.
+void MemoryNORFlash::useDie(uint8_t die) {
+  if (die == currentDie_) {
+    return;
+  }
+  if (die == 0) {
+    ChipSelect<HOLD_NOR_FLASH_DIE_2>::select();
+    ChipSelect<HOLD_NOR_FLASH_DIE_1>::deselect();
+  } else {
+    ChipSelect<HOLD_NOR_FLASH_DIE_1>::select();
+    ChipSelect<HOLD_NOR_FLASH_DIE_2>::deselect();
+  }
+  currentDie_ = die;
+}
+
+void MemoryNORFlash::beginCommand(uint8_t die, uint8_t opcode) {
+  useDie(die);
+  SPI.beginTransaction(settings_);
+  ChipSelect<CHIP_SELECT_NOR_FLASH>::select();
+  SPI.transfer(opcode);
+}
+
+void MemoryNORFlash::nextCommand(uint8_t opcode) {
+  ChipSelect<CHIP_SELECT_NOR_FLASH>::deselect();
+  ChipSelect<CHIP_SELECT_NOR_FLASH>::select();
+  SPI.transfer(opcode);
+}
+
+void MemoryNORFlash::endCommand() {
+  ChipSelect<CHIP_SELECT_NOR_FLASH>::deselect();
+  SPI.endTransaction();
+}
+
+void MemoryNORFlash::sendAddress(uint32_t address) {
+  address %= kDieBytes;
+  for (int8_t shift = 24; shift >= 0; shift -= 8) {
+    SPI.transfer((uint8_t)(address >> shift));
+  }
+}
+
+void MemoryNORFlash::beginReadTransaction() {
+  if (readBus_ == nullptr) {
+    SPI.beginTransaction(settings_);
+  } else {
+    readBus_->beginTransaction();
+  }
+}
+
+void MemoryNORFlash::endReadTransaction() {
+  if (readBus_ == nullptr) {
+    SPI.endTransaction();
+  } else {
+    readBus_->endTransaction();
+  }
+}
+
+void MemoryNORFlash::sendReadOpcode() {
+  const uint8_t opcode = kReadInstructions[(uint8_t)profile_].opcode;
+  if (readBus_ == nullptr) {
+    SPI.transfer(opcode);
+  } else {
+    readBus_->send(&opcode, 1, 1);
+  }
+}
+
+// Dummy clocks are whole bytes on the lines of the profile, see
+// setDummyCycles(), 14 at most.
+void MemoryNORFlash::sendReadAddress(uint32_t address, uint8_t dummyByte) {
+  const NorReadInstruction& instruction = kReadInstructions[(uint8_t)profile_];
+  const uint8_t dummyBytes = dummyCycles_ * bitsPerClock(instruction) / 8;
+  if (readBus_ == nullptr) {
+    sendAddress(address);
+    for (uint8_t i = 0; i < dummyBytes; ++i) {
+      SPI.transfer(dummyByte);
+    }
+    return;
+  }
+  address %= kDieBytes;
+  uint8_t header[4 + 14];
+  for (uint8_t i = 0; i < 4; ++i) {
+    header[i] = address >> (24 - 8 * i);
+  }
+  memset(header + 4, dummyByte, dummyBytes);
+  readBus_->setDoubleTransferRate(instruction.doubleTransferRate);
+  readBus_->send(header, 4 + dummyBytes, instruction.lanes);
+}
+
+void MemoryNORFlash::endReadTransfer() {
+  if (readBus_ != nullptr) {
+    readBus_->setDoubleTransferRate(false);
+  }
+}
+
+// Dummy bytes sent as 0 keep the XIP confirmation bit at 0.
+void MemoryNORFlash::beginRead(uint32_t address) {
+  const uint8_t die = dieOf(address);
+  if (!inReadSession_) {
+    useDie(die);
+    beginReadTransaction();
+    ChipSelect<CHIP_SELECT_NOR_FLASH>::select();
+    sendReadOpcode();
+  } else if (die == openDie_ && address == nextAddress_) {
+    return;
+  } else {
+    closeRead();
+    useDie(die);
+    ChipSelect<CHIP_SELECT_NOR_FLASH>::select();
+    if ((xipDies_ & (1 << die)) == 0) {
+      sendReadOpcode();
+      xipDies_ |= 1 << die;
+    }
+    openDie_ = die;
+  }
+  sendReadAddress(address, 0x00);
+}
+
+void MemoryNORFlash::endRead(uint32_t nextAddress) {
+  if (inReadSession_) {
+    nextAddress_ = nextAddress;
+  } else {
+    endReadTransfer();
+    ChipSelect<CHIP_SELECT_NOR_FLASH>::deselect();
+    endReadTransaction();
+  }
+}
+
+void MemoryNORFlash::closeRead() {
+  if (openDie_ != kNoDie) {
+    endReadTransfer();
+    ChipSelect<CHIP_SELECT_NOR_FLASH>::deselect();
+    openDie_ = kNoDie;
+  }
+}
+
+void MemoryNORFlash::writeXipBit(uint8_t bit) {
+  for (uint8_t die = 0; die < 2; ++die) {
+    const uint8_t configuration = readVolatileConfiguration(die);
+    beginCommand(die, WREN_NOR_FLASH);
+    nextCommand(WRVCR_NOR_FLASH);
+    SPI.transfer((uint8_t)((configuration & ~0x08) | (bit << 3)));
+    endCommand();
+  }
+}
+
+uint32_t MemoryNORFlash::bytesInDie(uint32_t address, uint32_t length) {
+  const uint32_t remaining = kDieBytes - address % kDieBytes;
+  return length < remaining ? length : remaining;
+}
+
+void MemoryNORFlash::printInvalidAddress(
+    const __FlashStringHelper* method) {
+  Serial.print(F("Error: Invalid address passed to NOR Flash's "));
+  Serial.print(method);
+  Serial.println(F("(...)."));
+}
+
+void MemoryNORFlash::printInReadSession(
+    const __FlashStringHelper* method) {
+  Serial.print(F("Error: NOR Flash's "));
+  Serial.print(method);
+  Serial.println(F("(...) called in a read session."));
+}
@@ -12,8 +12,9 @@
  *
  * Important NOTE: This NOR Flash allows 100000 ciclos ERASE mínimum.
  *
- * Two memory arrays of 512 Mbytes each. Each has sectors made up of 1024 subsectors
- *    of 32KB which are made up at the same time of 4KB subsectors.
+ * Two memory arrays (dies) of 512 Mbit each, 128 MByte in total. Each die has
+ *    1024 sectors of 64KB, made up of 2 subsectors of 32KB which are made up
+ *    at the same time of 4KB subsectors. Programs are of 256 byte pages.
  *
  * #### Because it is SPI based, the pins are the following:
  *    Supply voltage,
@@ -47,8 +48,9 @@
  * #### SPI configuration:
  *
  * Transmission speed must be set to 133 MHz (133000000 on SPIConfig object),
- * so It will be used in Single Transfer Rate for the first version of the
- * project. No Dual/Quad I/O instructions used.
+ * so It will be used in Single Transfer Rate. Dual/Quad I/O and Double
+ * Transfer Rate reads go through a LaneBus (see Transfer profiles below),
+ * the latter at 90 MHz.
  *
  * Clock polarity and clock phase required for SPI communication:
  *  CPOL=0, CPHA=0 (SPI_MODE0) or
@@ -100,43 +102,86 @@
  * Wrap type is also included in the volatile version of the configuration
  * register.
  *
- * 
- * 
- * 
- * 
- * *************** COPIED FROM NAND FLASH FROM HERE, UPDATE PENDING ***************
- * 
- * 
- * 
- * 
- * 
- * 
- * 
- * 
- * #### Instructions
+ * ### Dies
  *
- * An instruction is made up of an OPCODE followed by address or dummy bytes
- * depending on the specific instruction.It is important to understand that
- * the first bit transmitted is the most significant, in this case the opcode
- * will be received by the NAND Flash first.
+ * Both dies receive every instruction, each one on its own I/O group. On the
+ * breakout board DQ0 and DQ4 are both wired to MOSI and DQ1 and DQ5 both to
+ * MISO, and each die has its own not(HOLD) pin: a die whose not(HOLD) is LOW
+ * ignores the bus and leaves its output floating, so the driver holds one
+ * die to talk to the other. Linear addresses put the first die in the lower
+ * 64 MByte and the second one in the upper 64 MByte, and each die has its
+ * own status, flag status and configuration registers.
  *
- * There are 27 instructions, so they are not included in this comment block
- * due to length optimization.
+ * A held die goes on with its program or erase, so the other one can be
+ * read or programmed meanwhile: the pending operations are followed per
+ * die and poll(die) checks only the flag status register of that die.
+ * NorRefresh (see nor_refresh.h) scrubs and rewrites both dies this way.
  *
- * An address can be:
- * A) x x x x - Block-Address(10 bits) - Page-Address(6 bits) - Byte-Address(11 bits)
- * B) x x x x -           Page-Address(16 bits)               - Byte-Address(11 bits)
- * x = irrelevant bit
+ * ### Addressing
  *
- * NOTE: Page with address 0 is the buffer page, which is initialized to all 0
- * on power up.
+ * 64 MByte need 26 address bits, one more than 3 bytes give, so the driver
+ * sends the 4 byte address versions of its instructions (0Ch FAST READ, 12h
+ * PAGE PROGRAM, 21h/5Ch/DCh erases), which take 4 bytes whatever the address
+ * mode and the extended address register hold. Nothing has to be set up
+ * after a power up or a reset.
  *
- * There are specific instructions for Standard/Dual/Quad mode read/write
- *  instructions.
+ * ### Reads
+ *
+ * FAST READ waits for the dummy clocks of the volatile configuration
+ * register, 8 by default, before the data. setDummyCycles() changes them on
+ * both dies. They have to be whole bytes on the lines of the read: a
+ * multiple of 8 over the SPI of the Nano.
+ *
+ * ### Transfer profiles
+ *
+ * setTransferProfile() picks the FAST READ of every read and the LaneBus
+ * (see spi_lanes.h) it goes through, nullptr meaning the SPI peripheral:
+ *  - kStrX1: 0Ch 4 BYTE FAST READ, 1-1-1, 8 dummy clocks.
+ *  - kDual: BCh 4 BYTE DUAL I/O FAST READ, 1-2-2, 8 dummy clocks.
+ *  - kQuad: ECh 4 BYTE QUAD I/O FAST READ, 1-4-4, 10 dummy clocks.
+ *  - kDtrQuad: EEh 4 BYTE DTR QUAD I/O FAST READ, 1-4-4 on both clock
+ *    edges from the address on, 10 dummy clocks, up to 90 MHz.
+ * The opcode takes 1 line, the address, dummy clocks and data the others.
+ * These instructions exist in the extended SPI protocol of a power up, so
+ * only the dummy clocks of the volatile configuration register change,
+ * to those the datasheet gives for each instruction at its highest clock.
+ * The dies still take turns through their not(HOLD) pins, so DQ0-DQ3 and
+ * DQ4-DQ7 are wired to the same lines of the bus. Programs, erases and
+ * registers stay on SPI: a page takes 120 us to program, the bus is not
+ * what limits them.
+ *
+ * ### Read sessions
+ *
+ * Every read is a FAST READ with its opcode, 4 address bytes and the dummy
+ * clocks, in its own transaction. Between beginReadSession() and
+ * endReadSession() that overhead goes away:
+ *  - chip select stays LOW after a read, so a read that starts where the
+ *    last one ended, on the same die, just clocks out more bytes, with no
+ *    instruction at all. The consecutive steps of a ScrubEngine become a
+ *    single FAST READ per die.
+ *  - XIP is enabled in the volatile configuration register (bit 3 = 0) and
+ *    the dummy clocks are sent as 0, which is the XIP confirmation bit: a
+ *    die that was read once in the session takes its next FAST READ
+ *    without the opcode, from the address on. That is what any other read,
+ *    a jump or a change of die, costs.
+ * endReadSession() sends a read with the confirmation bit at 1, which
+ * takes the dies out of XIP, and disables it again. No other instruction
+ * can be sent in a session, the dies would take it as an address, so the
+ * methods that send one print an error and do nothing: the register reads
+ * give 0, except readFlagStatusRegister(), 0x80 (ready), and isBusy(),
+ * false, which is what the dies are while nothing can be pending.
+ *
+ * ### Programs and erases
+ *
+ * Each one is preceded by a WREN in the same transaction, leaves its die
+ * busy and is followed with poll(), which reads the flag status register:
+ * bit 7 is 1 once the die is ready, bit 5 an erase error and bit 4 a program
+ * error, which stay until a CLEAR FLAG STATUS REGISTER. Typical times: 120 us
+ * per page, 50 ms per 4KB subsector, 100 ms per 32KB subsector, 150 ms per
+ * sector and 153 s per die. rewrite() picks among them with a
+ * NorErasePlanner (see nor_erase_planner.h) and counts the cycles of each
+ * sector in a NorEraseCounts.
  *
- * Check the previously mentioned datasheet for a great explanation on the
- * sequences for each instruction.
- * 
  * I assume there is only one SPI for all the memories, so that the clock,
  *  input, output lines are all the same for the different memories, and
  *  because of that, a single SPI.begin() on the sketch will setup those
@@ -147,212 +192,370 @@
 
 #include <Arduino.h>
 #include <stdint.h> // to avoid uint8_t unknown type syntax highlight error
-#include <Array.h>
+#include <SPI.h>
+#include "./chip_select.h"
+#include "./chunk_stream.h"
+#include "./memory_operation_status.h"
+#include "./mismatch_sink.h"
+#include "./nor_erase_counts.h"
+#include "./nor_erase_planner.h"
+#include "./pattern_generator.h"
+#include "./spi_lanes.h"
 
 // Pins
-#define CHIP_SELECT_NAND_FLASH 3
+#ifndef CHIP_SELECT_NOR_FLASH
+#define CHIP_SELECT_NOR_FLASH 3
+#endif
+#ifndef HOLD_NOR_FLASH_DIE_1
+#define HOLD_NOR_FLASH_DIE_1 8
+#endif
+#ifndef HOLD_NOR_FLASH_DIE_2
+#define HOLD_NOR_FLASH_DIE_2 9
+#endif
 
 // opcodes used
-#define WREN_NAND_FLASH 6
-#define WRDI_NAND_FLASH 4
-#define RDSR_NAND_FLASH 15
-#define WRSR_NAND_FLASH 1
-#define READ_NAND_FLASH 3
-#define PAGE_READ_NAND_FLASH 435
-#define BLOCK_ERASE_NAND_FLASH 216
-#define RANDOM_LOAD_PROGRAM_DATA 132
-#define PROGRAM_EXECUTE 16
-
-#define SPI_TRANSFER_SPEED_NAND_FLASH 133000000 // 133 MHz (Single Transfer Rate)
-
-class MemoryNANDFlash {
+#define WREN_NOR_FLASH 6
+#define WRDI_NOR_FLASH 4
+#define RDSR_NOR_FLASH 5
+#define RDFSR_NOR_FLASH 112
+#define CLFSR_NOR_FLASH 80
+#define READ_ID_NOR_FLASH 159
+#define RDVCR_NOR_FLASH 133
+#define WRVCR_NOR_FLASH 129
+#define FAST_READ_4_BYTE_NOR_FLASH 12
+#define DUAL_IO_FAST_READ_4_BYTE_NOR_FLASH 188
+#define QUAD_IO_FAST_READ_4_BYTE_NOR_FLASH 236
+#define DTR_QUAD_IO_FAST_READ_4_BYTE_NOR_FLASH 238
+#define PAGE_PROGRAM_4_BYTE_NOR_FLASH 18
+#define SUBSECTOR_ERASE_4KB_4_BYTE_NOR_FLASH 33
+#define SUBSECTOR_ERASE_32KB_4_BYTE_NOR_FLASH 92
+#define SECTOR_ERASE_4_BYTE_NOR_FLASH 220
+#define BULK_ERASE_NOR_FLASH 199 // the whole die that is not held
+
+#define SPI_TRANSFER_SPEED_NOR_FLASH 133000000 // 133 MHz (Single Transfer Rate)
+#define SPI_TRANSFER_SPEED_NOR_FLASH_DTR 90000000 // 90 MHz (Double Transfer Rate)
+
+/**
+ * @brief FAST READ of MemoryNORFlash::setTransferProfile(), lines of the
+ *    opcode, the address and the data (see Transfer profiles above).
+ */
+enum class NorTransferProfile : uint8_t {
+  kStrX1, // 1-1-1
+  kDual, // 1-2-2
+  kQuad, // 1-4-4
+  kDtrQuad, // 1-4-4, both clock edges
+};
+
+class MemoryNORFlash {
 public:
-  MemoryNANDFlash() {}
-  ~MemoryNANDFlash() {}
+  static const uint32_t kDieBytes = 67108864; // 512 Mbit
+  static const uint32_t kCapacity = 2 * kDieBytes;
+  static const uint32_t kSectorBytes = 65536;
+  static const uint16_t kPageBytes = 256;
+  static const uint8_t kDefaultDummyCycles = 8;
+
+  MemoryNORFlash()
+      : settings_(SPI_TRANSFER_SPEED_NOR_FLASH, MSBFIRST, SPI_MODE0),
+        currentDie_(kNoDie), pendingDies_(0),
+        dummyCycles_(kDefaultDummyCycles), eraseCounts_(nullptr),
+        inReadSession_(false), xipDies_(0), openDie_(kNoDie),
+        nextAddress_(0), readBus_(nullptr),
+        profile_(NorTransferProfile::kStrX1) {}
+  ~MemoryNORFlash() {}
 
   /**
-   * @brief Perform a RDSR read status register instruction. Check if the WEL
-   * flag in the status register is at 1 (allow write instructions) or at 0
-   * (dissallow write instructions)
-   * 
-   * Cannot fail because it simply checks status register by a RDSR instruction.
-   * 
-   * @return true if WEL = 1
-   * @return false if WEL = 0
+   * @brief Make the not(HOLD) pins outputs and hold the second die. Call
+   *    after ChipSelect<CHIP_SELECT_NOR_FLASH>::begin().
    */
-  bool isWriteEnabled();
+  void begin();
+
+  // Die of a linear address, 0 or 1.
+  static uint8_t dieOf(uint32_t address) { return address / kDieBytes; }
+
+  // Bytes that startErase() erases for size.
+  static uint32_t eraseBytes(NorEraseSize size);
 
   /**
-   * @brief Status register has a WEL flag that at 1 allows memory to be written,
-   * but at 0 it does not allow it. This changes the flag to 1.
+   * @brief RDSR of the die. WIP at bit 0, WEL at bit 1.
    */
-  void enableWrite();
+  uint8_t readStatusRegister(uint8_t die);
 
   /**
-   * @brief Status register 3 has a WEL flag that at 1 allows memory to be written,
-   * but at 0 it does not allow it. This changes the flag to 0.
-   * 
-   * Makes no effect on current write cycle; it will be successfuly finished,
-   * but there won't be a next write cycle after this method is called.
-   *
+   * @brief READ FLAG STATUS REGISTER of the die. Bit 7 is 1 when the die is
+   *    ready, bit 5 an erase error, bit 4 a program error and bit 0 4 byte
+   *    addressing.
    */
-  void disableWrite();
+  uint8_t readFlagStatusRegister(uint8_t die);
+
+  // Clear the error bits of the flag status register of the die.
+  void clearFlagStatusRegister(uint8_t die);
+
+  // Manufacturer, memory type and capacity, 0x20BA20 for each die.
+  uint32_t readJedecId(uint8_t die);
+
+  uint8_t readVolatileConfiguration(uint8_t die);
 
   /**
-   * @brief The memory can be in an operation cycle, which means that a non status
-   * register related instruction cannot be executed.
+   * @brief Dummy clocks of FAST READ, written to the volatile configuration
+   *    register of both dies.
    *
-   * This can be used to know when an operation has ended by continously calling it
-   * while checking the busy flag in Status Register 3.
+   * @param cycles 1 to 14, whole bytes on the lines of the transfer
+   *    profile: a multiple of 8 for kStrX1, of 4 for kDual, of 2 for kQuad.
+   * @return false, changing nothing, for other values or in a read session.
+   * @pre Memory is not busy
+   */
+  bool setDummyCycles(uint8_t cycles);
+
+  uint8_t dummyCycles() const { return dummyCycles_; }
+
+  /**
+   * @brief Read through bus with the FAST READ of profile from now on,
+   *    nullptr for the SPI peripheral, which only does kStrX1. Sets the
+   *    dummy clocks of profile with setDummyCycles(). Used by every read,
+   *    in a read session too.
    *
-   * @return true if memory is in an operation cycle
-   * @return false if memory is not in an operation cycle
+   * @return false, changing nothing, if profile needs more lines than
+   *    bus->maxLanes() or a DTR bus does not have, or in a read session.
+   * @pre Memory is not busy
    */
-  bool isBusy();
+  bool setTransferProfile(LaneBus* bus,
+      NorTransferProfile profile = NorTransferProfile::kStrX1);
+
+  NorTransferProfile transferProfile() const { return profile_; }
+
+  // Highest clock of the FAST READ of profile.
+  static uint32_t maxClockHz(NorTransferProfile profile);
 
   /**
-   * @brief The memory can be in a write cycle, which means that a non status
-   * register related instruction cannot be executed. This sends an instruction
-   * for status register read continuously to check on the BUSY flag continually
-   * until it is found to be equal to 0 (ready for next instruction).
+   * @brief Whether any die has a program or erase going on, from bit 7 of
+   *    their flag status registers.
    */
+  bool isBusy();
+
+  // Wait until neither die is busy.
   void waitUntilReady();
 
   /**
-   * @brief Activates beyond page addressing for READ automatic address
-   *    increment. READ now starts from first address of the page currently
-   *    in the buffer.
-   * 
-   * SR-2's BUF bit=0 means that a READ instruction, which automatically
-   * increments the address from the initial address, can go beyond the page's
-   * maximum address instead of stopping.
+   * @brief Read a single byte with FAST READ.
+   *
+   * @param address lower than kCapacity.
+   * @pre Its die is not busy
    */
-  void setContinuousMode();
+  uint8_t readByte(uint32_t address);
 
   /**
-   * @brief Activates maximum page address restriction for READ automatic adress
-   *    increment. READ now allows specific address access within the page
-   *    currently loaded into buffer.
+   * @brief Read size consecutive bytes from initialAddress, into buffer.
+   *    Crossing into the second die takes a second FAST READ.
    *
-   * SR-2's BUF bit=1 means that a READ instruction, which automatically
-   * increments the address from the initial address, stops when reaching the
-   * maximum address within the page.
+   * @pre initialAddress + size <= kCapacity
+   * @pre Its dies are not busy
    */
-  void setBufferMode();
+  void readNBytes(uint32_t initialAddress, uint8_t* buffer, uint16_t size);
 
   /**
-   * @brief Read a single byte. Most significant is read first.
+   * @brief Read length consecutive bytes from initialAddress, one FAST READ
+   *    per die, and compare each one against the byte the pattern expects at
+   *    its address, without storing what was read (see spi_stream.h). Past
+   *    the last address the read wraps to 0.
    *
-   * Puts the memory in Continuous mode and reads.
-   * 
-   * NOTE: take into account that a page contains 64 bytes for ECC, and the
-   * automatic address increment can output those 64 bytes, which are at the
-   * highest address of the page.
-   * 
-   * TODO: check if the 64 ECC bytes can be accessed.
+   * @param initialAddress lower than kCapacity.
+   * @param length amount of bytes to verify, kCapacity for the whole memory.
+   * @return amount of bytes that did not match.
+   * @pre Its dies are not busy
+   */
+  uint32_t verifyRange(uint32_t initialAddress, uint32_t length,
+      const PatternGenerator& pattern, MismatchSink& sink);
+
+  /**
+   * @brief Read length bytes from initialAddress, one FAST READ per die,
+   *    handing them to sink kStreamChunkBytes at a time (see
+   *    chunk_stream.h). Past the last address the read wraps to 0.
    *
-   * @param address lower than 2^27, since the eeprom's memory array is of
-   *  1 GBit.
-   * @pre 0 <= address <= 2^27 - 1
-   * @pre Buffer read mode is on (BUF=1 at SR-2) (required in order to access
-   *    specific byte instead of always from start of page)
+   * @return kDone, or kError if initialAddress is invalid.
+   * @pre Its dies are not busy
    */
-  uint8_t readByte(size_t address);
+  MemoryOperationStatus readStream(uint32_t initialAddress, uint32_t length,
+      ChunkSink& sink);
 
   /**
-   * @brief Read N consecutive bytes by incrementing an initialAddress
-   *    N times. Most significant is read first. Includes 64 ECC bytes.
+   * @brief Start a read session (see Read sessions above): enable XIP on
+   *    both dies and keep the transaction of the reads until
+   *    endReadSession().
    *
-   * NOTE: take into account that a page contains 64 bytes for ECC, and the
-   * automatic address increment can output those 64 bytes, which are at the
-   * highest address of the page.
-   * 
-   * TODO: check if the 64 ECC bytes are included in the output.
+   * Until then only readByte(), readNBytes(), verifyRange() and
+   * readStream() can be used. startWrite(), startErase(), writeStream()
+   * and rewrite() are refused. Nothing is done in a session already, and
+   * nothing but an error printed while a program or erase is pending, as
+   * isInReadSession() then tells.
    *
-   * @param pageAddress lower than 2^16, since thats the amount of pages
-   *    in the memory array.
-   * @param buffer destination of the bytes being read from the NAND.
-   * @param size amount of bytes to read.
-   * @pre 0 <= pageAddress <= 2^16 - 1
-   * @pre length(buffer) >= 2112
    * @pre Memory is not busy
-   * @pre Buffer read mode is on (BUF=1 at SR-2) (required in order to access
-   *    specific byte instead of always from start of page)
+   * @pre Nothing else uses the bus of the reads until endReadSession()
    */
-  void readPage(size_t pageAddress, uint8_t* buffer);
+  void beginReadSession();
 
   /**
-   * @brief Loads a page to the buffer. Required before READ instructions.
-   * 
-   * READ instructions need a page load beforehand. Call this before
-   *    accesing a byte that falls within the page.
-   * 
-   * @param pageAddress lower than 2^16, since thats the amount of pages
-   *    in the memory array.
-   * @pre 0 <= pageAddress <= 2^16 - 1
-   * @pre Memory is not busy
-   * @post Memory is temporarily busy
+   * @brief End the read session: take both dies out of XIP, end the
+   *    transaction and disable XIP again.
    */
-  void loadPageIntoBuffer(size_t pageAddress);
+  void endReadSession();
+
+  bool isInReadSession() const { return inReadSession_; }
 
   /**
-   * @brief Set bytes of a 128KByte Block to 0xFF and mark them as erased. It 
-   *    is a requirement for a page write. The block that contaisn the addressed
-   *    page is the one to be erased.
+   * @brief Program length bytes from initialAddress asked to source a chunk
+   *    at a time, one PAGE PROGRAM per page, waiting for each one.
    *
-   * NOTE: Write is automatically disabled after each write related instruction.
-   * 
-   * @param pageAddress lower than 2^16, since thats the amount of pages
-   *    in the memory array.
-   * @pre 0 <= pageAddress <= 2^16 - 1
-   * @pre Write is enabled
-   * @pre Memory is not busy
-   * @pre block is unprotected (TB, BP2, BP1, BP0 flags)
-   * @post Memory is temporarily busy
+   * @return kDone, or kError if initialAddress is invalid, the range goes
+   *    past the end or a program failed.
+   * @pre The range has been erased beforehand
+   * @pre Its dies are not busy
    */
-  void eraseBlock(size_t pageAddress);
+  MemoryOperationStatus writeStream(uint32_t initialAddress, uint32_t length,
+      ChunkSource& source);
 
   /**
-   * @brief Write A 2112 byte page. Sets page buffer to all 0xFF beforehand.
+   * @brief Start a PAGE PROGRAM of size bytes from initialAddress, which
+   *    have to be inside a single 256 byte page.
    *
-   * Important NOTE: Can only be executed 4 times on a single page address.
-   *    (if I understood it correctly, TODO: worth it to verify it.)
-   * 
-   * NOTE: Due to the bus being most significant first, then the bytes to write
-   *    must be ordered in a way that takes into account that.
-   * 
-   * NOTE: Write is automatically disabled after each write related instruction.
+   * Programming only clears bits: a byte becomes its old value AND the new
+   * one, so the page has to be erased beforehand.
    *
-   * NOTE: If ECC-E = 0, the last 64 ECC bytes can be used, but if ECC-E=1 then
-   * those bytes will be substituted by automatically generated ones, ignoring
-   * the original content for those last 64 bytes of the page to be written.
-   * 
-   * @param buffer bytes that will substitute the old bytes in memory.
-   * @param size amount of bytes to write.
-   * @param pageAddress lower than 2^16, since thats the amount of pages
-   *    in the memory array.
-   * @pre 0 <= pageAddress <= 2^27 - 1
-   * @pre length(buffer) >= 2112
-   * @pre Write is enabled
-   * @pre Memory is not busy
-   * @pre Page to write at is not protected (TB, BP2, BP1, BP0 flags)
-   * @pre Page has been erased beforehand.
-   * @pre Block is being written from lowest to highest page address.
-   * @post Memory is temporarily busy
+   * @return kPending, to be followed with poll(), or kError if the range is
+   *    invalid, another operation of its die is still pending or the last
+   *    one failed and was not polled: its error is reported this way
+   *    instead of being lost, and nothing is started.
    */
-  void writePage(uint8_t* buffer, size_t pageAddress);
+  MemoryOperationStatus startWrite(const uint8_t* buffer, uint16_t size,
+      uint32_t initialAddress);
 
-private:
+  /**
+   * @brief Start the erase of the subsector, sector or die of size that
+   *    starts at address.
+   *
+   * @param address aligned to eraseBytes(size).
+   * @return kPending, to be followed with poll(), or kError if address is
+   *    invalid or not aligned, another operation of its die is still
+   *    pending or the last one failed and was not polled, as startWrite().
+   */
+  MemoryOperationStatus startErase(NorEraseSize size, uint32_t address);
+
+  /**
+   * @brief Check the pending program or erase of the die.
+   *
+   * @return kPending while it lasts, kDone once it ended and kError if it
+   *    ended with an error flag, which is cleared then. kDone when nothing
+   *    is pending.
+   */
+  MemoryOperationStatus poll(uint8_t die);
 
   /**
-   * @brief Read Protection Register (SR-1), Configuration Register (SR-2) or
-   *    StatusRegister(SR-3)
-   * 
-   * This method never fails even if memory is busy.
-   * 
-   * @param address either 0 or 1 or 2 depending on SR-1, SR-2 or SR-3. (Unsure
-   *    if it's actually 1, 2, 3 respectively.
-   * @return byte of register's content
+   * @brief poll() both dies.
+   *
+   * @return kError if an operation of either die ended with an error in
+   *    this call, otherwise kPending while any of them lasts.
+   */
+  MemoryOperationStatus poll();
+
+  /**
+   * @brief Erase everything planner plans, one erase after the other, and
+   *    program pattern back into each erased range with writeStream(), so
+   *    the dirty ranges given to the planner hold the pattern again.
+   *
+   * @return kDone, or kError if an erase or a program failed. The rest of
+   *    the plan is carried out anyway.
+   * @pre Memory is not busy
    */
-  byte readStatusRegiter(size_t address);
+  MemoryOperationStatus rewrite(NorErasePlanner& planner,
+      const PatternGenerator& pattern);
+
+  /**
+   * @brief Counts that rewrite() adds its erases to, nullptr (the default)
+   *    for none. Erases started with startErase() are not counted.
+   */
+  void setEraseCounts(NorEraseCounts* counts) { eraseCounts_ = counts; }
+
+private:
+  static const uint8_t kNoDie = 0xFF;
+
+  // Built once instead of on every instruction.
+  const SPISettings settings_;
+
+  // Die not held, kNoDie before begin().
+  uint8_t currentDie_;
+
+  // Bit 0 and 1 set while die 0 or 1 has an operation poll() has to check.
+  uint8_t pendingDies_;
+
+  uint8_t dummyCycles_;
+
+  NorEraseCounts* eraseCounts_;
+
+  bool inReadSession_;
+
+  // Bit 0 and 1 set while die 0 or 1 is in XIP.
+  uint8_t xipDies_;
+
+  // In a session, die whose FAST READ goes on with chip select LOW, kNoDie
+  // if none, and the address of its next byte.
+  uint8_t openDie_;
+  uint32_t nextAddress_;
+
+  // Bus of the reads, nullptr for SPI, and their FAST READ.
+  LaneBus* readBus_;
+  NorTransferProfile profile_;
+
+  // Hold the other die, so that only die listens.
+  void useDie(uint8_t die);
+
+  // Hold the other die, start a transaction, select the memory (see
+  // chip_select.h) and send the opcode.
+  void beginCommand(uint8_t die, uint8_t opcode);
+
+  // End the instruction being sent and start another one in the same
+  // transaction.
+  void nextCommand(uint8_t opcode);
+
+  // Deselect the memory and end the transaction.
+  void endCommand();
+
+  // 4 bytes of the address inside its die.
+  void sendAddress(uint32_t address);
+
+  // Start and end the transaction of the reads, on their bus.
+  void beginReadTransaction();
+  void endReadTransaction();
+
+  // Opcode of the FAST READ of the profile, on 1 line.
+  void sendReadOpcode();
+
+  // The 4 bytes of the address and the dummy clocks of a FAST READ, these
+  // as dummy bytes, on the lines of the profile.
+  void sendReadAddress(uint32_t address, uint8_t dummyByte);
+
+  // Back to 1 line and single transfer rate, before chip select goes HIGH.
+  void endReadTransfer();
+
+  // FAST READ of the die up to its first data byte. In a session, only
+  // what is needed to get there (see Read sessions above).
+  void beginRead(uint32_t address);
+
+  // End of a read whose next byte would be nextAddress. In a session chip
+  // select stays LOW.
+  void endRead(uint32_t nextAddress);
+
+  // Put chip select back on HIGH, in a session.
+  void closeRead();
+
+  // Bits 3 of the volatile configuration register of both dies, 0 to
+  // enable XIP.
+  void writeXipBit(uint8_t bit);
+
+  // Bytes from address to the end of its die, at most length.
+  static uint32_t bytesInDie(uint32_t address, uint32_t length);
+
+  // "Error: Invalid address passed to NOR Flash's <method>(...)."
+  static void printInvalidAddress(const __FlashStringHelper* method);
+
+  // "Error: NOR Flash's <method>(...) called in a read session."
+  static void printInReadSession(const __FlashStringHelper* method);
 };
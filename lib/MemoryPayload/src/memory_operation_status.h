@@ -0,0 +1,20 @@
+/**
+ * @file memory_operation_status.h
+ * @brief Result of the non blocking operations of the memory drivers.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * start...() methods return after sending their instructions, and poll()
+ * reads the status register once to say whether the memory has finished.
+ * Neither waits for the memory, so the payload can do other work meanwhile.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+enum class MemoryOperationStatus : uint8_t {
+  kPending, // the memory is still busy with it, poll() again later
+  kDone,
+  kError, // not started (invalid arguments, memory busy) or failed
+};
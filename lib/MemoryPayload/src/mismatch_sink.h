@@ -0,0 +1,61 @@
+/**
+ * @file mismatch_sink.h
+ * @brief Small record of the bytes that did not match during a verify.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * Keeps the first kCapacity mismatches (address and XOR mask between the
+ * expected and the read byte, where each 1 is a flipped bit) plus totals for
+ * all of them, so that a whole memory can be verified with a fixed amount of
+ * RAM no matter how many upsets it has.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class MismatchSink {
+public:
+  static const uint8_t kCapacity = 8;
+
+  struct Mismatch {
+    uint32_t address;
+    uint8_t xorMask;
+  };
+
+  MismatchSink() { clear(); }
+
+  void clear() {
+    stored_ = 0;
+    mismatches_ = 0;
+    flippedBits_ = 0;
+  }
+
+  void record(uint32_t address, uint8_t xorMask) {
+    if (stored_ < kCapacity) {
+      entries_[stored_].address = address;
+      entries_[stored_].xorMask = xorMask;
+      ++stored_;
+    }
+    ++mismatches_;
+    while (xorMask != 0) { // count set bits, at most 8 iterations
+      xorMask &= xorMask - 1;
+      ++flippedBits_;
+    }
+  }
+
+  // Mismatches kept, up to kCapacity.
+  uint8_t stored() const { return stored_; }
+  const Mismatch& at(uint8_t index) const { return entries_[index]; }
+
+  // Every mismatch recorded since the last clear(), kept or not.
+  uint32_t mismatches() const { return mismatches_; }
+  uint32_t flippedBits() const { return flippedBits_; }
+  bool overflowed() const { return mismatches_ > stored_; }
+
+private:
+  Mismatch entries_[kCapacity];
+  uint8_t stored_;
+  uint32_t mismatches_;
+  uint32_t flippedBits_;
+};
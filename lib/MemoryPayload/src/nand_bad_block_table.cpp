@@ -0,0 +1,50 @@
+#include "./nand_bad_block_table.h"
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+// "BB", also tells a stored table from an erased EEPROM (all 0xFF).
+static const uint8_t kSignature[2] = {0x42, 0x42};
+
+uint16_t NandBadBlockTable::badBlocks() const {
+  uint16_t blocks = 0;
+  for (uint16_t block = 0; block < kBlocks; ++block) {
+    blocks += isBad(block);
+  }
+  return blocks;
+}
+
+void NandBadBlockTable::save(uint16_t eepromAddress) const {
+  EEPROM.update(eepromAddress, kSignature[0]);
+  EEPROM.update(eepromAddress + 1, kSignature[1]);
+  for (uint8_t i = 0; i < kBlocks / 8; ++i) {
+    EEPROM.update(eepromAddress + 2 + i, bits_[i]);
+  }
+  EEPROM.update(eepromAddress + 2 + kBlocks / 8, checksum());
+}
+
+bool NandBadBlockTable::load(uint16_t eepromAddress) {
+  if (EEPROM.read(eepromAddress) != kSignature[0] ||
+      EEPROM.read(eepromAddress + 1) != kSignature[1]) {
+    clear();
+    return false;
+  }
+  for (uint8_t i = 0; i < kBlocks / 8; ++i) {
+    bits_[i] = EEPROM.read(eepromAddress + 2 + i);
+  }
+  if (EEPROM.read(eepromAddress + 2 + kBlocks / 8) != checksum()) {
+    clear();
+    return false;
+  }
+  return true;
+}
+
+// XOR of the bitmap bytes, inverted so that an all 0 table does not have
+// an all 0 checksum.
+uint8_t NandBadBlockTable::checksum() const {
+  uint8_t value = 0xFF;
+  for (uint8_t i = 0; i < kBlocks / 8; ++i) {
+    value ^= bits_[i];
+  }
+  return value;
+}
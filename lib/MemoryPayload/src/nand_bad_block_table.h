@@ -0,0 +1,72 @@
+/**
+ * @file nand_bad_block_table.h
+ * @brief Bitmap of the bad blocks of the NAND Flash, kept in the internal
+ *    EEPROM of the Arduino so that the array is only scanned at first boot.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * The W25N01GV can ship with up to 20 bad blocks, marked with a byte other
+ * than 0xFF at the first spare byte (column 2048) of their first page.
+ * MemoryNANDFlash::scanBadBlocks() reads those markers into a
+ * NandBadBlockTable, one bit per block, 128 bytes for the 1024 blocks.
+ * The markers are lost when a bad block is erased, so the table has to be
+ * built before anything is erased and then kept: save() stores it in the
+ * ATmega328's EEPROM (not the M95M02, which is under test) and load()
+ * reads it back on the following boots.
+ *
+ * Once handed to the driver with MemoryNANDFlash::setBadBlockTable(), the
+ * erase, program and verify paths skip the bad blocks, so no bus time is
+ * spent on them and their manufacturing defects do not show up as upsets.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class NandBadBlockTable {
+public:
+  static const uint16_t kBlocks = 1024;
+
+  // Bytes save() takes in the internal EEPROM: 2 byte signature, the
+  // bitmap and a 1 byte checksum.
+  static const uint16_t kStoredBytes = 2 + kBlocks / 8 + 1;
+
+  NandBadBlockTable() { clear(); }
+
+  void clear() {
+    for (uint8_t i = 0; i < kBlocks / 8; ++i) {
+      bits_[i] = 0;
+    }
+  }
+
+  bool isBad(uint16_t block) const {
+    return block < kBlocks && (bits_[block / 8] & (1 << (block % 8))) != 0;
+  }
+
+  void markBad(uint16_t block) {
+    if (block < kBlocks) {
+      bits_[block / 8] |= 1 << (block % 8);
+    }
+  }
+
+  uint16_t badBlocks() const;
+
+  /**
+   * @brief Store the table from eepromAddress of the internal EEPROM. Only
+   *    the bytes that changed are written.
+   */
+  void save(uint16_t eepromAddress) const;
+
+  /**
+   * @brief Read the table stored by save() at eepromAddress.
+   *
+   * @return false, with the table cleared, if nothing valid is stored
+   *    there, which means the NAND Flash has to be scanned.
+   */
+  bool load(uint16_t eepromAddress);
+
+private:
+  uint8_t bits_[kBlocks / 8];
+
+  uint8_t checksum() const;
+};
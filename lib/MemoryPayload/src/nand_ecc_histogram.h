@@ -0,0 +1,131 @@
+/**
+ * @file nand_ecc_histogram.h
+ * @brief Per block count of the pages the NAND Flash's internal ECC had to
+ *    correct, or could not, while being read.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * After every page data read the W25N01GV reports in ECC-1/ECC-0 of SR-3
+ * whether the page had no error, errors it corrected or more errors than it
+ * could correct. The chip has already compared every bit of the page against
+ * its ECC, so each report is an upset counter that costs a single status
+ * register read.
+ *
+ * MemoryNANDFlash::setEccHistogram() hands the reports of every page load to
+ * a NandEccHistogram, which counts them per block of 64 pages. A byte for
+ * each of the 1024 blocks would take half the RAM of the Arduino Nano, and
+ * upsets only reach a few blocks per pass, so only the first
+ * kFollowedBlocks blocks with a report get counts of their own: corrected
+ * pages in the low nibble and uncorrectable ones in the high nibble, both
+ * saturating at 15. A bit per block tells which ones had any report, so
+ * affectedBlocks() stays exact, and 32 bit totals do not saturate. 128 +
+ * 32 * 3 + 1 + 12 = 237 bytes.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class NandEccHistogram {
+public:
+  static const uint16_t kBlocks = 1024;
+  static const uint8_t kFollowedBlocks = 32;
+  static const uint8_t kMaxCount = 15;
+
+  NandEccHistogram() { clear(); }
+
+  void clear() {
+    for (uint8_t i = 0; i < kBlocks / 8; ++i) {
+      affected_[i] = 0;
+    }
+    followed_ = 0;
+    pages_ = 0;
+    corrected_ = 0;
+    uncorrectable_ = 0;
+  }
+
+  /**
+   * @param block lower than kBlocks, page address / 64.
+   * @param eccBits ECC-1/ECC-0 of SR-3 as bits 1 and 0: 0 no error, 1
+   *    corrected, 2 or 3 uncorrectable.
+   */
+  void record(uint16_t block, uint8_t eccBits) {
+    ++pages_;
+    if (eccBits == 0 || block >= kBlocks) {
+      return;
+    }
+    affected_[block / 8] |= 1 << (block % 8);
+    if (eccBits == 1) {
+      ++corrected_;
+    } else {
+      ++uncorrectable_;
+    }
+    const uint8_t i = indexOf(block);
+    if (i == followed_) {
+      if (followed_ == kFollowedBlocks) {
+        return;
+      }
+      entries_[i].block = block;
+      entries_[i].counts = 0;
+      ++followed_;
+    }
+    uint8_t& count = entries_[i].counts;
+    if (eccBits == 1) {
+      if ((count & 0x0F) < kMaxCount) {
+        ++count;
+      }
+    } else if ((count >> 4) < kMaxCount) {
+      count += 0x10;
+    }
+  }
+
+  // 0 for a block that is not followed.
+  uint8_t corrected(uint16_t block) const { return counts(block) & 0x0F; }
+  uint8_t uncorrectable(uint16_t block) const { return counts(block) >> 4; }
+
+  // Every report recorded since the last clear(), clean ones included.
+  uint32_t pages() const { return pages_; }
+  uint32_t totalCorrected() const { return corrected_; }
+  uint32_t totalUncorrectable() const { return uncorrectable_; }
+
+  // Blocks with at least one corrected or uncorrectable page.
+  uint16_t affectedBlocks() const {
+    uint16_t blocks = 0;
+    for (uint8_t i = 0; i < kBlocks / 8; ++i) {
+      for (uint8_t bits = affected_[i]; bits != 0; bits &= bits - 1) {
+        ++blocks;
+      }
+    }
+    return blocks;
+  }
+
+  // Blocks with counts of their own, the first ones affected.
+  uint8_t followedBlocks() const { return followed_; }
+
+private:
+  struct Entry {
+    uint16_t block;
+    uint8_t counts;
+  };
+
+  uint8_t affected_[kBlocks / 8];
+  Entry entries_[kFollowedBlocks];
+  uint8_t followed_;
+  uint32_t pages_;
+  uint32_t corrected_;
+  uint32_t uncorrectable_;
+
+  // Entry of the block, followed_ if it is not followed.
+  uint8_t indexOf(uint16_t block) const {
+    uint8_t i = 0;
+    while (i < followed_ && entries_[i].block != block) {
+      ++i;
+    }
+    return i;
+  }
+
+  uint8_t counts(uint16_t block) const {
+    const uint8_t i = indexOf(block);
+    return i == followed_ ? 0 : entries_[i].counts;
+  }
+};
@@ -0,0 +1,41 @@
+#include "./nand_fill_progress.h"
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+// "FP", also tells a stored checkpoint from an erased EEPROM (all 0xFF).
+static const uint8_t kSignature[2] = {0x46, 0x50};
+
+// Little endian, the counters follow the signature.
+void NandFillProgress::save(uint16_t eepromAddress) const {
+  EEPROM.update(eepromAddress, kSignature[0]);
+  EEPROM.update(eepromAddress + 1, kSignature[1]);
+  EEPROM.update(eepromAddress + 2, nextBlock_ & 0xFF);
+  EEPROM.update(eepromAddress + 3, nextBlock_ >> 8);
+  EEPROM.update(eepromAddress + 4, failedBlocks_ & 0xFF);
+  EEPROM.update(eepromAddress + 5, failedBlocks_ >> 8);
+  EEPROM.update(eepromAddress + 6, checksum());
+}
+
+bool NandFillProgress::load(uint16_t eepromAddress) {
+  clear();
+  if (EEPROM.read(eepromAddress) != kSignature[0] ||
+      EEPROM.read(eepromAddress + 1) != kSignature[1]) {
+    return false;
+  }
+  nextBlock_ = EEPROM.read(eepromAddress + 2) |
+      (uint16_t)EEPROM.read(eepromAddress + 3) << 8;
+  failedBlocks_ = EEPROM.read(eepromAddress + 4) |
+      (uint16_t)EEPROM.read(eepromAddress + 5) << 8;
+  if (EEPROM.read(eepromAddress + 6) != checksum()) {
+    clear();
+    return false;
+  }
+  return true;
+}
+
+// Same as the bad block table: XOR of the bytes, inverted.
+uint8_t NandFillProgress::checksum() const {
+  return ~((nextBlock_ & 0xFF) ^ (nextBlock_ >> 8) ^ (failedBlocks_ & 0xFF) ^
+      (failedBlocks_ >> 8));
+}
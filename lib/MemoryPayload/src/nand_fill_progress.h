@@ -0,0 +1,80 @@
+/**
+ * @file nand_fill_progress.h
+ * @brief How far MemoryNANDFlash::fill() got writing a pattern to the whole
+ *    NAND Flash, as a checkpoint kept in the internal EEPROM of the Arduino.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * Filling the W25N01GV takes minutes: an erase and 64 programs per block,
+ * about 200 ms, for 1024 blocks. fill() works a given amount of blocks at a
+ * time, in order, and leaves the next block to write in a NandFillProgress.
+ * Saving it after every call means a reset halfway through only costs the
+ * blocks since the last save(): on the next boot load() gives the block to
+ * go on from, with the same pattern.
+ *
+ * 7 bytes of the ATmega328's EEPROM ("FP" signature, next block, failed
+ * blocks, checksum), written only where they changed. The slowest times
+ * are only for the report of this boot and are not stored.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class NandFillProgress {
+public:
+  static const uint16_t kStoredBytes = 2 + 2 + 2 + 1;
+
+  NandFillProgress() { clear(); }
+
+  // Back to the first block, for a new fill.
+  void clear() {
+    nextBlock_ = 0;
+    failedBlocks_ = 0;
+    slowestEraseMicros_ = 0;
+    slowestPageMicros_ = 0;
+  }
+
+  // Block fill() writes next, every lower one is done.
+  uint16_t nextBlock() const { return nextBlock_; }
+
+  // Blocks whose erase or some program failed.
+  uint16_t failedBlocks() const { return failedBlocks_; }
+
+  uint32_t slowestEraseMicros() const { return slowestEraseMicros_; }
+  uint32_t slowestPageMicros() const { return slowestPageMicros_; }
+
+  /**
+   * @brief nextBlock() is done, by fill(). Bad blocks are skipped with
+   *    eraseMicros = 0 and failed = false.
+   */
+  void completeBlock(uint32_t eraseMicros, uint32_t slowestPageMicros,
+      bool failed) {
+    ++nextBlock_;
+    failedBlocks_ += failed;
+    if (eraseMicros > slowestEraseMicros_) {
+      slowestEraseMicros_ = eraseMicros;
+    }
+    if (slowestPageMicros > slowestPageMicros_) {
+      slowestPageMicros_ = slowestPageMicros;
+    }
+  }
+
+  // Store the checkpoint from eepromAddress of the internal EEPROM.
+  void save(uint16_t eepromAddress) const;
+
+  /**
+   * @brief Read the checkpoint stored by save() at eepromAddress.
+   *
+   * @return false, with the progress cleared, if nothing valid is stored.
+   */
+  bool load(uint16_t eepromAddress);
+
+private:
+  uint16_t nextBlock_;
+  uint16_t failedBlocks_;
+  uint32_t slowestEraseMicros_;
+  uint32_t slowestPageMicros_;
+
+  uint8_t checksum() const;
+};
@@ -0,0 +1,84 @@
+#include "./nand_geometry.h"
+
+static const uint8_t kSignature[4] = {'O', 'N', 'F', 'I'};
+static const uint8_t kCrcOffset = 254;
+
+// 0 if value is not a power of 2.
+static uint8_t log2OfPowerOf2(uint32_t value) {
+  if (value == 0 || (value & (value - 1)) != 0) {
+    return 0;
+  }
+  uint8_t shift = 0;
+  while (value > 1) {
+    value >>= 1;
+    ++shift;
+  }
+  return shift;
+}
+
+void NandParameterPage::clear() {
+  crc_ = 0x4F4E;
+  bytes_ = 0;
+  signature_ = true;
+  manufacturerId_ = 0;
+  storedCrc_ = 0;
+}
+
+// The CRC is updated a bit at a time, MSB first, no table to keep in RAM.
+void NandParameterPage::write(uint32_t offset, const uint8_t* chunk,
+    uint8_t size) {
+  for (uint8_t i = 0; i < size; ++i) {
+    const uint32_t position = offset + i;
+    const uint8_t value = chunk[i];
+    if (position < kCrcOffset) {
+      crc_ ^= (uint16_t)value << 8;
+      for (uint8_t bit = 0; bit < 8; ++bit) {
+        crc_ = (crc_ & 0x8000) ? (uint16_t)((crc_ << 1) ^ 0x8005)
+                               : (uint16_t)(crc_ << 1);
+      }
+    }
+    if (position < sizeof(kSignature) && value != kSignature[position]) {
+      signature_ = false;
+    } else if (position == 64) {
+      manufacturerId_ = value;
+    } else if (position >= kFirstField && position <= kLastField) {
+      fields_[position - kFirstField] = value;
+    } else if (position == kCrcOffset) {
+      storedCrc_ = value;
+    } else if (position == kCrcOffset + 1) {
+      storedCrc_ |= (uint16_t)value << 8;
+    }
+  }
+  bytes_ += size;
+}
+
+uint32_t NandParameterPage::field(uint8_t offset, uint8_t size) const {
+  uint32_t value = 0;
+  for (uint8_t i = size; i > 0; --i) {
+    value = (value << 8) | fields_[offset - kFirstField + i - 1];
+  }
+  return value;
+}
+
+bool NandParameterPage::geometry(NandGeometry& geometry) const {
+  if (bytes_ < kCopyBytes || !signature_ || crc_ != storedCrc_) {
+    return false;
+  }
+  const uint32_t dataBytes = field(80, 4);
+  const uint32_t spareBytes = field(84, 2);
+  const uint32_t blocks = field(96, 4);
+  const uint8_t columnShift = log2OfPowerOf2(dataBytes);
+  const uint8_t blockShift = log2OfPowerOf2(field(92, 4));
+  if (columnShift == 0 || columnShift > 15 || blockShift == 0 ||
+      blockShift > 15 || spareBytes > 255 || blocks == 0 || blocks > 0xFFFF ||
+      field(100, 1) != 1) {
+    return false;
+  }
+  geometry.dataBytes = dataBytes;
+  geometry.spareBytes = spareBytes;
+  geometry.columnShift = columnShift;
+  geometry.blockShift = blockShift;
+  geometry.blocks = blocks;
+  geometry.eccBits = field(112, 1);
+  return true;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file nand_geometry.h
+ * @brief Page, block and array sizes of the NAND Flash, as its parameter
+ *    page describes them.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * The W25N01GV keeps an ONFI style parameter page among its OTP pages (page
+ * 1 with OTP-E = 1 at SR-2, datasheet 8.2.27): 3 copies of 256 bytes, each
+ * one ending with a CRC-16 over the rest of it. The fields used here are
+ * little endian:
+ *
+ *   0-3   "ONFI"
+ *   64    JEDEC manufacturer ID
+ *   80-83 data bytes per page
+ *   84-85 spare bytes per page
+ *   92-95 pages per block
+ *   96-99 blocks per logical unit
+ *   100   logical units
+ *   112   bits of ECC correctability
+ *   254   CRC-16, polynomial 0x8005, initial value 0x4F4E
+ *
+ * MemoryNANDFlash::detectGeometry() streams a copy through a
+ * NandParameterPage, 256 bytes would be an eighth of the RAM of the Nano,
+ * and keeps the NandGeometry the driver, its adapters and the bus tasks
+ * address the array with. Until then, or if the page cannot be trusted, it
+ * is kW25N01GVGeometry.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "./chunk_stream.h"
+
+struct NandGeometry {
+  // The buffers of the driver and the tables (nand_bad_block_table.h,
+  // nand_ecc_histogram.h) are sized for the W25N01GV, page addresses are 16
+  // bits and nand_program_tracker.h keeps the page of a block in a byte.
+  static const uint16_t kMaxPageBytes = 2112;
+  static const uint16_t kMaxBlocks = 1024;
+  static const uint32_t kMaxPages = 65536;
+  static const uint16_t kMaxPagesPerBlock = 256;
+
+  uint16_t dataBytes; // a power of 2
+  uint8_t spareBytes;
+  uint8_t columnShift; // log2(dataBytes), see MemoryNANDFlash::readByte()
+  uint8_t blockShift; // log2(pages per block)
+  uint16_t blocks;
+  uint8_t eccBits; // correctable bits per sector
+
+  uint16_t pageBytes() const { return dataBytes + spareBytes; }
+  uint16_t pagesPerBlock() const { return 1u << blockShift; }
+  uint32_t pages() const { return (uint32_t)blocks << blockShift; }
+
+  // Linear addresses, page * pageBytes() + column, spare areas included.
+  uint32_t arrayBytes() const { return pages() * pageBytes(); }
+
+  // Data areas only, page * dataBytes + column.
+  uint32_t dataAreaBytes() const { return pages() * dataBytes; }
+
+  uint16_t blockOf(uint32_t pageAddress) const {
+    return pageAddress >> blockShift;
+  }
+
+  uint32_t firstPageOf(uint16_t block) const {
+    return (uint32_t)block << blockShift;
+  }
+
+  // Position of the page in its block.
+  uint16_t pageInBlock(uint32_t pageAddress) const {
+    return pageAddress & (pagesPerBlock() - 1);
+  }
+
+  // Fits the buffers, the tables and 16 bit page addresses.
+  bool isSupported() const {
+    return pageBytes() <= kMaxPageBytes && blocks <= kMaxBlocks &&
+        pages() <= kMaxPages && pagesPerBlock() <= kMaxPagesPerBlock;
+  }
+};
+
+// 2048 + 64 bytes per page, 64 pages per block, 1024 blocks, 1 bit of ECC.
+const NandGeometry kW25N01GVGeometry = {2048, 64, 11, 6, 1024, 1};
+
+/**
+ * @brief Checks a 256 byte copy of the parameter page as it goes by, chunk
+ *    by chunk, keeping only the fields of the geometry.
+ */
+class NandParameterPage : public ChunkSink {
+public:
+  static const uint16_t kCopyBytes = 256;
+
+  NandParameterPage() { clear(); }
+
+  void clear();
+
+  // offset from the start of the copy.
+  void write(uint32_t offset, const uint8_t* chunk, uint8_t size) override;
+
+  /**
+   * @brief Fill geometry from the copy written so far.
+   *
+   * @return false, leaving geometry untouched, if the copy is incomplete,
+   *    lacks the signature, fails its CRC or holds sizes that are not powers
+   *    of 2 or more than one logical unit.
+   */
+  bool geometry(NandGeometry& geometry) const;
+
+  uint8_t manufacturerId() const { return manufacturerId_; }
+
+private:
+  static const uint8_t kFirstField = 80;
+  static const uint8_t kLastField = 112;
+
+  uint16_t crc_;
+  uint16_t bytes_;
+  bool signature_;
+  uint8_t manufacturerId_;
+  uint8_t fields_[kLastField - kFirstField + 1];
+  uint16_t storedCrc_;
+
+  uint32_t field(uint8_t offset, uint8_t size) const;
+};
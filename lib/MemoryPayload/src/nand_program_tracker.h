@@ -0,0 +1,133 @@
+/**
+ * @file nand_program_tracker.h
+ * @brief Count of the programs of the NAND Flash pages still open to
+ *    partial programs, so that no page gets more than the 4 the W25N01GV
+ *    allows (NOP = 4).
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * The pages of a block have to be programmed from the lowest to the
+ * highest, so once a page of a block is programmed the lower ones are
+ * closed and only the last programmed page can take further partial
+ * programs. That is all there is to track per block: its last programmed
+ * page and how many times it was programmed.
+ *
+ * A counter per page of the array would not fit in the RAM of the Nano, so
+ * a NandProgramTracker follows up to kBlocks blocks, the ones programmed
+ * since they were erased by the driver. A block not followed yet is taken
+ * as erased, the precondition of every program, and takes a free entry;
+ * erasing a block frees its entry. When every entry is taken, programs on
+ * other blocks are refused, instead of forgetting a count.
+ *
+ * MemoryNANDFlash::setProgramTracker() makes the driver consult it before
+ * every program.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class NandProgramTracker {
+public:
+  static const uint8_t kBlocks = 8;
+  static const uint8_t kMaxPrograms = 4;
+
+  NandProgramTracker() { clear(); }
+
+  void clear() {
+    for (uint8_t i = 0; i < kBlocks; ++i) {
+      entries_[i].programs = 0;
+    }
+  }
+
+  /**
+   * @brief Whether the page can be programmed once more: its block has an
+   *    entry or a free one, no higher page of the block has been programmed
+   *    and the page has had less than kMaxPrograms programs.
+   *
+   * @param page position of the page in the block (see nand_geometry.h).
+   */
+  bool canProgram(uint16_t block, uint8_t page) const {
+    const Entry* entry = find(block);
+    if (entry == nullptr) {
+      return findFree() != nullptr;
+    }
+    return page > entry->page ||
+        (page == entry->page && entry->programs < kMaxPrograms);
+  }
+
+  // Count a program of the page, which canProgram() allowed.
+  void recordProgram(uint16_t block, uint8_t page) {
+    Entry* entry = find(block);
+    if (entry == nullptr) {
+      entry = findFree();
+      if (entry == nullptr) {
+        return;
+      }
+      entry->block = block;
+      entry->page = page;
+      entry->programs = 0;
+    }
+    if (page != entry->page) {
+      entry->page = page;
+      entry->programs = 0;
+    }
+    ++entry->programs;
+  }
+
+  // The block was erased, every page of it can be programmed again.
+  void recordErase(uint16_t block) {
+    Entry* entry = find(block);
+    if (entry != nullptr) {
+      entry->programs = 0;
+    }
+  }
+
+  // Programs of the page if it is the last programmed of a followed block,
+  // 0 otherwise.
+  uint8_t programs(uint16_t block, uint8_t page) const {
+    const Entry* entry = find(block);
+    if (entry == nullptr || entry->page != page) {
+      return 0;
+    }
+    return entry->programs;
+  }
+
+private:
+  // programs = 0 marks a free entry.
+  struct Entry {
+    uint16_t block;
+    uint8_t page;
+    uint8_t programs;
+  };
+
+  Entry entries_[kBlocks];
+
+  const Entry* find(uint16_t block) const {
+    for (uint8_t i = 0; i < kBlocks; ++i) {
+      if (entries_[i].programs != 0 && entries_[i].block == block) {
+        return &entries_[i];
+      }
+    }
+    return nullptr;
+  }
+
+  Entry* find(uint16_t block) {
+    const NandProgramTracker* self = this;
+    return const_cast<Entry*>(self->find(block));
+  }
+
+  const Entry* findFree() const {
+    for (uint8_t i = 0; i < kBlocks; ++i) {
+      if (entries_[i].programs == 0) {
+        return &entries_[i];
+      }
+    }
+    return nullptr;
+  }
+
+  Entry* findFree() {
+    const NandProgramTracker* self = this;
+    return const_cast<Entry*>(self->findFree());
+  }
+};
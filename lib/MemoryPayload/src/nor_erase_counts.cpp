@@ -0,0 +1,146 @@
+#include "./nor_erase_counts.h"
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+// "EC", also tells stored counts from an erased EEPROM (all 0xFF).
+static const uint8_t kSignature[2] = {0x45, 0x43};
+
+static const uint8_t kDataBytes = NorEraseCounts::kStoredBytes - 3;
+
+void NorEraseCounts::clear() {
+  dieErases_[0] = 0;
+  dieErases_[1] = 0;
+  for (uint8_t i = 0; i < kFollowedSectors; ++i) {
+    entries_[i].sector = 0;
+    entries_[i].erases = 0;
+  }
+}
+
+void NorEraseCounts::recordDieErase(uint8_t die) {
+  if (die < 2) {
+    ++dieErases_[die];
+  }
+}
+
+void NorEraseCounts::recordSectorErase(uint16_t sector) {
+  if (sector >= kSectors) {
+    return;
+  }
+  Entry* entry = nullptr;
+  Entry* fewest = &entries_[0];
+  for (uint8_t i = 0; i < kFollowedSectors; ++i) {
+    if (entries_[i].erases != 0 && entries_[i].sector == sector) {
+      ++entries_[i].erases;
+      return;
+    }
+    if (entries_[i].erases == 0 && entry == nullptr) {
+      entry = &entries_[i];
+    }
+    if (entries_[i].erases < fewest->erases) {
+      fewest = &entries_[i];
+    }
+  }
+  if (entry == nullptr) {
+    dieErases_[fewest->sector / kSectorsPerDie] += fewest->erases;
+    entry = fewest;
+  }
+  entry->sector = sector;
+  entry->erases = 1;
+}
+
+uint32_t NorEraseCounts::erases(uint16_t sector) const {
+  if (sector >= kSectors) {
+    return 0;
+  }
+  uint32_t count = dieErases_[sector / kSectorsPerDie];
+  for (uint8_t i = 0; i < kFollowedSectors; ++i) {
+    if (entries_[i].erases != 0 && entries_[i].sector == sector) {
+      count += entries_[i].erases;
+    }
+  }
+  return count;
+}
+
+// A sector not followed has the count of its die, the first sector of the
+// die stands for them.
+uint16_t NorEraseCounts::mostErasedSector() const {
+  uint16_t most = dieErases_[1] > dieErases_[0] ? kSectorsPerDie : 0;
+  uint32_t mostErases = erases(most);
+  for (uint8_t i = 0; i < kFollowedSectors; ++i) {
+    if (entries_[i].erases == 0) {
+      continue;
+    }
+    const uint32_t count = erases(entries_[i].sector);
+    if (count > mostErases ||
+        (count == mostErases && entries_[i].sector < most)) {
+      most = entries_[i].sector;
+      mostErases = count;
+    }
+  }
+  return most;
+}
+
+void NorEraseCounts::save(uint16_t eepromAddress) const {
+  EEPROM.update(eepromAddress, kSignature[0]);
+  EEPROM.update(eepromAddress + 1, kSignature[1]);
+  for (uint8_t i = 0; i < kDataBytes; ++i) {
+    EEPROM.update(eepromAddress + 2 + i, storedByte(i));
+  }
+  EEPROM.update(eepromAddress + 2 + kDataBytes, checksum());
+}
+
+bool NorEraseCounts::load(uint16_t eepromAddress) {
+  clear();
+  if (EEPROM.read(eepromAddress) != kSignature[0] ||
+      EEPROM.read(eepromAddress + 1) != kSignature[1]) {
+    return false;
+  }
+  for (uint8_t i = 0; i < kDataBytes; ++i) {
+    setStoredByte(i, EEPROM.read(eepromAddress + 2 + i));
+  }
+  if (EEPROM.read(eepromAddress + 2 + kDataBytes) != checksum()) {
+    clear();
+    return false;
+  }
+  return true;
+}
+
+uint8_t NorEraseCounts::storedByte(uint8_t index) const {
+  if (index < 8) {
+    return dieErases_[index / 4] >> (8 * (index % 4));
+  }
+  const Entry& entry = entries_[(index - 8) / 6];
+  const uint8_t offset = (index - 8) % 6;
+  if (offset < 2) {
+    return entry.sector >> (8 * offset);
+  }
+  return entry.erases >> (8 * (offset - 2));
+}
+
+void NorEraseCounts::setStoredByte(uint8_t index, uint8_t value) {
+  if (index < 8) {
+    const uint8_t shift = 8 * (index % 4);
+    uint32_t& count = dieErases_[index / 4];
+    count = (count & ~(0xFFul << shift)) | (uint32_t)value << shift;
+    return;
+  }
+  Entry& entry = entries_[(index - 8) / 6];
+  const uint8_t offset = (index - 8) % 6;
+  if (offset < 2) {
+    const uint8_t shift = 8 * offset;
+    entry.sector = (entry.sector & ~(0xFF << shift)) | (uint16_t)value << shift;
+    return;
+  }
+  const uint8_t shift = 8 * (offset - 2);
+  entry.erases = (entry.erases & ~(0xFFul << shift)) | (uint32_t)value << shift;
+}
+
+// Same as the bad block table: XOR of the bytes, inverted.
+uint8_t NorEraseCounts::checksum() const {
+  uint8_t checksum = 0;
+  for (uint8_t i = 0; i < kDataBytes; ++i) {
+    checksum ^= storedByte(i);
+  }
+  return ~checksum;
+}
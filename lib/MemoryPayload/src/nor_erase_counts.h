@@ -0,0 +1,87 @@
+/**
+ * @file nor_erase_counts.h
+ * @brief Erase cycles of the sectors of the NOR Flash, against the 100000
+ *    the MT25TL01G guarantees, kept in the internal EEPROM of the Arduino.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * A counter for each of the 2048 sectors would not fit in the RAM of the
+ * Nano, nor in its 1 KByte of EEPROM. Most erases are of whole dies
+ * (every fill of the array), so those are counted once per die, and on
+ * top of that up to kFollowedSectors sectors have a count of their own
+ * erases, the ones rewritten after upsets.
+ *
+ * When every entry is taken, the one with the fewest erases makes room:
+ * its count is added to its die, which makes the count of the other
+ * sectors of that die higher than it really is. erases() is therefore
+ * never lower than the real count, which is what a limit needs.
+ *
+ * A sector counts one erase for each rewrite that erases any of it, be it
+ * the whole sector or some of its subsectors, since no subsector is
+ * erased twice by a single plan (see MemoryNORFlash::rewrite()).
+ *
+ * 2 + 8 + 16 * 6 + 1 = 107 bytes of the ATmega328's EEPROM ("EC"
+ * signature, die counts, followed sectors, checksum), written only where
+ * they changed.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class NorEraseCounts {
+public:
+  static const uint16_t kSectors = 2048; // both dies
+  static const uint16_t kSectorsPerDie = 1024;
+  static const uint8_t kFollowedSectors = 16;
+  static const uint32_t kEnduranceCycles = 100000;
+
+  static const uint16_t kStoredBytes = 2 + 2 * 4 + kFollowedSectors * 6 + 1;
+
+  NorEraseCounts() { clear(); }
+
+  void clear();
+
+  // Every sector of the die was erased.
+  void recordDieErase(uint8_t die);
+
+  // The sector, or some of its subsectors, was erased.
+  void recordSectorErase(uint16_t sector);
+
+  // Erase cycles of the sector, never lower than the real ones.
+  uint32_t erases(uint16_t sector) const;
+
+  bool isWornOut(uint16_t sector) const {
+    return erases(sector) >= kEnduranceCycles;
+  }
+
+  // Sector with the highest erases(), the lowest one on ties.
+  uint16_t mostErasedSector() const;
+
+  // Store the counts from eepromAddress of the internal EEPROM.
+  void save(uint16_t eepromAddress) const;
+
+  /**
+   * @brief Read the counts stored by save() at eepromAddress.
+   *
+   * @return false, with the counts cleared, if nothing valid is stored.
+   */
+  bool load(uint16_t eepromAddress);
+
+private:
+  // erases = 0 marks a free entry.
+  struct Entry {
+    uint16_t sector;
+    uint32_t erases; // on top of those of its die
+  };
+
+  uint32_t dieErases_[2];
+  Entry entries_[kFollowedSectors];
+
+  // Byte index of the stored counts, without signature and checksum, the
+  // die counts and then the entries, each little endian.
+  uint8_t storedByte(uint8_t index) const;
+  void setStoredByte(uint8_t index, uint8_t value);
+
+  uint8_t checksum() const;
+};
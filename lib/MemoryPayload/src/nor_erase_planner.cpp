@@ -0,0 +1,249 @@
+#include "./nor_erase_planner.h"
+
+namespace {
+
+const uint8_t kSubsectorsPerSector = 16;
+
+uint8_t countBits(uint16_t bits) {
+  uint8_t count = 0;
+  while (bits != 0) {
+    bits &= bits - 1;
+    ++count;
+  }
+  return count;
+}
+
+// Lowest set bit, bits != 0.
+uint8_t lowestBit(uint16_t bits) {
+  uint8_t bit = 0;
+  while ((bits & 1) == 0) {
+    bits >>= 1;
+    ++bit;
+  }
+  return bit;
+}
+
+} // namespace
+
+void NorErasePlanner::clear() {
+  rangeCount_ = 0;
+  cursor_ = 0;
+  range_ = 0;
+  weighedDie_ = kNoDie;
+  plannedMicros_ = 0;
+  plannedBytes_ = 0;
+}
+
+/**
+ * ranges_ stays sorted and without two ranges that overlap or touch: the
+ * new one absorbs every range it reaches, or is inserted between them.
+ */
+void NorErasePlanner::addRange(uint32_t address, uint32_t length) {
+  if (address >= kCapacity || length == 0) {
+    return;
+  }
+  if (length > kCapacity - address) {
+    length = kCapacity - address;
+  }
+  uint32_t first = address / kSubsectorBytes * kSubsectorBytes;
+  uint32_t end = (address + length + kSubsectorBytes - 1) / kSubsectorBytes *
+      kSubsectorBytes;
+  uint8_t i = 0;
+  while (i < rangeCount_ && ranges_[i].end < first) {
+    ++i;
+  }
+  uint8_t j = i;
+  while (j < rangeCount_ && ranges_[j].first <= end) {
+    if (ranges_[j].first < first) {
+      first = ranges_[j].first;
+    }
+    if (ranges_[j].end > end) {
+      end = ranges_[j].end;
+    }
+    ++j;
+  }
+  if (j > i) { // ranges i to j - 1 become one
+    ranges_[i].first = first;
+    ranges_[i].end = end;
+    for (uint8_t k = j; k < rangeCount_; ++k) {
+      ranges_[i + 1 + k - j] = ranges_[k];
+    }
+    rangeCount_ -= j - i - 1;
+    return;
+  }
+  if (rangeCount_ == kMaxRanges) { // grow the nearest one instead
+    const bool hasLeft = i > 0;
+    const bool hasRight = i < rangeCount_;
+    if (hasLeft && (!hasRight ||
+        first - ranges_[i - 1].end <= ranges_[i].first - end)) {
+      ranges_[i - 1].end = end;
+    } else {
+      ranges_[i].first = first;
+    }
+    return;
+  }
+  for (uint8_t k = rangeCount_; k > i; --k) {
+    ranges_[k] = ranges_[k - 1];
+  }
+  ranges_[i].first = first;
+  ranges_[i].end = end;
+  ++rangeCount_;
+}
+
+/**
+ * Only erases that start at or above cursor_ are weighed, so the choices
+ * made for a sector or a half when its first erase was planned hold for
+ * the following ones.
+ */
+bool NorErasePlanner::next(NorEraseCommand& command) {
+  while (range_ < rangeCount_ && ranges_[range_].end <= cursor_) {
+    ++range_;
+  }
+  if (range_ == rangeCount_) {
+    return false;
+  }
+  const uint32_t dirty = ranges_[range_].first > cursor_ ?
+      ranges_[range_].first : cursor_;
+  const uint8_t die = dirty / kDieBytes;
+  if (die != weighedDie_) {
+    weighedDie_ = die;
+    if (isDieEraseCheaper(die)) {
+      plan(command, NorEraseSize::kDie, die * kDieBytes);
+      return true;
+    }
+  }
+  const uint16_t sector = dirty / kSectorBytes;
+  const uint32_t sectorFirst = (uint32_t)sector * kSectorBytes;
+  const uint8_t from = cursor_ > sectorFirst ?
+      (cursor_ - sectorFirst) / kSubsectorBytes : 0;
+  const uint16_t dirtyBits = dirtySubsectors(sector) & (0xFFFF << from);
+  const uint8_t lowHalf = dirtyBits & 0xFF;
+  const uint8_t highHalf = dirtyBits >> 8;
+  if (from == 0 && sectorMicros(dirtyBits) == kSectorEraseMicros +
+      (kSubsectorsPerSector - countBits(dirtyBits)) * kRewriteMicrosPer4KB) {
+    plan(command, NorEraseSize::kSector, sectorFirst);
+    return true;
+  }
+  const uint8_t subsector = lowestBit(dirtyBits);
+  const uint8_t half = subsector / 8;
+  const uint8_t halfBits = half == 0 ? lowHalf : highHalf;
+  const bool wholeHalf = from <= half * 8;
+  if (wholeHalf && halfMicros(halfBits, true) ==
+      kSubsector32KBEraseMicros + (8 - countBits(halfBits)) *
+      kRewriteMicrosPer4KB) {
+    plan(command, NorEraseSize::kSubsector32KB,
+        sectorFirst + half * 8ul * kSubsectorBytes);
+    return true;
+  }
+  plan(command, NorEraseSize::kSubsector4KB,
+      sectorFirst + (uint32_t)subsector * kSubsectorBytes);
+  return true;
+}
+
+uint32_t NorErasePlanner::eraseMicros(NorEraseSize size) {
+  switch (size) {
+    case NorEraseSize::kSubsector4KB: return kSubsector4KBEraseMicros;
+    case NorEraseSize::kSubsector32KB: return kSubsector32KBEraseMicros;
+    case NorEraseSize::kSector: return kSectorEraseMicros;
+    default: return kDieEraseMicros;
+  }
+}
+
+uint32_t NorErasePlanner::eraseBytes(NorEraseSize size) {
+  switch (size) {
+    case NorEraseSize::kSubsector4KB: return kSubsectorBytes;
+    case NorEraseSize::kSubsector32KB: return 8ul * kSubsectorBytes;
+    case NorEraseSize::kSector: return kSectorBytes;
+    default: return kDieBytes;
+  }
+}
+
+uint16_t NorErasePlanner::dirtySubsectors(uint16_t sector) const {
+  const uint32_t sectorFirst = (uint32_t)sector * kSectorBytes;
+  const uint32_t sectorEnd = sectorFirst + kSectorBytes;
+  uint16_t bits = 0;
+  for (uint8_t i = 0; i < rangeCount_; ++i) {
+    if (ranges_[i].end <= sectorFirst) {
+      continue;
+    }
+    if (ranges_[i].first >= sectorEnd) {
+      break;
+    }
+    const uint32_t first = ranges_[i].first > sectorFirst ?
+        ranges_[i].first : sectorFirst;
+    const uint32_t end = ranges_[i].end < sectorEnd ? ranges_[i].end :
+        sectorEnd;
+    for (uint32_t address = first; address < end; address += kSubsectorBytes) {
+      bits |= 1 << ((address - sectorFirst) / kSubsectorBytes);
+    }
+  }
+  return bits;
+}
+
+uint32_t NorErasePlanner::sectorMicros(uint16_t dirty) {
+  if (dirty == 0) {
+    return 0;
+  }
+  const uint32_t halves = halfMicros(dirty & 0xFF, true) +
+      halfMicros(dirty >> 8, true);
+  const uint32_t sector = kSectorEraseMicros +
+      (kSubsectorsPerSector - countBits(dirty)) * kRewriteMicrosPer4KB;
+  return sector <= halves ? sector : halves;
+}
+
+uint32_t NorErasePlanner::halfMicros(uint8_t dirty, bool wholeHalf) {
+  if (dirty == 0) {
+    return 0;
+  }
+  const uint8_t dirtyCount = countBits(dirty);
+  const uint32_t subsectors = dirtyCount * kSubsector4KBEraseMicros;
+  if (!wholeHalf) {
+    return subsectors;
+  }
+  const uint32_t half = kSubsector32KBEraseMicros +
+      (8 - dirtyCount) * kRewriteMicrosPer4KB;
+  return half <= subsectors ? half : subsectors;
+}
+
+/**
+ * Every sector of the die that a range reaches is weighed once: ranges are
+ * sorted, so a sector shared by two of them is the last one weighed.
+ */
+bool NorErasePlanner::isDieEraseCheaper(uint8_t die) const {
+  const uint32_t dieFirst = (uint32_t)die * kDieBytes;
+  const uint32_t dieEnd = dieFirst + kDieBytes;
+  uint32_t sectorsMicros = 0;
+  uint32_t dirtyCount = 0;
+  uint16_t lastSector = 0xFFFF;
+  for (uint8_t i = 0; i < rangeCount_; ++i) {
+    if (ranges_[i].end <= dieFirst || ranges_[i].first >= dieEnd) {
+      continue;
+    }
+    const uint32_t first = ranges_[i].first > dieFirst ? ranges_[i].first :
+        dieFirst;
+    const uint32_t end = ranges_[i].end < dieEnd ? ranges_[i].end : dieEnd;
+    for (uint16_t sector = first / kSectorBytes;
+         sector <= (end - 1) / kSectorBytes; ++sector) {
+      if (sector == lastSector) {
+        continue;
+      }
+      lastSector = sector;
+      const uint16_t dirty = dirtySubsectors(sector);
+      sectorsMicros += sectorMicros(dirty);
+      dirtyCount += countBits(dirty);
+    }
+  }
+  const uint32_t dieMicros = kDieEraseMicros +
+      (kDieBytes / kSubsectorBytes - dirtyCount) * kRewriteMicrosPer4KB;
+  return dieMicros <= sectorsMicros;
+}
+
+void NorErasePlanner::plan(NorEraseCommand& command, NorEraseSize size,
+    uint32_t address) {
+  command.size = size;
+  command.address = address;
+  cursor_ = address + eraseBytes(size);
+  plannedMicros_ += eraseMicros(size) +
+      eraseBytes(size) / kSubsectorBytes * kRewriteMicrosPer4KB;
+  plannedBytes_ += eraseBytes(size);
+}
@@ -0,0 +1,141 @@
+/**
+ * @file nor_erase_planner.h
+ * @brief Turns the ranges of the NOR Flash that have to be written again
+ *    into the erase instructions that take the least time.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * The MT25TL01G erases 4 KByte in 50 ms, 32 KByte in 100 ms, a 64 KByte
+ * sector in 150 ms and a whole die in 153 s, each aligned to its size, so
+ * the larger ones cost much less per byte. Their extra bytes are not free
+ * though: whatever was erased without being dirty has to be programmed
+ * again as well, about kRewriteMicrosPer4KB per 4 KByte.
+ *
+ * A NorErasePlanner gathers dirty ranges with addRange(), rounded out to
+ * whole 4 KByte subsectors, and next() hands out the erases one at a time,
+ * lowest address first. For each die it compares one die erase against the
+ * sum of its sectors; for each sector one sector erase against its two
+ * 32 KByte halves; for each half one 32 KByte erase against a 4 KByte erase
+ * per dirty subsector. Each option is charged its typical erase time plus
+ * the rewrite of the clean subsectors it takes along, and the cheapest one
+ * is taken, the larger one on ties. With the typical times a 32 KByte erase
+ * wins from 3 dirty subsectors of its 8, a sector erase from about 5 spread
+ * over both halves and a die erase only when less than about 35 subsectors
+ * of the die are clean, so few clean subsectors get an erase cycle they did not need.
+ *
+ * Up to kMaxRanges ranges are kept, merged when they overlap or touch.
+ * Once full, a new range is merged with its nearest neighbour, so the
+ * gap between them is planned as dirty: more time, but nothing missed.
+ *
+ * MemoryNORFlash::rewrite() runs a plan, programming a pattern back after
+ * every erase.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// What MemoryNORFlash::startErase() erases, aligned to its size.
+enum class NorEraseSize : uint8_t {
+  kSubsector4KB,
+  kSubsector32KB,
+  kSector,
+  kDie,
+};
+
+struct NorEraseCommand {
+  NorEraseSize size;
+  uint32_t address; // aligned to the bytes of size
+};
+
+class NorErasePlanner {
+public:
+  static const uint8_t kMaxRanges = 16;
+  static const uint32_t kCapacity = 134217728; // both dies
+  static const uint32_t kDieBytes = 67108864;
+  static const uint32_t kSectorBytes = 65536;
+  static const uint16_t kSubsectorBytes = 4096;
+
+  // Typical erase times and the time writeStream() takes to program
+  // 4 KByte back (bus and tPP, measured on the native target).
+  static const uint32_t kSubsector4KBEraseMicros = 50000;
+  static const uint32_t kSubsector32KBEraseMicros = 100000;
+  static const uint32_t kSectorEraseMicros = 150000;
+  static const uint32_t kDieEraseMicros = 153000000;
+  static const uint32_t kRewriteMicrosPer4KB = 7700;
+
+  NorErasePlanner() { clear(); }
+
+  // Nothing dirty, for a new plan.
+  void clear();
+
+  /**
+   * @brief Mark length bytes from address as dirty. Ranges past kCapacity
+   *    are cut at it.
+   *
+   * @pre next() has not been called since the last clear()
+   */
+  void addRange(uint32_t address, uint32_t length);
+
+  // Dirty ranges kept, after merging.
+  uint8_t ranges() const { return rangeCount_; }
+
+  /**
+   * @brief The next erase of the plan, in address order.
+   *
+   * @return false once the plan is over.
+   */
+  bool next(NorEraseCommand& command);
+
+  /**
+   * @brief Typical time of the erases handed out by next() so far, with
+   *    the programs to write back every byte they erased.
+   */
+  uint32_t plannedMicros() const { return plannedMicros_; }
+
+  // Bytes those erases cover, the dirty ones and those taken along.
+  uint32_t plannedBytes() const { return plannedBytes_; }
+
+  static uint32_t eraseMicros(NorEraseSize size);
+
+  static uint32_t eraseBytes(NorEraseSize size);
+
+private:
+  static const uint8_t kNoDie = 0xFF;
+
+  // [first, end), both multiples of kSubsectorBytes.
+  struct Range {
+    uint32_t first;
+    uint32_t end;
+  };
+
+  Range ranges_[kMaxRanges];
+  uint8_t rangeCount_;
+
+  // Everything below it is planned, and ranges_[range_] is the first range
+  // that ends above it.
+  uint32_t cursor_;
+  uint8_t range_;
+
+  // Die whose die erase was last weighed.
+  uint8_t weighedDie_;
+
+  uint32_t plannedMicros_;
+  uint32_t plannedBytes_;
+
+  // One bit per dirty subsector of the sector, bit 0 the lowest one.
+  uint16_t dirtySubsectors(uint16_t sector) const;
+
+  // Cheapest way to erase the dirty subsectors of the sector, as if the
+  // sector was not planned yet.
+  static uint32_t sectorMicros(uint16_t dirty);
+
+  // Cheapest way to erase the dirty subsectors of a 32 KByte half,
+  // wholeHalf telling if the 32 KByte erase is still possible.
+  static uint32_t halfMicros(uint8_t dirty, bool wholeHalf);
+
+  // Whether one die erase beats erasing the dirty sectors of the die.
+  bool isDieEraseCheaper(uint8_t die) const;
+
+  void plan(NorEraseCommand& command, NorEraseSize size, uint32_t address);
+};
@@ -0,0 +1,144 @@
+#include "./nor_refresh.h"
+
+#include <Arduino.h>
+
+#include "./chunk_stream.h"
+
+NorRefresh::NorRefresh(MemoryNORFlash& nor, uint16_t firstSector,
+    uint16_t sectors)
+    : nor_(nor), firstSector_(firstSector), sectors_(sectors),
+      expected_(nullptr), pattern_(nullptr), mismatches_(0),
+      failedSectors_(0) {
+  for (uint8_t die = 0; die < 2; ++die) {
+    dies_[die].sector = 0;
+    dies_[die].phase = Phase::kDone;
+    dies_[die].offset = 0;
+    dies_[die].failed = false;
+  }
+}
+
+void NorRefresh::begin(const PatternGenerator* expected,
+    const PatternGenerator& pattern) {
+  expected_ = expected;
+  pattern_ = &pattern;
+  sink_.clear();
+  mismatches_ = 0;
+  failedSectors_ = 0;
+  for (uint8_t die = 0; die < 2; ++die) {
+    dies_[die].sector = 0;
+    dies_[die].offset = 0;
+    dies_[die].failed = false;
+    if (sectors_ == 0) {
+      dies_[die].phase = Phase::kDone;
+    } else if (expected_ != nullptr) {
+      dies_[die].phase = Phase::kVerify;
+    } else {
+      startErase(die);
+    }
+  }
+}
+
+bool NorRefresh::run(uint32_t budgetMicros) {
+  const uint32_t startMicros = micros();
+  while (!isFinished()) {
+    step();
+    if (micros() - startMicros >= budgetMicros) {
+      break;
+    }
+  }
+  return isFinished();
+}
+
+bool NorRefresh::step() {
+  for (uint8_t die = 0; die < 2; ++die) {
+    Die& state = dies_[die];
+    if (state.phase != Phase::kErase) {
+      continue;
+    }
+    const MemoryOperationStatus status = nor_.poll(die);
+    if (status == MemoryOperationStatus::kPending) {
+      continue;
+    }
+    if (status == MemoryOperationStatus::kError || state.failed) {
+      state.failed = true;
+      nextSector(die);
+    } else {
+      state.phase = Phase::kProgram;
+      state.offset = 0;
+    }
+  }
+  uint8_t die = 2;
+  for (uint8_t candidate = 0; candidate < 2; ++candidate) {
+    const Phase phase = dies_[candidate].phase;
+    if ((phase == Phase::kVerify || phase == Phase::kProgram) &&
+        (die == 2 || bytesBeforeErase(candidate) < bytesBeforeErase(die))) {
+      die = candidate;
+    }
+  }
+  if (die == 2) {
+    return false;
+  }
+  Die& state = dies_[die];
+  const uint32_t address = sectorAddress(die) + state.offset;
+  if (state.phase == Phase::kVerify) {
+    mismatches_ += nor_.verifyRange(address, kUnitBytes, *expected_, sink_);
+  } else {
+    PatternSource source(*pattern_, address);
+    if (nor_.writeStream(address, kUnitBytes, source) ==
+        MemoryOperationStatus::kError) {
+      state.failed = true;
+    }
+  }
+  state.offset += kUnitBytes;
+  if (state.offset < MemoryNORFlash::kSectorBytes) {
+    return true;
+  }
+  if (state.phase == Phase::kVerify) {
+    startErase(die);
+  } else {
+    nextSector(die);
+  }
+  return true;
+}
+
+// After a program comes the verify of the next sector, if there is one.
+uint32_t NorRefresh::bytesBeforeErase(uint8_t die) const {
+  const Die& state = dies_[die];
+  uint32_t bytes = MemoryNORFlash::kSectorBytes - state.offset;
+  if (state.phase == Phase::kProgram && expected_ != nullptr) {
+    bytes += MemoryNORFlash::kSectorBytes;
+  }
+  return bytes;
+}
+
+uint32_t NorRefresh::sectorAddress(uint8_t die) const {
+  return die * MemoryNORFlash::kDieBytes +
+      (uint32_t)(firstSector_ + dies_[die].sector) *
+      MemoryNORFlash::kSectorBytes;
+}
+
+// A refused erase is left for step() to find, as a failed one.
+void NorRefresh::startErase(uint8_t die) {
+  Die& state = dies_[die];
+  state.phase = Phase::kErase;
+  if (nor_.startErase(NorEraseSize::kSector, sectorAddress(die)) ==
+      MemoryOperationStatus::kError) {
+    state.failed = true;
+  }
+}
+
+void NorRefresh::nextSector(uint8_t die) {
+  Die& state = dies_[die];
+  if (state.failed) {
+    ++failedSectors_;
+    state.failed = false;
+  }
+  state.offset = 0;
+  if (++state.sector == sectors_) {
+    state.phase = Phase::kDone;
+  } else if (expected_ != nullptr) {
+    state.phase = Phase::kVerify;
+  } else {
+    startErase(die);
+  }
+}
@@ -0,0 +1,123 @@
+/**
+ * @file nor_refresh.h
+ * @brief Read-verify-rewrite of the NOR Flash with both dies at work, one
+ *    of them erasing while the other one is read or programmed.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * Every sector goes through three phases: its bytes are verified against
+ * the pattern they should hold, it is erased and the next pattern is
+ * programmed into it. Verify (about 90 ms per sector) and program (about
+ * 125 ms) keep the bus busy, but the 150 ms of the erase are spent waiting
+ * for the die. Done one die after the other, as a single device, those
+ * waits add up to 40 % of the time.
+ *
+ * A NorRefresh walks the same sectors of both dies at once. A held die
+ * goes on with its erase (see MemoryNORFlash), so while one die erases
+ * the bus serves the other one, which hides the erases behind the bus work
+ * of the other die. When both dies have bus work, it goes to the one with
+ * fewer bytes left before its next erase, so that erases start as early
+ * as possible; the busy state of each die comes from its flag status
+ * register, through MemoryNORFlash::poll(die). On the native target a
+ * cycle over 16 sectors of each die takes 1.7 times less than one die
+ * after the other: what is left is the bus work of both dies, which no
+ * scheduling can overlap.
+ *
+ * Bus work is done in units of kUnitBytes, one verifyRange() or
+ * writeStream() each, and run() works until a time budget is spent, like
+ * ScrubEngine::run(). Without a pattern to verify against, as after a
+ * power up, a cycle only erases and programs, which fills the array.
+ *
+ * Erase cycles are not counted here: a cycle erases each sector of its
+ * range once, a die erase for NorEraseCounts when it covers the whole die.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "./memory_nor_flash.h"
+#include "./mismatch_sink.h"
+#include "./pattern_generator.h"
+
+class NorRefresh {
+public:
+  static const uint16_t kUnitBytes = 4096;
+
+  /**
+   * @param firstSector first sector of the range in each die, 0 to 1023.
+   * @param sectors sectors of the range in each die.
+   * @pre firstSector + sectors <= 1024
+   */
+  NorRefresh(MemoryNORFlash& nor, uint16_t firstSector, uint16_t sectors);
+
+  /**
+   * @brief Start a cycle over the range of both dies.
+   *
+   * @param expected pattern the range should hold, nullptr not to verify.
+   * @param pattern pattern the range is programmed with.
+   * @pre Memory is not busy
+   */
+  void begin(const PatternGenerator* expected,
+      const PatternGenerator& pattern);
+
+  /**
+   * @brief Work on the cycle until budgetMicros have gone by or it is over.
+   *
+   * @return true once every sector of both dies is programmed.
+   */
+  bool run(uint32_t budgetMicros);
+
+  bool isFinished() const {
+    return dies_[0].phase == Phase::kDone && dies_[1].phase == Phase::kDone;
+  }
+
+  // Bytes that did not match expected since begin().
+  uint32_t mismatches() const { return mismatches_; }
+
+  // The first of them.
+  MismatchSink& sink() { return sink_; }
+
+  // Sectors whose erase or some program failed since begin().
+  uint16_t failedSectors() const { return failedSectors_; }
+
+private:
+  enum class Phase : uint8_t {
+    kVerify,
+    kErase,
+    kProgram,
+    kDone,
+  };
+
+  struct Die {
+    uint16_t sector; // inside the range
+    Phase phase;
+    uint32_t offset; // inside the sector, for verify and program
+    bool failed;
+  };
+
+  MemoryNORFlash& nor_;
+  uint16_t firstSector_;
+  uint16_t sectors_;
+  const PatternGenerator* expected_;
+  const PatternGenerator* pattern_;
+  Die dies_[2];
+  MismatchSink sink_;
+  uint32_t mismatches_;
+  uint16_t failedSectors_;
+
+  // Check the erases, then do a unit of bus work. false if there was none
+  // to do, both dies erasing or done.
+  bool step();
+
+  // Verify and program bytes of the die before it starts another erase.
+  uint32_t bytesBeforeErase(uint8_t die) const;
+
+  // Linear address of the current sector of the die.
+  uint32_t sectorAddress(uint8_t die) const;
+
+  void startErase(uint8_t die);
+
+  // Verify, or erase when there is nothing to verify, the next sector.
+  void nextSector(uint8_t die);
+};
@@ -0,0 +1,38 @@
+/**
+ * @file pattern_generator.h
+ * @brief Source of the byte expected at every address of a memory under test.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * A verify pass compares what a memory outputs against what was written to
+ * it. Instead of keeping a copy of what was written, which does not fit in
+ * the 2 KB of SRAM of the Nano, the expected byte is computed from the
+ * address whenever it is needed.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class PatternGenerator {
+public:
+  virtual ~PatternGenerator() {}
+
+  /**
+   * @brief Byte that should be stored at the given address.
+   *
+   * Must only depend on the address (and on the generator's own settings),
+   * so that any address can be checked in any order.
+   */
+  virtual uint8_t expectedByte(uint32_t address) const = 0;
+
+  /**
+   * @brief Write into buffer the size bytes expected from address onwards,
+   *    so a write path can regenerate its data a chunk at a time.
+   */
+  void fill(uint32_t address, uint8_t* buffer, uint16_t size) const {
+    for (uint16_t i = 0; i < size; ++i) {
+      buffer[i] = expectedByte(address + i);
+    }
+  }
+};
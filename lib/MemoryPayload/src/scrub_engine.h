@@ -0,0 +1,143 @@
+/**
+ * @file scrub_engine.h
+ * @brief Continuous verify of a whole memory, a bounded amount per loop().
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * A ScrubEngine walks the address space of a driver from 0 to capacity - 1
+ * and back to 0, verifying it against a pattern with the driver's
+ * verifyRange(). Every run() verifies steps of stepBytes until its time
+ * budget is spent, so one call never takes longer than the budget plus one
+ * step, and the cursor is kept between calls to resume where it stopped.
+ *
+ * Capacities of the memories on the board:
+ *  FRAM  1048576 (1 MByte)
+ *  MRAM   524288 (512 KByte)
+ *  EEPROM 262144 (256 KByte)
+ *  NAND Flash 65536 * 2112 (all pages, spare area included, see
+ *    MemoryNANDFlash::verifyRange())
+ *  NAND Flash data area 65536 * 2048 (no spare area, continuous reads,
+ *    see NandFlashDataArea)
+ *  NAND Flash ECC scrub 65536 * 2112 (page loads, compared only when ECC
+ *    could not correct them, see NandFlashEccScrub)
+ *
+ * Memory is any driver with
+ *  uint32_t verifyRange(uint32_t, uint32_t, const PatternGenerator&, MismatchSink&)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#include "./mismatch_sink.h"
+#include "./pattern_generator.h"
+
+template <typename Memory>
+class ScrubEngine {
+public:
+  ScrubEngine(Memory& memory, uint32_t capacity, uint32_t stepBytes,
+      const PatternGenerator& pattern)
+      : memory_(memory), pattern_(&pattern), capacity_(capacity),
+        stepBytes_(stepBytes), cursor_(0), passes_(0), passStartMillis_(0),
+        lastPassMillis_(0), passMismatches_(0), lastPassMismatches_(0),
+        started_(false) {}
+
+  /**
+   * @brief Pattern the memory is verified against from now on. Takes effect
+   *    from the current cursor, so change it when run() returns true to
+   *    keep whole passes on a single pattern.
+   */
+  void setPattern(const PatternGenerator& pattern) { pattern_ = &pattern; }
+
+  /**
+   * @brief Verify steps from the cursor until budgetMicros have gone by.
+   *    At least one step is always verified.
+   *
+   * @return true if a pass over the whole memory finished during this call.
+   */
+  bool run(uint32_t budgetMicros) {
+    const uint32_t startMicros = micros();
+    if (!started_) {
+      passStartMillis_ = millis();
+      started_ = true;
+    }
+    bool passFinished = false;
+    do {
+      uint32_t length = capacity_ - cursor_;
+      if (length > stepBytes_) {
+        length = stepBytes_;
+      }
+      passMismatches_ += memory_.verifyRange(cursor_, length, *pattern_, sink_);
+      cursor_ += length;
+      if (cursor_ == capacity_) {
+        const uint32_t nowMillis = millis();
+        lastPassMillis_ = nowMillis - passStartMillis_;
+        passStartMillis_ = nowMillis;
+        lastPassMismatches_ = passMismatches_;
+        passMismatches_ = 0;
+        cursor_ = 0;
+        ++passes_;
+        passFinished = true;
+      }
+    } while (micros() - startMicros < budgetMicros);
+    return passFinished;
+  }
+
+  uint32_t cursor() const { return cursor_; }
+  uint32_t capacity() const { return capacity_; }
+  uint32_t passes() const { return passes_; }
+
+  // Bytes verified since construction, over all passes.
+  uint64_t bytesVerified() const {
+    return (uint64_t)passes_ * capacity_ + cursor_;
+  }
+
+  // Duration and mismatches of the last complete pass.
+  uint32_t lastPassMillis() const { return lastPassMillis_; }
+  uint32_t lastPassMismatches() const { return lastPassMismatches_; }
+
+  // Scrub rate of the last complete pass, 0 before the first one.
+  uint32_t bytesPerSecond() const {
+    if (lastPassMillis_ == 0) {
+      return 0;
+    }
+    return (uint32_t)((uint64_t)capacity_ * 1000 / lastPassMillis_);
+  }
+
+  // Every mismatch found since the sink was last cleared.
+  MismatchSink& sink() { return sink_; }
+
+private:
+  Memory& memory_;
+  const PatternGenerator* pattern_;
+  MismatchSink sink_;
+  uint32_t capacity_;
+  uint32_t stepBytes_;
+  uint32_t cursor_;
+  uint32_t passes_;
+  uint32_t passStartMillis_;
+  uint32_t lastPassMillis_;
+  uint32_t passMismatches_;
+  uint32_t lastPassMismatches_;
+  bool started_;
+};
+
+/**
+ * @brief Print the metrics of the last complete pass of engine on Serial:
+ *    "<name> pass <n>: <ms> ms, <bytes/s> B/s, <mismatches> mismatches"
+ */
+template <typename Memory>
+void printPassReport(const __FlashStringHelper* name,
+    const ScrubEngine<Memory>& engine) {
+  Serial.print(name);
+  Serial.print(F(" pass "));
+  Serial.print(engine.passes());
+  Serial.print(F(": "));
+  Serial.print(engine.lastPassMillis());
+  Serial.print(F(" ms, "));
+  Serial.print(engine.bytesPerSecond());
+  Serial.print(F(" B/s, "));
+  Serial.print(engine.lastPassMismatches());
+  Serial.println(F(" mismatches"));
+}
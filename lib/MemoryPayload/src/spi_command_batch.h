@@ -0,0 +1,134 @@
+/**
+ * @file spi_command_batch.h
+ * @brief Several instructions for one memory sent under a single SPI
+ *    transaction.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * Every instruction of the drivers opens and closes its own transaction,
+ * which costs more than the instruction itself when it is short: a WREN
+ * before each FRAM write, or the 1 byte writes of a fault injection test.
+ * A SpiCommandBatch queues up to kMaxSegments instructions (segments) for
+ * the same memory and execute() sends them inside one beginTransaction() /
+ * endTransaction(), only raising and lowering the chip select between them
+ * so that the memory still sees each one as a separate instruction.
+ *
+ * A segment is an opcode followed by up to 4 address or dummy bytes (the
+ * header) and optionally a data phase that sends bytes from a buffer or
+ * receives them into it.
+ *
+ * The batch only holds pointers to the data, so the buffers have to live
+ * until execute() returns. The drivers add segments with their add...()
+ * methods, which check the addresses the same way their other methods do.
+ *
+ * NOTE: a batch is sent without looking at the status register, so it
+ * cannot wait for a write cycle, program or erase in between segments.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <stdint.h>
+
+#include "./chip_select.h"
+
+class SpiCommandBatch {
+public:
+  static const uint8_t kMaxSegments = 8;
+  static const uint8_t kMaxHeaderBytes = 5;
+
+  enum class DataPhase : uint8_t {
+    kNone,
+    kSend,    // data is sent byte by byte and left untouched
+    kReceive, // what the memory answers replaces data
+  };
+
+  struct Segment {
+    uint8_t header[kMaxHeaderBytes];
+    uint8_t headerLength;
+    DataPhase phase;
+    uint8_t* data;
+    uint16_t length;
+  };
+
+  SpiCommandBatch() : size_(0) {}
+
+  /**
+   * @brief Queue an instruction whose header is the opcode followed by the
+   *    addressBytes least significant bytes of address, most significant
+   *    first, which is how most instructions of the memories look.
+   *
+   * @param addressBytes 0 to 4.
+   * @return false, with nothing queued, when the batch is full.
+   */
+  bool add(uint8_t opcode, uint32_t address = 0, uint8_t addressBytes = 0,
+      DataPhase phase = DataPhase::kNone, uint8_t* data = nullptr,
+      uint16_t length = 0) {
+    uint8_t header[kMaxHeaderBytes];
+    if (addressBytes >= kMaxHeaderBytes) {
+      Serial.println("Error: Invalid addressBytes passed to SpiCommandBatch's add(...).");
+      return false;
+    }
+    header[0] = opcode;
+    for (uint8_t i = 0; i < addressBytes; ++i) {
+      header[1 + i] = (uint8_t)(address >> (8 * (addressBytes - 1 - i)));
+    }
+    return add(header, 1 + addressBytes, phase, data, length);
+  }
+
+  // Queue an instruction with any header, such as one with dummy bytes.
+  bool add(const uint8_t* header, uint8_t headerLength, DataPhase phase,
+      uint8_t* data, uint16_t length) {
+    if (headerLength > kMaxHeaderBytes) {
+      Serial.println("Error: Invalid headerLength passed to SpiCommandBatch's add(...).");
+      return false;
+    }
+    if (size_ == kMaxSegments) {
+      Serial.println("Error: No room for another segment in SpiCommandBatch's add(...).");
+      return false;
+    }
+    Segment& segment = segments_[size_++];
+    for (uint8_t i = 0; i < headerLength; ++i) {
+      segment.header[i] = header[i];
+    }
+    segment.headerLength = headerLength;
+    segment.phase = phase;
+    segment.data = data;
+    segment.length = length;
+    return true;
+  }
+
+  uint8_t size() const { return size_; }
+  bool isFull() const { return size_ == kMaxSegments; }
+  void clear() { size_ = 0; }
+
+  /**
+   * @brief Send every segment in the order they were added, selecting the
+   *    memory for each one, all in a single transaction.
+   */
+  template <uint8_t ChipSelectPin>
+  void execute(SPIClass& bus, const SPISettings& settings) const {
+    bus.beginTransaction(settings);
+    for (uint8_t i = 0; i < size_; ++i) {
+      const Segment& segment = segments_[i];
+      ChipSelect<ChipSelectPin>::select();
+      for (uint8_t j = 0; j < segment.headerLength; ++j) {
+        bus.transfer(segment.header[j]);
+      }
+      if (segment.phase == DataPhase::kSend) {
+        for (uint16_t j = 0; j < segment.length; ++j) {
+          bus.transfer(segment.data[j]);
+        }
+      } else if (segment.phase == DataPhase::kReceive) {
+        bus.transfer(segment.data, segment.length);
+      }
+      ChipSelect<ChipSelectPin>::deselect();
+    }
+    bus.endTransaction();
+  }
+
+private:
+  Segment segments_[kMaxSegments];
+  uint8_t size_;
+};
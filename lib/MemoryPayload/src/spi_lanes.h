@@ -0,0 +1,273 @@
+/**
+ * @file spi_lanes.h
+ * @brief Buses that move the data of an instruction over 1, 2 or 4 lines,
+ *    for the dual and quad reads of the NAND Flash and the NOR Flash.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * The W25N01GV can output the buffer on 2 lines (DO and DI, dual) or 4
+ * (plus /WP and /HOLD as IO2 and IO3, quad), and take the column on them
+ * too (the I/O variants). The SPI peripheral of the ATmega328 only has one
+ * line each way, so a LaneBus stands for whatever shifts the bytes:
+ *
+ *  - SpiLaneBus: the SPI peripheral, 1 lane, what the drivers use today.
+ *  - PortLaneBus<SckPin>: IO0 to IO3 wired to bits 0 to 3 of PORTC (A0 to
+ *    A3 of the Nano) and SCK to any pin, bit banged. A clock costs about 8
+ *    CPU cycles whatever the width, so 4 lanes move a byte in 2 of them.
+ *  - QspiLaneBus: only in the native simulator, the QSPI peripheral of a
+ *    faster MCU a later board revision could carry, to see what the reads
+ *    would gain.
+ *
+ * The chip select stays with the driver (see chip_select.h), which sends
+ * the opcode on 1 lane and the column, dummy clocks and data on as many as
+ * the instruction uses. Dummy clocks are sent as bytes of 0x00 on those
+ * lanes, 8 / lanes clocks each.
+ *
+ * The DTR instructions of the NOR Flash move bits on both edges of the
+ * clock from the address on, which only a bus with
+ * hasDoubleTransferRate() can do: the QSPI peripherals have it, the SPI of
+ * the Nano and bit banging do not (the latter would gain nothing, its
+ * edges are as slow as its clocks).
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <stdint.h>
+
+#include "./chip_select.h"
+#include "./chunk_stream.h"
+#include "./mismatch_sink.h"
+#include "./pattern_generator.h"
+
+class LaneBus {
+public:
+  virtual ~LaneBus() {}
+
+  // Widest transfer the bus can do, 1, 2 or 4.
+  virtual uint8_t maxLanes() const = 0;
+
+  virtual void beginTransaction() = 0;
+  virtual void endTransaction() = 0;
+
+  // Shift out size bytes on lanes lines, most significant bits first.
+  virtual void send(const uint8_t* bytes, uint8_t size, uint8_t lanes) = 0;
+
+  // Shift in size bytes from lanes lines.
+  virtual void receive(uint8_t* bytes, uint8_t size, uint8_t lanes) = 0;
+
+  // Whether setDoubleTransferRate(true) is possible.
+  virtual bool hasDoubleTransferRate() const { return false; }
+
+  // Move the bits of send() and receive() on both clock edges from now on,
+  // until set back to false. Ignored without hasDoubleTransferRate().
+  virtual void setDoubleTransferRate(bool /*enabled*/) {}
+};
+
+/**
+ * @brief receiveChunks() (see chunk_stream.h) over a LaneBus.
+ */
+inline void receiveChunks(LaneBus& bus, uint8_t lanes, ChunkSink& sink,
+    uint32_t offset, uint32_t length) {
+  uint8_t chunk[kStreamChunkBytes];
+  while (length > 0) {
+    const uint8_t size = length < kStreamChunkBytes ? length : kStreamChunkBytes;
+    bus.receive(chunk, size, lanes);
+    sink.write(offset, chunk, size);
+    offset += size;
+    length -= size;
+  }
+}
+
+/**
+ * @brief streamVerify() (see spi_stream.h) over a LaneBus: receive length
+ *    bytes and compare each one against the byte the pattern expects from
+ *    address onwards, giving the ones that differ to sink.
+ *
+ * @return amount of bytes that did not match.
+ */
+inline uint32_t verifyChunks(LaneBus& bus, uint8_t lanes, uint32_t address,
+    uint32_t length, const PatternGenerator& pattern, MismatchSink& sink) {
+  uint8_t chunk[kStreamChunkBytes];
+  uint32_t mismatches = 0;
+  while (length > 0) {
+    const uint8_t size = length < kStreamChunkBytes ? length : kStreamChunkBytes;
+    bus.receive(chunk, size, lanes);
+    for (uint8_t i = 0; i < size; ++i) {
+      const uint8_t difference = chunk[i] ^ pattern.expectedByte(address + i);
+      if (difference != 0) {
+        sink.record(address + i, difference);
+        ++mismatches;
+      }
+    }
+    address += size;
+    length -= size;
+  }
+  return mismatches;
+}
+
+class SpiLaneBus : public LaneBus {
+public:
+  SpiLaneBus(SPIClass& bus, const SPISettings& settings)
+      : bus_(bus), settings_(settings) {}
+
+  uint8_t maxLanes() const override { return 1; }
+
+  void beginTransaction() override { bus_.beginTransaction(settings_); }
+  void endTransaction() override { bus_.endTransaction(); }
+
+  void send(const uint8_t* bytes, uint8_t size, uint8_t /*lanes*/) override {
+    for (uint8_t i = 0; i < size; ++i) {
+      bus_.transfer(bytes[i]);
+    }
+  }
+
+  // The buffer version of transfer sends what is in bytes, 0x00 here.
+  void receive(uint8_t* bytes, uint8_t size, uint8_t /*lanes*/) override {
+    memset(bytes, 0x00, size);
+    bus_.transfer(bytes, size);
+  }
+
+private:
+  SPIClass& bus_;
+  const SPISettings settings_;
+};
+
+/**
+ * @brief IO0 to IO3 on PORTC bits 0 to 3, SCK on SckPin, SPI mode 0: the
+ *    lines change while SCK is low and are sampled on its rising edge. With
+ *    1 lane IO0 is the memory's DI and IO1 its DO.
+ *
+ * NOTE: needs its own wiring of the memory's lines, it is not the SPI of
+ * the breakout board, and WP-E = 0 at SR-1 so that /WP and /HOLD are IO2
+ * and IO3.
+ */
+template <uint8_t SckPin>
+class PortLaneBus : public LaneBus {
+public:
+  static const uint8_t kFirstIoPin = 14; // A0
+
+  // SCK low, IO lines as inputs until something is sent.
+  void begin() {
+    pinMode(SckPin, OUTPUT);
+    ChipSelect<SckPin>::select();
+    for (uint8_t i = 0; i < 4; ++i) {
+      pinMode(kFirstIoPin + i, INPUT);
+    }
+  }
+
+  uint8_t maxLanes() const override { return 4; }
+
+  void beginTransaction() override {}
+  void endTransaction() override {}
+
+  void send(const uint8_t* bytes, uint8_t size, uint8_t lanes) override {
+    for (uint8_t i = 0; i < size; ++i) {
+      shift(bytes[i], lanes, true);
+    }
+  }
+
+  void receive(uint8_t* bytes, uint8_t size, uint8_t lanes) override {
+    for (uint8_t i = 0; i < size; ++i) {
+      bytes[i] = shift(0x00, lanes, false);
+    }
+  }
+
+private:
+  // ChipSelect<SckPin> writes SCK through its port register, deselect()
+  // is HIGH.
+  static uint8_t shift(uint8_t data, uint8_t lanes, bool output) {
+#ifdef __AVR__
+    const uint8_t laneMask = (1 << lanes) - 1;
+    if (lanes == 1) {
+      DDRC = (DDRC & 0xF0) | 0x01;
+    } else if (output) {
+      DDRC |= laneMask;
+    } else {
+      DDRC &= (uint8_t)~laneMask;
+    }
+    uint8_t received = 0;
+    for (uint8_t bit = 8; bit > 0; bit -= lanes) {
+      if (output || lanes == 1) {
+        PORTC = (PORTC & 0xF0) | ((data >> (bit - lanes)) & laneMask);
+      }
+      ChipSelect<SckPin>::deselect();
+      const uint8_t lines = PINC;
+      ChipSelect<SckPin>::select();
+      received = (received << lanes) |
+          (lanes == 1 ? (lines >> 1) & 0x01 : lines & laneMask);
+    }
+    return received;
+#elif defined(SPACERAD_NATIVE_SIMULATOR)
+    (void)output; // the simulated chips answer whatever the direction
+    return simBitBangTransfer(data, lanes);
+#else
+    const uint8_t laneMask = (1 << lanes) - 1;
+    for (uint8_t i = 0; i < 4; ++i) {
+      const bool driven = i == 0 ? (output || lanes == 1) : (output && i < lanes);
+      pinMode(kFirstIoPin + i, driven ? OUTPUT : INPUT);
+    }
+    uint8_t received = 0;
+    for (uint8_t bit = 8; bit > 0; bit -= lanes) {
+      const uint8_t field = (data >> (bit - lanes)) & laneMask;
+      for (uint8_t i = 0; i < lanes && (output || lanes == 1); ++i) {
+        digitalWrite(kFirstIoPin + i, (field >> i) & 0x01);
+      }
+      digitalWrite(SckPin, HIGH);
+      uint8_t lines = 0;
+      for (uint8_t i = 0; i < 4; ++i) {
+        lines |= digitalRead(kFirstIoPin + i) << i;
+      }
+      digitalWrite(SckPin, LOW);
+      received = (received << lanes) |
+          (lanes == 1 ? (lines >> 1) & 0x01 : lines & laneMask);
+    }
+    return received;
+#endif
+  }
+};
+
+#ifdef SPACERAD_NATIVE_SIMULATOR
+/**
+ * @brief The QSPI peripheral of an MCU the breakout board does not have,
+ *    shifting at clockHz with 1, 2 or 4 lanes, on one or both clock edges.
+ *    Both edges move as many bits per clock as twice the lanes on one.
+ */
+class QspiLaneBus : public LaneBus {
+public:
+  explicit QspiLaneBus(uint32_t clockHz)
+      : clockHz_(clockHz), doubleTransferRate_(false) {}
+
+  uint8_t maxLanes() const override { return 4; }
+
+  void beginTransaction() override {}
+  void endTransaction() override {}
+
+  void send(const uint8_t* bytes, uint8_t size, uint8_t lanes) override {
+    for (uint8_t i = 0; i < size; ++i) {
+      simQspiTransfer(bytes[i], bitsPerClock(lanes), clockHz_);
+    }
+  }
+
+  void receive(uint8_t* bytes, uint8_t size, uint8_t lanes) override {
+    for (uint8_t i = 0; i < size; ++i) {
+      bytes[i] = simQspiTransfer(0x00, bitsPerClock(lanes), clockHz_);
+    }
+  }
+
+  bool hasDoubleTransferRate() const override { return true; }
+
+  void setDoubleTransferRate(bool enabled) override {
+    doubleTransferRate_ = enabled;
+  }
+
+private:
+  uint32_t clockHz_;
+  bool doubleTransferRate_;
+
+  uint8_t bitsPerClock(uint8_t lanes) const {
+    return doubleTransferRate_ ? 2 * lanes : lanes;
+  }
+};
+#endif
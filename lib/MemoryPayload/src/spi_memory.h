@@ -0,0 +1,287 @@
+/**
+ * @file spi_memory.h
+ * @brief Common part of the drivers of the SPI memories addressed with an
+ *    opcode followed by the address (FRAM, MRAM and EEPROM).
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * Those memories share the WREN, WRDI, RDSR, READ and WRITE instructions and
+ * the WEL flag at bit 1 of the status register, and only differ in opcode
+ * values, capacity, chip select pin, clock and SPI bus. SpiMemory<Traits>
+ * takes all of those from a traits struct as compile time constants, so
+ * the address checks compare against constants and the address bytes are
+ * sent by an unrolled loop, with no per driver copy of the code.
+ *
+ * Traits has to provide:
+ *  static const char* name()        used in the error messages
+ *  static SPIClass& bus()           SPI or hspi
+ *  kChipSelectPin, kClockHz
+ *  kCapacity                        bytes, a power of 2
+ *  kAddressBytes                    bytes sent after the opcode
+ *  kWriteEnableOpcode, kWriteDisableOpcode, kReadStatusOpcode,
+ *  kReadOpcode, kWriteOpcode
+ *
+ * A driver derives from SpiMemory<ItsTraits> and adds what is particular to
+ * its memory (write cycles, pages, special sectors...).
+ *
+ * The SPISettings of the memory are built once in the constructor and the
+ * chip select is written straight to its port (see chip_select.h), which
+ * is most of the time of short instructions such as RDSR or a 1 byte read.
+ * Several instructions can also share one transaction through a
+ * SpiCommandBatch (see spi_command_batch.h) and execute().
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <stdint.h>
+
+#include "./chip_select.h"
+#include "./chunk_stream.h"
+#include "./memory_operation_status.h"
+#include "./mismatch_sink.h"
+#include "./pattern_generator.h"
+#include "./spi_command_batch.h"
+#include "./spi_stream.h"
+
+template <typename Traits>
+class SpiMemory {
+public:
+  static const uint32_t kCapacity = Traits::kCapacity;
+
+  SpiMemory() : settings_(Traits::kClockHz, MSBFIRST, SPI_MODE0) {}
+
+  /**
+   * @brief Perform a RDSR read status register instruction. Check if the WEL
+   * flag in the status register is at 1 (allow write instructions) or at 0
+   * (dissallow write instructions)
+   *
+   * @return true if WEL = 1
+   * @return false if WEL = 0
+   */
+  bool isWriteEnabled() { return (readStatusRegister() & 0x02) == 0x02; }
+
+  /**
+   * @brief Status register has a WEL flag that at 1 allows memory to be written,
+   * but at 0 it does not allow it. This changes the flag to 1.
+   */
+  void enableWrite() { sendCommand(Traits::kWriteEnableOpcode); }
+
+  /**
+   * @brief Status register has a WEL flag that at 1 allows memory to be written,
+   * but at 0 it does not allow it. This changes the flag to 0.
+   */
+  void disableWrite() { sendCommand(Traits::kWriteDisableOpcode); }
+
+  /**
+   * @brief RDSR instruction, dummy data 0x00 is sent while the status
+   *    register is read.
+   */
+  uint8_t readStatusRegister() {
+    beginCommand(Traits::kReadStatusOpcode);
+    const uint8_t statusRegister = Traits::bus().transfer(0x00);
+    endCommand();
+    return statusRegister;
+  }
+
+  /**
+   * @brief Read length consecutive bytes from initialAddress with a single
+   *    READ instruction and compare each one against the byte the pattern
+   *    expects at its address, without storing what was read.
+   *
+   * The comparison of a byte overlaps with the transfer of the next one
+   * (see spi_stream.h). Past the last address the read wraps to 0.
+   *
+   * @param initialAddress lower than kCapacity.
+   * @param length amount of bytes to verify, kCapacity for the whole memory.
+   * @param pattern gives the expected byte of every address.
+   * @param sink records the address and XOR mask of every mismatch.
+   * @return amount of bytes that did not match.
+   * @pre Memory is not busy
+   */
+  uint32_t verifyRange(uint32_t initialAddress, uint32_t length,
+      const PatternGenerator& pattern, MismatchSink& sink) {
+    if (!isValidAddress(initialAddress)) {
+      printInvalidAddress("verifyRange");
+      return 0;
+    }
+    beginCommand(Traits::kReadOpcode);
+    sendAddress(initialAddress);
+    SpiStream stream(Traits::bus());
+    const uint32_t mismatches = streamVerify(stream, initialAddress, length,
+        Traits::kCapacity - 1, pattern, sink);
+    endCommand();
+    return mismatches;
+  }
+
+  /**
+   * @brief Read length bytes from initialAddress with a single READ
+   *    instruction, handing them to sink kStreamChunkBytes at a time (see
+   *    chunk_stream.h). Past the last address the read wraps to 0.
+   *
+   * @param length any amount of bytes, kCapacity for the whole memory.
+   * @return kDone, or kError if initialAddress is invalid.
+   * @pre Memory is not busy
+   */
+  MemoryOperationStatus readStream(uint32_t initialAddress, uint32_t length,
+      ChunkSink& sink) {
+    if (!isValidAddress(initialAddress)) {
+      printInvalidAddress("readStream");
+      return MemoryOperationStatus::kError;
+    }
+    beginCommand(Traits::kReadOpcode);
+    sendAddress(initialAddress);
+    receiveChunks(Traits::bus(), sink, 0, length);
+    endCommand();
+    return MemoryOperationStatus::kDone;
+  }
+
+  // Queue a WREN instruction.
+  bool addEnableWrite(SpiCommandBatch& batch) {
+    return batch.add(Traits::kWriteEnableOpcode);
+  }
+
+  /**
+   * @brief Queue a READ of size bytes from initialAddress into buffer.
+   *
+   * @return false, with nothing queued, if initialAddress is invalid or the
+   *    batch is full.
+   */
+  bool addRead(SpiCommandBatch& batch, uint32_t initialAddress,
+      uint8_t* buffer, uint16_t size) {
+    if (!isValidAddress(initialAddress)) {
+      printInvalidAddress("addRead");
+      return false;
+    }
+    return batch.add(Traits::kReadOpcode, initialAddress, Traits::kAddressBytes,
+        SpiCommandBatch::DataPhase::kReceive, buffer, size);
+  }
+
+  // Send every instruction of the batch under a single transaction.
+  void execute(const SpiCommandBatch& batch) {
+    batch.template execute<Traits::kChipSelectPin>(Traits::bus(), settings_);
+  }
+
+protected:
+  static bool isValidAddress(uint32_t address) {
+    return address < Traits::kCapacity;
+  }
+
+  // "Error: Invalid address passed to <name>'s <method>(...)."
+  static void printInvalidAddress(const char* method) {
+    Serial.print("Error: Invalid address passed to ");
+    Serial.print(Traits::name());
+    Serial.print("'s ");
+    Serial.print(method);
+    Serial.println("(...).");
+  }
+
+  // Start a transaction, select the memory and send the opcode.
+  void beginCommand(uint8_t opcode) {
+    Traits::bus().beginTransaction(settings_);
+    ChipSelect<Traits::kChipSelectPin>::select();
+    Traits::bus().transfer(opcode);
+  }
+
+  // End the instruction being sent and start another one in the same
+  // transaction.
+  void nextCommand(uint8_t opcode) {
+    ChipSelect<Traits::kChipSelectPin>::deselect();
+    ChipSelect<Traits::kChipSelectPin>::select();
+    Traits::bus().transfer(opcode);
+  }
+
+  // The address, most significant byte first.
+  void sendAddress(uint32_t address) {
+    for (int8_t shift = 8 * (Traits::kAddressBytes - 1); shift >= 0; shift -= 8) {
+      Traits::bus().transfer((uint8_t)(address >> shift));
+    }
+  }
+
+  // Deselect the memory and end the transaction.
+  void endCommand() {
+    ChipSelect<Traits::kChipSelectPin>::deselect();
+    Traits::bus().endTransaction();
+  }
+
+  // Single byte instruction such as WREN or WRDI.
+  void sendCommand(uint8_t opcode) {
+    beginCommand(opcode);
+    endCommand();
+  }
+
+  // A whole READ or WRITE instruction in its own transaction.
+  void transferNBytes(uint8_t opcode, uint32_t address, uint8_t* buffer,
+      int amountOfBytes) {
+    beginCommand(opcode);
+    sendAddress(address);
+    transferData(opcode, buffer, amountOfBytes);
+    endCommand();
+  }
+
+  /**
+   * A WRITE preceded by a WREN in the same transaction, for the memories
+   * whose WEL flag is cleared by every write.
+   */
+  void writeEnabledNBytes(uint32_t address, uint8_t* buffer, int amountOfBytes) {
+    beginCommand(Traits::kWriteEnableOpcode);
+    nextCommand(Traits::kWriteOpcode);
+    sendAddress(address);
+    transferData(Traits::kWriteOpcode, buffer, amountOfBytes);
+    endCommand();
+  }
+
+  /**
+   * A single WRITE instruction of length bytes asked to source a chunk at a
+   * time, preceded by a WREN in the same transaction if writeEnableFirst.
+   * For the memories without write cycles, which take any amount of bytes
+   * in one instruction.
+   */
+  MemoryOperationStatus writeStreamInstruction(uint32_t initialAddress,
+      uint32_t length, ChunkSource& source, bool writeEnableFirst) {
+    if (!isValidAddress(initialAddress)) {
+      printInvalidAddress("writeStream");
+      return MemoryOperationStatus::kError;
+    }
+    if (writeEnableFirst) {
+      beginCommand(Traits::kWriteEnableOpcode);
+      nextCommand(Traits::kWriteOpcode);
+    } else {
+      beginCommand(Traits::kWriteOpcode);
+    }
+    sendAddress(initialAddress);
+    sendChunks(Traits::bus(), source, 0, length);
+    endCommand();
+    return MemoryOperationStatus::kDone;
+  }
+
+  /**
+   * @return false, with nothing queued, if initialAddress is invalid or the
+   *    batch is full.
+   */
+  bool addWriteInstruction(SpiCommandBatch& batch, uint8_t* buffer,
+      uint16_t size, uint32_t initialAddress) {
+    if (!isValidAddress(initialAddress)) {
+      printInvalidAddress("addWrite");
+      return false;
+    }
+    return batch.add(Traits::kWriteOpcode, initialAddress, Traits::kAddressBytes,
+        SpiCommandBatch::DataPhase::kSend, buffer, size);
+  }
+
+private:
+  // The buffer version of transfer replaces the sent bytes with the received
+  // ones, so writes send byte by byte to leave the caller's buffer untouched.
+  void transferData(uint8_t opcode, uint8_t* buffer, int amountOfBytes) {
+    if (opcode == Traits::kWriteOpcode) {
+      for (int i = 0; i < amountOfBytes; ++i) {
+        Traits::bus().transfer(buffer[i]);
+      }
+    } else {
+      Traits::bus().transfer(buffer, amountOfBytes);
+    }
+  }
+
+  const SPISettings settings_;
+};
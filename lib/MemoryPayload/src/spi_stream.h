@@ -0,0 +1,86 @@
+/**
+ * @file spi_stream.h
+ * @brief Read-and-compare loop shared by the verifyRange() of the drivers.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * SPI.transfer() waits for the byte to finish before returning, so a plain
+ * read-then-compare leaves the bus idle while the byte is being checked. On
+ * the AVR, SPDR is loaded with the next dummy byte as soon as the previous
+ * one has arrived, and the received byte is compared against the pattern
+ * while the next one shifts in. Other targets (the native simulator) fall
+ * back to SPIClass::transfer(), byte for byte the same sequence on the bus.
+ *
+ * The caller has already selected the memory and sent the read instruction
+ * and address, and deselects it afterwards.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <stdint.h>
+
+#include "./mismatch_sink.h"
+#include "./pattern_generator.h"
+
+class SpiStream {
+public:
+  explicit SpiStream(SPIClass& bus) : bus_(bus), received_(0) {}
+
+  // Start shifting out a byte, the answer is collected by finish().
+  void start(uint8_t data) {
+#ifdef __AVR__
+    (void)bus_;
+    SPDR = data;
+#else
+    received_ = bus_.transfer(data);
+#endif
+  }
+
+  // Wait for the byte started last and return what the memory sent back.
+  uint8_t finish() {
+#ifdef __AVR__
+    while (!(SPSR & _BV(SPIF))) {
+    }
+    received_ = SPDR;
+#endif
+    return received_;
+  }
+
+private:
+  SPIClass& bus_;
+  uint8_t received_;
+};
+
+/**
+ * @brief Clock out length bytes and compare each one against the pattern,
+ *    recording the mismatches in sink.
+ *
+ * @param address of the first byte that is going to be received.
+ * @param addressMask capacity - 1 of the memory, the address wraps to 0
+ *    past the end the same way the memory's internal counter does.
+ * @return amount of mismatching bytes.
+ */
+inline uint32_t streamVerify(SpiStream& stream, uint32_t address,
+    uint32_t length, uint32_t addressMask, const PatternGenerator& pattern,
+    MismatchSink& sink) {
+  if (length == 0) {
+    return 0;
+  }
+  uint32_t mismatches = 0;
+  stream.start(0x00);
+  for (uint32_t i = 1; i <= length; ++i) {
+    const uint8_t received = stream.finish();
+    if (i < length) {
+      stream.start(0x00);
+    }
+    const uint8_t difference = received ^ pattern.expectedByte(address);
+    if (difference != 0) {
+      sink.record(address, difference);
+      ++mismatches;
+    }
+    address = (address + 1) & addressMask;
+  }
+  return mismatches;
+}
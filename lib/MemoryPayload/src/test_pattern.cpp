@@ -0,0 +1,74 @@
+#include "./test_pattern.h"
+
+#include <Arduino.h>
+
+namespace {
+
+const uint8_t kWalkingOnes[8] PROGMEM = {
+  0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80
+};
+
+const PatternKind kPassSchedule[] PROGMEM = {
+  PatternKind::kAllZeros,
+  PatternKind::kCheckerboard,
+  PatternKind::kAddressInData,
+  PatternKind::kWalkingOnes,
+  PatternKind::kPseudoRandom,
+};
+
+const uint8_t kPassScheduleLength = sizeof(kPassSchedule) / sizeof(kPassSchedule[0]);
+
+} // namespace
+
+/**
+ * The pseudo random byte is the top of a multiply-xorshift hash of the
+ * address, not the output of a running LFSR, so that any address can be
+ * checked on its own. Two 32 bit multiplications are cheap enough on the
+ * AVR next to the 16 clock cycles a byte takes on the bus at 8 MHz.
+ */
+uint8_t TestPattern::expectedByte(uint32_t address) const {
+  uint8_t value = 0x00;
+  switch (kind_) {
+    case PatternKind::kAllZeros:
+      value = 0x00;
+      break;
+    case PatternKind::kAllOnes:
+      value = 0xFF;
+      break;
+    case PatternKind::kCheckerboard:
+      value = (address & 1) ? 0xAA : 0x55;
+      break;
+    case PatternKind::kInverseCheckerboard:
+      value = (address & 1) ? 0x55 : 0xAA;
+      break;
+    case PatternKind::kAddressInData:
+      value = (uint8_t)(address ^ (address >> 8) ^ (address >> 16) ^ seed_);
+      break;
+    case PatternKind::kWalkingOnes:
+      value = pgm_read_byte(&kWalkingOnes[(uint8_t)(address + seed_) & 0x07]);
+      break;
+    case PatternKind::kPseudoRandom: {
+      uint32_t hash = (address ^ seed_) * 0x9E3779B1ul;
+      hash ^= hash >> 15;
+      hash *= 0x2C1B3C6Dul;
+      hash ^= hash >> 13;
+      value = (uint8_t)(hash >> 24);
+      break;
+    }
+  }
+  return value ^ invertMask_;
+}
+
+TestPattern TestPattern::inverse() const {
+  TestPattern inverted = *this;
+  inverted.invertMask_ ^= 0xFF;
+  return inverted;
+}
+
+TestPattern TestPattern::forPass(uint32_t pass) {
+  const uint32_t step = pass / 2;
+  const PatternKind kind = (PatternKind)pgm_read_byte(
+      &kPassSchedule[step % kPassScheduleLength]);
+  TestPattern pattern(kind, step);
+  return (pass & 1) ? pattern.inverse() : pattern;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file test_pattern.h
+ * @brief Data patterns written to and verified against the memories.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * Every pattern computes the byte of any address in constant time, so no
+ * copy of what was written is kept in RAM and writes and verifies can
+ * regenerate it chunk by chunk (see PatternGenerator::fill()).
+ *
+ * Kind                 | Byte at address a
+ * kAllZeros            | 0x00
+ * kAllOnes             | 0xFF
+ * kCheckerboard        | 0x55 at even addresses, 0xAA at odd ones
+ * kInverseCheckerboard | 0xAA at even addresses, 0x55 at odd ones
+ * kAddressInData       | a[7:0] ^ a[15:8] ^ a[23:16] ^ seed
+ * kWalkingOnes         | a single 1 at bit (a + seed) % 8
+ * kPseudoRandom        | integer hash of a and seed
+ *
+ * An upset can only be seen if it moves a bit away from the value that was
+ * written, so a bit that holds 0 during a pass is blind to 1 -> 0 flips.
+ * inverse() gives the same pattern with every bit inverted; forPass()
+ * alternates a pattern and its inverse so each cell is checked holding
+ * both values.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "./pattern_generator.h"
+
+enum class PatternKind : uint8_t {
+  kAllZeros,
+  kAllOnes,
+  kCheckerboard,
+  kInverseCheckerboard,
+  kAddressInData,
+  kWalkingOnes,
+  kPseudoRandom,
+};
+
+class TestPattern : public PatternGenerator {
+public:
+  explicit TestPattern(PatternKind kind, uint32_t seed = 0)
+      : kind_(kind), invertMask_(0x00), seed_(seed) {}
+
+  uint8_t expectedByte(uint32_t address) const override;
+
+  /**
+   * @brief Same pattern and seed with every bit inverted.
+   */
+  TestPattern inverse() const;
+
+  /**
+   * @brief Pattern of the given pass of a scrub. Even passes take the next
+   *    kind of a fixed schedule (all zeros, checkerboard, address in data,
+   *    walking ones, pseudo random) seeded with the pass number, and the
+   *    following odd pass writes its inverse.
+   */
+  static TestPattern forPass(uint32_t pass);
+
+  PatternKind kind() const { return kind_; }
+  uint32_t seed() const { return seed_; }
+  bool isInverted() const { return invertMask_ != 0x00; }
+
+private:
+  PatternKind kind_;
+  uint8_t invertMask_;
+  uint32_t seed_;
+};
@@ -1,7 +1,8 @@
 /**
  * @file eeprom_test.cpp
  * @author Marcos Barrios
- * @brief Meant to test whether EEPROM's pins are properly connected.
+ * @brief Writes a test pattern to the whole EEPROM and then scrubs it
+ *    continuously, reporting every complete pass.
  * @version 0.1
  * @date 2023-09-12
  * 
@@ -10,64 +11,36 @@
  */
 
 #include <memory_eeprom.h>
+#include <scrub_engine.h>
+#include <test_pattern.h>
 #include <Arduino.h>
 
 // **** first update chip select pins on the class ****
 
+const uint32_t kCapacityEEPROM = 262144;
+const uint32_t kScrubStepBytes = 1024; // about 2.5 ms on the bus
+const uint32_t kScrubBudgetMicros = 50000; // per loop()
+
 MemoryEEPROM eeprom;
 
-uint8_t obtainedByte = 0x66; // dummy value
+SPIClass hspi(HSPI);
 
-bool enabled;
+const TestPattern kPattern(PatternKind::kCheckerboard);
 
-SPIClass hspi(HSPI);
+ScrubEngine<MemoryEEPROM> scrubber(eeprom, kCapacityEEPROM, kScrubStepBytes, kPattern);
 
+// One write cycle per page, so about 5 s for the 1024 pages.
 void setup() {
-  pinMode(CHIP_SELECT_EEPROM, OUTPUT);
+  ChipSelect<CHIP_SELECT_EEPROM>::begin();
   hspi.begin();
   Serial.begin(9600);
   delay(1000);
-  eeprom.enableWrite();
-  delay(1);
-  enabled = eeprom.isWriteEnabled();
-  delay(1);
-  const uint8_t kByteToWrite = 0x83;
-  eeprom.writeByte(kByteToWrite, 22222); // arbitrary address
-  //eeprom.waitUntilReady();
-  delay(5); // write time is never larger than 5 ms according to the datasheet
-  obtainedByte = eeprom.readByte(22222);
+  PatternSource source(kPattern, 0);
+  eeprom.writeStream(0, kCapacityEEPROM, source);
 }
 
 void loop() {
-  Serial.println("Obtained byte value from EEPROM read operation: ");
-  Serial.print(obtainedByte);
-  Serial.println();
-  if (enabled) {
-    Serial.println("Write is enabled");
-  } else {
-    Serial.println("Write is disabled.");
+  if (scrubber.run(kScrubBudgetMicros)) {
+    printPassReport(F("EEPROM"), scrubber);
   }
-  // Serial.print(obtainedByte);
-  // Serial.println();
-  // // int valueOfInput = digitalRead(13);
-  // // Serial.print("Input pin: ");
-  // // Serial.print(valueOfInput);
-  // // Serial.println();
-  // // int valueOfOutput = digitalRead(12);
-  // // Serial.print("Output pin: ");
-  // // Serial.print(valueOfOutput);
-  // // Serial.println();
-  // // int valueOfChipSelect = digitalRead(18);
-  // // Serial.print("Chip select pin:valueOf ");
-  // // Serial.print(valueOfChipSelect);
-  // // Serial.println();
-  // // int valueOfHold = digitalRead(19);
-  // // Serial.print("Hold pin: ");
-  // // Serial.print(valueOfHold);
-  // // Serial.println();
-  // // int valueOfWrite = digitalRead(20);
-  // // Serial.print("Write protect pinvalueOf: ");
-  // // Serial.print(valueOfWrite);
-  // // Serial.println();
-  delay(1000);
 }
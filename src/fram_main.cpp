@@ -1,7 +1,8 @@
 /**
  * @file fram_test.cpp
  * @author Marcos Barrios
- * @brief Meant to test whether FRAM's pins are properly connected.
+ * @brief Writes a test pattern to the whole FRAM and then scrubs it
+ *    continuously, reporting every complete pass.
  * @version 0.1
  * @date 2023-09-12
  * 
@@ -11,28 +12,34 @@
 
 #include <Arduino.h>
 #include <memory_fram.h>
+#include <scrub_engine.h>
+#include <test_pattern.h>
 
 #include "SPI.h"
 
 // **** first update chip select pins on the class ****
 
+const uint32_t kCapacityFRAM = 1048576;
+const uint32_t kScrubStepBytes = 1024; // about 1.5 ms on the bus
+const uint32_t kScrubBudgetMicros = 50000; // per loop()
+
 MemoryFRAM fram;
 
-uint8_t obtainedByte = 0x66; // dummy value
+const TestPattern kPattern(PatternKind::kCheckerboard);
+
+ScrubEngine<MemoryFRAM> scrubber(fram, kCapacityFRAM, kScrubStepBytes, kPattern);
 
 void setup() {
-  pinMode(CHIP_SELECT_FRAM, OUTPUT);
+  ChipSelect<CHIP_SELECT_FRAM>::begin();
   SPI.begin();
   Serial.begin(9600);
   delay(1000); // TODO: datasheet in chinese, unsure of powerup delay.
-  fram.enableWrite();
-  delay(1);
-  const uint8_t kByteToWrite = 0x83;
-  fram.writeByte(kByteToWrite, 22222); // arbitrary address
-  obtainedByte = fram.readByte(22222);
+  PatternSource source(kPattern, 0);
+  fram.writeStream(0, kCapacityFRAM, source); // enables write itself
 }
 
 void loop() {
-  Serial.println("Obtained byte value from FRAM read operation: " + obtainedByte);
-  delay(1000);
+  if (scrubber.run(kScrubBudgetMicros)) {
+    printPassReport(F("FRAM"), scrubber);
+  }
 }
@@ -1,7 +1,8 @@
 /**
  * @file mram_test.cpp
  * @author Marcos Barrios
- * @brief Meant to test whether MRAM's pins are properly connected.
+ * @brief Writes a test pattern to the whole MRAM and then scrubs it
+ *    continuously, reporting every complete pass.
  * @version 0.1
  * @date 2023-09-12
  *
@@ -11,29 +12,35 @@
 
 #include <Arduino.h>
 #include <memory_mram.h>
+#include <scrub_engine.h>
+#include <test_pattern.h>
 
 #include "SPI.h"
 
 // **** first update chip select pins on the class ****
 
+const uint32_t kCapacityMRAM = 524288; // MR25H40 is 4 Mbit
+const uint32_t kScrubStepBytes = 1024; // about 1.5 ms on the bus
+const uint32_t kScrubBudgetMicros = 50000; // per loop()
+
 MemoryMRAM mram;
 
-uint8_t obtainedByte = 0x66; // dummy value
+const TestPattern kPattern(PatternKind::kCheckerboard);
+
+ScrubEngine<MemoryMRAM> scrubber(mram, kCapacityMRAM, kScrubStepBytes, kPattern);
 
 void setup() {
-  pinMode(CHIP_SELECT_MRAM, OUTPUT);
+  ChipSelect<CHIP_SELECT_MRAM>::begin();
   SPI.begin();
   Serial.begin(9600);
   delay(400); // minimum wait times according to datasheet
-  mram.enableWrite();
-  delay(1);
-  const uint8_t kByteToWrite = 0x83;
-  mram.writeByte(kByteToWrite, 22222); // arbitrary address
-  delay(1);
-  obtainedByte = mram.readByte(22222);
+  mram.enableWrite(); // WEL stays at 1 after each write
+  PatternSource source(kPattern, 0);
+  mram.writeStream(0, kCapacityMRAM, source);
 }
 
 void loop() {
-  Serial.println("Obtained byte value from MRAM read operation: " + obtainedByte);
-  delay(1000);
+  if (scrubber.run(kScrubBudgetMicros)) {
+    printPassReport(F("MRAM"), scrubber);
+  }
 }
@@ -1,7 +1,9 @@
 /**
  * @file nand_test.cpp
  * @author Marcos Barrios
- * @brief Meant to test whether NAND's pins are properly connected.
+ * @brief Writes a test pattern to every page of the NAND Flash and then
+ *    scrubs it continuously, reporting every complete pass and the pages
+ *    the internal ECC corrected or could not correct.
  * @version 0.1
  * @date 2023-09-12
  *
@@ -11,46 +13,95 @@
 
 #include <Arduino.h>
 #include <memory_nand_flash.h>
+#include <scrub_engine.h>
+#include <test_pattern.h>
 
 #include "SPI.h"
 
 // **** first update chip select pins on the class ****
 
+const uint32_t kScrubBudgetMicros = 50000; // per loop()
+const uint16_t kBadBlockTableEepromAddress = 0; // internal EEPROM of the Nano
+const uint16_t kFillProgressEepromAddress =
+    kBadBlockTableEepromAddress + NandBadBlockTable::kStoredBytes;
+const uint16_t kFillCheckpointBlocks = 16; // about 3 s of fill per save
+
 MemoryNANDFlash nand;
 
-Array<uint8_t, 2112> obtainedPage = {};
+const TestPattern kPattern(PatternKind::kAddressInData);
+
+// 237 bytes, see nand_ecc_histogram.h
+NandEccHistogram eccHistogram;
+
+NandBadBlockTable badBlocks;
 
+NandFillProgress fillProgress;
+
+// one page per step, compared only when ECC could not correct it. Built in
+// setup(), once the geometry is known.
+NandFlashEccScrub eccScrub(nand);
+ScrubEngine<NandFlashEccScrub>* scrubber = nullptr;
+
+// dont execute fill() lightly, as there are limited amount of write
+// operations to a single page. Every boot costs each block one erase and
+// each page one program, except a boot that finishes a fill interrupted by
+// a reset, which goes on from its last checkpoint.
 void setup() {
-  pinMode(CHIP_SELECT_NAND_FLASH, OUTPUT);
+  ChipSelect<CHIP_SELECT_NAND_FLASH>::begin();
   SPI.begin();
   Serial.begin(9600);
   delay(5); // after 5 ms device is fully accessible
-  nand.enableWrite();
-  delay(1);
-  Array<uint8_t, 2112> pageToWrite = {};
-  for (size_t i = 0; i < 2112; ++i) { // I want to change values to any non default
-    pageToWrite[i] = (i + 1) % 256;
+  nand.disableBlockProtection(); // every block is protected at power up
+  // Before anything is addressed, a different part must not be written with
+  // the W25N01GV layout.
+  nand.detectGeometry();
+  const NandGeometry& geometry = nand.geometry();
+  Serial.print(F("NAND Flash blocks: "));
+  Serial.print(geometry.blocks);
+  Serial.print(F(", page bytes: "));
+  Serial.println(geometry.pageBytes());
+  // The markers are only there until the first erase, so they are scanned
+  // on the first boot and read from the internal EEPROM afterwards.
+  if (!badBlocks.load(kBadBlockTableEepromAddress)) {
+    nand.scanBadBlocks(badBlocks);
+    badBlocks.save(kBadBlockTableEepromAddress);
   }
-
-  // (2112 bytes/page * 64 pages/block) / 8 bits = 16896 - 1 = 16895 page address
-  const size_t kFirstPageAddressInSecondBlock = 16895;
-
-  // dont execute writePage() lightly, as there are limited amount
-  // of write operations to a single page.
-  nand.writePage(&pageToWrite[0], kFirstPageAddressInSecondBlock);
-  nand.waitUntilReady();
-  nand.readPage(16895, &obtainedPage[0]);
-
-  // page no longer writtable after first write page because it is no longer in
-  // "erased" state, which is on by default.
+  nand.setBadBlockTable(&badBlocks);
+  Serial.print(F("NAND Flash bad blocks: "));
+  Serial.println(badBlocks.badBlocks());
+  if (!fillProgress.load(kFillProgressEepromAddress) ||
+      fillProgress.nextBlock() >= geometry.blocks) {
+    fillProgress.clear();
+  }
+  const uint32_t fillStart = millis();
+  while (nand.fill(kPattern, fillProgress, kFillCheckpointBlocks)
+      == MemoryOperationStatus::kPending) {
+    fillProgress.save(kFillProgressEepromAddress);
+  }
+  fillProgress.save(kFillProgressEepromAddress);
+  Serial.print(F("NAND Flash filled in "));
+  Serial.print(millis() - fillStart);
+  Serial.print(F(" ms, failed blocks: "));
+  Serial.print(fillProgress.failedBlocks());
+  Serial.print(F(", slowest erase: "));
+  Serial.print(fillProgress.slowestEraseMicros());
+  Serial.print(F(" us, slowest program: "));
+  Serial.print(fillProgress.slowestPageMicros());
+  Serial.println(F(" us"));
+  nand.setEccHistogram(&eccHistogram);
+  static ScrubEngine<NandFlashEccScrub> engine(eccScrub, eccScrub.capacity(),
+      geometry.pageBytes(), kPattern);
+  scrubber = &engine;
 }
 
 void loop() {
-  Serial.println("Obtained page from NAND read page operation: ");
-  for (size_t i = 0; i < 2112; ++i) {
-    Serial.print(obtainedPage[i]);
+  if (scrubber->run(kScrubBudgetMicros)) {
+    printPassReport(F("NAND Flash"), *scrubber);
+    Serial.print(F("ECC corrected pages: "));
+    Serial.print(eccHistogram.totalCorrected());
+    Serial.print(F(", uncorrectable pages: "));
+    Serial.print(eccHistogram.totalUncorrectable());
+    Serial.print(F(", blocks affected: "));
+    Serial.println(eccHistogram.affectedBlocks());
   }
-  Serial.println();
-
-  delay(1000);
 }
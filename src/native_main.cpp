@@ -0,0 +1,1249 @@
+/**
+ * @file native_main.cpp
+ * @brief Host entry point of the [env:native] target. Runs the memory
+ *    drivers against the simulated chips of lib/ArduinoSim and prints what
+ *    every driver call costs on the bus.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * Times are those of an Arduino Nano (see SimCostModel in sim_bus.h), so the
+ * numbers are the ones to expect on the breakout board, including the NAND
+ * Flash, which is not soldered yet.
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <bit_flips.h>
+#include <bus_scheduler.h>
+#include <bus_tasks.h>
+#include <chunk_stream.h>
+#include <memory_eeprom.h>
+#include <memory_fram.h>
+#include <memory_mram.h>
+#include <memory_nand_flash.h>
+#include <memory_nor_flash.h>
+#include <mismatch_sink.h>
+#include <nor_erase_counts.h>
+#include <nor_erase_planner.h>
+#include <nor_refresh.h>
+#include <scrub_engine.h>
+#include <sim_bus.h>
+#include <sim_eeprom.h>
+#include <sim_nand_flash.h>
+#include <sim_nor_flash.h>
+#include <sim_serial_ram.h>
+#include <spi_lanes.h>
+#include <test_pattern.h>
+
+#include <stdio.h>
+
+SPIClass hspi(HSPI);
+
+namespace {
+
+template <typename Operation>
+void measure(const char* label, Operation operation) {
+  const SimCounters before = simBus.counters();
+  operation();
+  printSimCounters(label, simBus.counters() - before);
+}
+
+void printResult(const char* label, bool passed) {
+  printf("  -> %s: %s\n", label, passed ? "ok" : "MISMATCH");
+}
+
+/**
+ * Scrubs a whole memory with 50 ms loop() budgets, as the mains do, and
+ * prints the pass time and the longest loop() call. The chip already holds
+ * the pattern.
+ */
+template <typename Memory>
+void runScrub(const char* name, Memory& memory, uint32_t capacity,
+    uint32_t stepBytes, const PatternGenerator& pattern) {
+  ScrubEngine<Memory> scrubber(memory, capacity, stepBytes, pattern);
+  uint64_t longestCallNanos = 0;
+  uint32_t calls = 0;
+  bool passFinished = false;
+  while (!passFinished) {
+    const uint64_t before = simBus.nowNanos();
+    passFinished = scrubber.run(50000);
+    const uint64_t callNanos = simBus.nowNanos() - before;
+    longestCallNanos = callNanos > longestCallNanos ? callNanos : longestCallNanos;
+    ++calls;
+  }
+  printf("  %s scrub pass: %lu ms, %lu B/s, %lu loop() calls of up to %.1f ms,"
+      " %lu mismatches\n", name, (unsigned long)scrubber.lastPassMillis(),
+      (unsigned long)scrubber.bytesPerSecond(), (unsigned long)calls,
+      longestCallNanos / 1e6, (unsigned long)scrubber.lastPassMismatches());
+}
+
+// Compares every byte a readStream() hands over against a pattern.
+class PatternCheckSink : public ChunkSink {
+public:
+  PatternCheckSink(const PatternGenerator& pattern, uint32_t baseAddress)
+      : pattern_(pattern), baseAddress_(baseAddress), bytes_(0), mismatches_(0) {}
+
+  void write(uint32_t offset, const uint8_t* chunk, uint8_t size) override {
+    for (uint8_t i = 0; i < size; ++i) {
+      if (chunk[i] != pattern_.expectedByte(baseAddress_ + offset + i)) {
+        ++mismatches_;
+      }
+    }
+    bytes_ += size;
+  }
+
+  uint32_t bytes() const { return bytes_; }
+  uint32_t mismatches() const { return mismatches_; }
+
+private:
+  const PatternGenerator& pattern_;
+  uint32_t baseAddress_;
+  uint32_t bytes_;
+  uint32_t mismatches_;
+};
+
+/**
+ * Writes and reads back 70000 bytes from address with the stream methods,
+ * more than an int size can hold on the Nano.
+ */
+template <typename Memory>
+void runStream(Memory& memory, uint32_t address) {
+  const uint32_t kLength = 70000;
+  const TestPattern pattern(PatternKind::kPseudoRandom, 7);
+  PatternSource source(pattern, address);
+  MemoryOperationStatus written = MemoryOperationStatus::kError;
+  measure("writeStream(70000)", [&] {
+    written = memory.writeStream(address, kLength, source);
+  });
+  PatternCheckSink sink(pattern, address);
+  MemoryOperationStatus read = MemoryOperationStatus::kError;
+  measure("readStream(70000)", [&] {
+    read = memory.readStream(address, kLength, sink);
+  });
+  printResult("stream read back", written == MemoryOperationStatus::kDone
+      && read == MemoryOperationStatus::kDone && sink.bytes() == kLength
+      && sink.mismatches() == 0);
+}
+
+/**
+ * Fills the chip with the address in data pattern, flips a few bits and verifies the
+ * first verifiedBytes twice: reading 256 byte blocks with readBlock and
+ * comparing them afterwards, as the mains do, and with verifyRange().
+ */
+template <typename Memory, typename Chip, typename ReadBlock>
+void runVerify(Memory& memory, Chip& chip, uint32_t capacity,
+    uint32_t verifiedBytes, ReadBlock readBlock) {
+  const TestPattern pattern(PatternKind::kAddressInData);
+  for (uint32_t address = 0; address < capacity; ++address) {
+    chip.poke(address, pattern.expectedByte(address));
+  }
+  const uint32_t flips[] = {1, verifiedBytes / 2, verifiedBytes - 1};
+  for (uint32_t address : flips) {
+    chip.poke(address, chip.peek(address) ^ 0x10);
+  }
+
+  uint32_t blockMismatches = 0;
+  measure("read+compare blocks", [&] {
+    static uint8_t block[256];
+    for (uint32_t start = 0; start < verifiedBytes; start += sizeof(block)) {
+      readBlock(start, block);
+      for (uint32_t i = 0; i < sizeof(block); ++i) {
+        blockMismatches += block[i] != pattern.expectedByte(start + i);
+      }
+    }
+  });
+  MismatchSink sink;
+  uint32_t streamMismatches = 0;
+  measure("verifyRange()", [&] {
+    streamMismatches = memory.verifyRange(0, verifiedBytes, pattern, sink);
+  });
+  printResult("3 flipped bytes found",
+      blockMismatches == 3 && streamMismatches == 3 && sink.stored() == 3
+      && sink.at(1).address == verifiedBytes / 2 && sink.at(1).xorMask == 0x10);
+}
+
+void runEeprom() {
+  printf("\n## EEPROM M95M02 (requested %lu Hz)\n",
+      (unsigned long)SPI_TRANSFER_SPEED_EEPROM);
+  SimEeprom chip(CHIP_SELECT_EEPROM);
+  MemoryEEPROM eeprom;
+  printSimCountersHeader();
+  measure("enableWrite()", [&] { eeprom.enableWrite(); });
+  bool enabled = false;
+  measure("isWriteEnabled()", [&] { enabled = eeprom.isWriteEnabled(); });
+  printResult("WEL set", enabled);
+  measure("writeByte()", [&] { eeprom.writeByte(0x83, 22222); });
+  measure("waitUntilReady()", [&] { eeprom.waitUntilReady(); });
+  uint8_t obtainedByte = 0;
+  measure("readByte()", [&] { obtainedByte = eeprom.readByte(22222); });
+  printResult("byte read back", obtainedByte == 0x83);
+
+  Array<uint8_t, 256> page;
+  for (size_t i = 0; i < 256; ++i) {
+    page[i] = (i + 1) % 256;
+  }
+  eeprom.enableWrite();
+  measure("writePage()", [&] { eeprom.writePage(page, 512); });
+  measure("waitUntilReady()", [&] { eeprom.waitUntilReady(); });
+  Array<uint8_t, 256> obtainedPage;
+  measure("readPage()", [&] { obtainedPage = eeprom.readPage(512); });
+  bool same = true;
+  for (size_t i = 0; i < 256; ++i) {
+    same = same && obtainedPage[i] == page[i];
+  }
+  printResult("page read back", same);
+
+  runVerify(eeprom, chip, SimEeprom::kCapacity, SimEeprom::kCapacity,
+      [&](uint32_t start, uint8_t* block) {
+        const Array<uint8_t, 256> page = eeprom.readPage(start);
+        for (size_t i = 0; i < 256; ++i) {
+          block[i] = page[i];
+        }
+      });
+  runScrub("EEPROM", eeprom, SimEeprom::kCapacity, 1024,
+      TestPattern(PatternKind::kAddressInData));
+  runStream(eeprom, 1000);
+}
+
+template <typename Memory>
+void runSerialRam(const char* title, Memory& memory, SimSerialRam& chip) {
+  printf("\n## %s\n", title);
+  printSimCountersHeader();
+  measure("enableWrite()", [&] { memory.enableWrite(); });
+  measure("writeByte()", [&] { memory.writeByte(0x83, 22222); });
+  uint8_t obtainedByte = 0;
+  measure("readByte()", [&] { obtainedByte = memory.readByte(22222); });
+  printResult("byte read back", obtainedByte == 0x83);
+
+  // The 1 byte writes of a fault injection test, first one instruction
+  // (and transaction) at a time, then as many per transaction as a
+  // SpiCommandBatch holds.
+  const uint32_t kFaultBytes = 64;
+  uint8_t faults[kFaultBytes];
+  for (uint32_t i = 0; i < kFaultBytes; ++i) {
+    faults[i] = i ^ 0x5A;
+  }
+  memory.enableWrite();
+  measure("64 x writeByte()", [&] {
+    for (uint32_t i = 0; i < kFaultBytes; ++i) {
+      memory.writeByte(faults[i], 8192 + 3 * i);
+    }
+  });
+  memory.enableWrite();
+  measure("64 x addWrite(), batched", [&] {
+    SpiCommandBatch batch;
+    for (uint32_t i = 0; i < kFaultBytes; ++i) {
+      if (batch.size() + 2 > SpiCommandBatch::kMaxSegments) {
+        memory.execute(batch);
+        batch.clear();
+      }
+      memory.addWrite(batch, &faults[i], 1, 16384 + 3 * i);
+    }
+    memory.execute(batch);
+  });
+  bool faultsWritten = true;
+  for (uint32_t i = 0; i < kFaultBytes; ++i) {
+    faultsWritten = faultsWritten && chip.peek(8192 + 3 * i) == faults[i]
+        && chip.peek(16384 + 3 * i) == faults[i];
+  }
+  printResult("both ways written", faultsWritten);
+
+  static uint8_t block[4096];
+  for (size_t i = 0; i < sizeof(block); ++i) {
+    block[i] = (i + 1) % 256;
+  }
+  memory.enableWrite();
+  measure("writeNBytes(4096)", [&] { memory.writeNBytes(block, sizeof(block), 4096); });
+  static uint8_t obtainedBlock[4096];
+  measure("readNBytes(4096)", [&] { memory.readNBytes(4096, obtainedBlock, sizeof(obtainedBlock)); });
+  bool same = true;
+  for (size_t i = 0; i < sizeof(block); ++i) {
+    same = same && obtainedBlock[i] == block[i] && chip.peek(4096 + i) == block[i];
+  }
+  printResult("block read back", same);
+
+  runVerify(memory, chip, chip.capacity(), chip.capacity(),
+      [&](uint32_t start, uint8_t* block) { memory.readNBytes(start, block, 256); });
+
+  // One write and verify of the first 64 KB per pass of the schedule, the
+  // data regenerated 256 bytes at a time. Each pattern and its inverse
+  // must differ in every bit.
+  const uint32_t kPassBytes = 65536;
+  uint32_t passMismatches = 0;
+  bool complementary = true;
+  measure("10 pattern passes", [&] {
+    for (uint32_t pass = 0; pass < 10; ++pass) {
+      const TestPattern pattern = TestPattern::forPass(pass);
+      for (uint32_t start = 0; start < kPassBytes; start += 256) {
+        pattern.fill(start, block, 256);
+        memory.enableWrite();
+        memory.writeNBytes(block, 256, start);
+      }
+      MismatchSink sink;
+      passMismatches += memory.verifyRange(0, kPassBytes, pattern, sink);
+      if (pass & 1) {
+        const TestPattern previous = TestPattern::forPass(pass - 1);
+        for (uint32_t address = 0; address < 4096; ++address) {
+          complementary = complementary
+              && (previous.expectedByte(address) ^ pattern.expectedByte(address)) == 0xFF;
+        }
+      }
+    }
+  });
+  printResult("patterns written and verified", passMismatches == 0 && complementary);
+  const TestPattern scrubPattern = TestPattern::forPass(9);
+  for (uint32_t address = 0; address < chip.capacity(); ++address) {
+    chip.poke(address, scrubPattern.expectedByte(address));
+  }
+  runScrub(title, memory, chip.capacity(), 1024, scrubPattern);
+  memory.enableWrite();
+  runStream(memory, 1000);
+}
+
+void runNandFlash() {
+  printf("\n## NAND Flash W25N01GV (requested %lu Hz)\n",
+      (unsigned long)SPI_TRANSFER_SPEED_NAND_FLASH);
+  SimNandFlash chip(CHIP_SELECT_NAND_FLASH);
+  chip.setFactoryBadBlock(5);
+  chip.setFactoryBadBlock(700);
+  MemoryNANDFlash nand;
+  printSimCountersHeader();
+  // The geometry comes from the parameter page. Its first copy is damaged,
+  // so the second one is used.
+  chip.corruptParameterPage(90, 3);
+  bool detected = false;
+  measure("detectGeometry()", [&] { detected = nand.detectGeometry(); });
+  const NandGeometry& geometry = nand.geometry();
+  printf("  %u + %u bytes per page, %u pages per block, %u blocks, %u bit ECC\n",
+      geometry.dataBytes, geometry.spareBytes, geometry.pagesPerBlock(),
+      geometry.blocks, geometry.eccBits);
+  uint8_t uniqueId[16];
+  bool uniqueIdRead = false;
+  measure("readUniqueId()", [&] { uniqueIdRead = nand.readUniqueId(uniqueId); });
+  printResult("W25N01GV geometry and IDs", detected
+      && geometry.pageBytes() == 2112 && geometry.pages() == 65536
+      && geometry.pagesPerBlock() == 64 && nand.readJedecId() == 0xEFAA21
+      && uniqueIdRead);
+  // First boot: nothing stored in the internal EEPROM yet, so the markers
+  // are scanned, before any erase, and the table is stored for the next
+  // boots.
+  NandBadBlockTable badBlocks;
+  if (!badBlocks.load(0)) {
+    measure("scanBadBlocks()", [&] { nand.scanBadBlocks(badBlocks); });
+    badBlocks.save(0);
+  }
+  NandBadBlockTable storedBadBlocks;
+  printResult("bad blocks 5 and 700 stored", storedBadBlocks.load(0)
+      && storedBadBlocks.badBlocks() == 2 && storedBadBlocks.isBad(5)
+      && storedBadBlocks.isBad(700));
+  nand.setBadBlockTable(&badBlocks);
+  measure("disableBlockProtection()", [&] { nand.disableBlockProtection(); });
+  measure("enableWrite()", [&] { nand.enableWrite(); });
+  measure("eraseBlock()", [&] { nand.eraseBlock(64); });
+  measure("waitUntilReady()", [&] { nand.waitUntilReady(); });
+
+  static uint8_t page[2112];
+  for (size_t i = 0; i < sizeof(page); ++i) {
+    page[i] = (i + 1) % 256;
+  }
+  nand.enableWrite();
+  measure("writePage()", [&] { nand.writePage(page, 64); });
+  measure("waitUntilReady()", [&] { nand.waitUntilReady(); });
+  static uint8_t obtainedPage[2112];
+  measure("readPage()", [&] { nand.readPage(64, obtainedPage); });
+  bool same = true;
+  for (size_t i = 0; i < sizeof(page); ++i) {
+    same = same && obtainedPage[i] == page[i];
+  }
+  printResult("page read back", same);
+
+  measure("loadPageIntoBuffer()", [&] { nand.loadPageIntoBuffer(64); });
+  measure("waitUntilReady()", [&] { nand.waitUntilReady(); });
+  uint8_t obtainedByte = 0;
+  measure("readByte()", [&] { obtainedByte = nand.readByte((64ul << 11) | 100); });
+  printResult("byte read back", obtainedByte == page[100]);
+  // A spot check of another byte of the page in the buffer is a single
+  // READ, and re-verifying the page after a mismatch reads the buffer again
+  // instead of loading the page from the array.
+  measure("readByte(), same page", [&] { obtainedByte = nand.readByte((64ul << 11) | 200); });
+  nand.invalidateBuffer();
+  measure("readByte(), page not in buffer", [&] { obtainedByte = nand.readByte((64ul << 11) | 200); });
+  printResult("byte read back", obtainedByte == page[200]);
+  MismatchSink sink;
+  uint32_t firstMismatches = 0;
+  uint32_t secondMismatches = 0;
+  nand.invalidateBuffer();
+  measure("verifyRange(page 64)", [&] {
+    firstMismatches = nand.verifyRange(64ul * PAGE_SIZE_NAND_FLASH, 2048,
+        TestPattern(PatternKind::kAllOnes), sink);
+  });
+  measure("verifyRange(page 64) again", [&] {
+    secondMismatches = nand.verifyRange(64ul * PAGE_SIZE_NAND_FLASH, 2048,
+        TestPattern(PatternKind::kAllOnes), sink);
+  });
+  printResult("same mismatches from the buffer",
+      firstMismatches > 0 && firstMismatches == secondMismatches);
+  // Only the block erased above and the page written above are not at the
+  // erased value, 0xFF.
+  runScrub("NAND Flash", nand, geometry.arrayBytes(), geometry.pageBytes(),
+      TestPattern(PatternKind::kAllOnes));
+  printf("  program executes beyond 4 per page: %lu, instructions while busy: %lu\n",
+      (unsigned long)chip.partialProgramViolations(),
+      (unsigned long)chip.instructionsWhileBusy());
+
+  // The same pass over the data areas only, with a continuous read per
+  // step of 4 pages instead of a page load and a READ per page. The page
+  // written above differs from 0xFF in 2040 of its 2048 data bytes.
+  NandFlashDataArea dataArea(nand);
+  runScrub("NAND Flash data area, continuous read", dataArea,
+      dataArea.capacity(), 4ul * geometry.dataBytes, TestPattern(PatternKind::kAllOnes));
+  printf("  SPI clock bound of the data area: %.0f ms at %lu Hz\n",
+      dataArea.capacity() * 8.0 / simBus.clockHz() * 1000.0,
+      (unsigned long)simBus.clockHz());
+  Crc32Sink crc;
+  MemoryOperationStatus status = MemoryOperationStatus::kError;
+  measure("readContinuous(64 pages)", [&] { status = nand.readContinuous(64, 64, crc); });
+  Crc32Sink expectedCrc;
+  for (uint32_t page = 64; page < 128; ++page) {
+    uint8_t data[2048];
+    for (uint16_t column = 0; column < 2048; ++column) {
+      data[column] = chip.peek(page, column);
+    }
+    for (uint16_t column = 0; column < 2048; column += 128) {
+      expectedCrc.write(0, &data[column], 128);
+    }
+  }
+  printResult("CRC-32 of block 1", status == MemoryOperationStatus::kDone
+      && crc.bytes() == 64ul * 2048 && crc.crc() == expectedCrc.crc());
+
+  // The chip's ECC as upset detector: every page is loaded and only those
+  // ECC could not correct are compared, so the page written above, clean
+  // for ECC, is not reported this time. Page 3001 has two flips in the
+  // same sector, more than the model corrects. The last loop() call of the
+  // pass goes on into the next one, hence more than 65536 pages.
+  NandEccHistogram histogram;
+  nand.setEccHistogram(&histogram);
+  chip.injectBitFlip(3000, 10, 2);
+  chip.injectBitFlip(3001, 10, 2);
+  chip.injectBitFlip(3001, 20, 5);
+  chip.injectBitFlip(40000, 600, 0);
+  NandFlashEccScrub eccScrub(nand);
+  runScrub("NAND Flash, ECC only", eccScrub, eccScrub.capacity(),
+      geometry.pageBytes(), TestPattern(PatternKind::kAllOnes));
+  printf("  ECC: %lu pages, %lu corrected, %lu uncorrectable, %u blocks affected\n",
+      (unsigned long)histogram.pages(), (unsigned long)histogram.totalCorrected(),
+      (unsigned long)histogram.totalUncorrectable(), histogram.affectedBlocks());
+  printResult("ECC histogram", histogram.totalCorrected() == 2
+      && histogram.totalUncorrectable() == 1 && histogram.corrected(3000 / 64) == 1 && histogram.uncorrectable(3001 / 64) == 1
+      && histogram.corrected(40000 / 64) == 1 && histogram.affectedBlocks() == 2);
+  nand.setEccHistogram(nullptr);
+  // Past kFollowedBlocks blocks only the totals and affectedBlocks() count.
+  for (uint16_t block = 100; block < 100 + NandEccHistogram::kFollowedBlocks + 8; ++block) {
+    histogram.record(block, 1);
+  }
+  histogram.record(100, 2);
+  printResult("ECC histogram full", histogram.affectedBlocks() == 2 + 40
+      && histogram.followedBlocks() == NandEccHistogram::kFollowedBlocks
+      && histogram.uncorrectable(100) == 1 && histogram.corrected(100 + 29) == 1
+      && histogram.corrected(100 + 30) == 0 && histogram.totalCorrected() == 2 + 40);
+  // Only the reads of the scan, every pass above skipped the bad blocks.
+  printResult("bad blocks left alone", chip.badBlockOperations() == 2);
+
+  // The same flips in raw mode, where ECC hides none of them. The pages
+  // are erased, so their spare bytes are at 0xFF as the pattern expects.
+  nand.disableEcc();
+  MismatchSink positions;
+  uint16_t rawFlips = 0;
+  measure("countPageFlips()", [&] {
+    rawFlips = nand.countPageFlips(3001, TestPattern(PatternKind::kAllOnes), &positions);
+  });
+  printResult("raw flips of page 3001", rawFlips == 2 && positions.stored() == 2
+      && positions.at(0).address == 3001ul * PAGE_SIZE_NAND_FLASH + 10
+      && positions.at(0).xorMask == 0x04);
+  // A raw dump as it would be sent down, processed on the host.
+  static uint8_t dump[4 * PAGE_SIZE_NAND_FLASH];
+  for (uint32_t i = 0; i < 4; ++i) {
+    nand.readPage(2999 + i, dump + i * PAGE_SIZE_NAND_FLASH);
+  }
+  nand.enableEcc();
+  uint32_t flipsPerPage[4];
+  const uint64_t dumpFlips = countDumpFlips(dump, PAGE_SIZE_NAND_FLASH, 4,
+      2999ul * PAGE_SIZE_NAND_FLASH, TestPattern(PatternKind::kAllOnes), flipsPerPage);
+  printResult("raw dump flips per page", dumpFlips == 3 && flipsPerPage[0] == 0
+      && flipsPerPage[1] == 1 && flipsPerPage[2] == 2 && flipsPerPage[3] == 0);
+
+  // An event log of 16 byte records appended to block 10 with partial
+  // programs, 4 records per page, the most the chip allows.
+  NandProgramTracker tracker;
+  nand.setProgramTracker(&tracker);
+  nand.startErase(640);
+  nand.waitUntilReady();
+  const uint32_t violationsBefore = chip.partialProgramViolations();
+  uint8_t record[16];
+  for (uint8_t i = 0; i < 8; ++i) {
+    memset(record, i, sizeof(record));
+    const uint32_t recordPage = 640 + i / 4;
+    const uint16_t recordColumn = (i % 4) * sizeof(record);
+    if (i == 0) {
+      measure("startProgramPartial(16 bytes)", [&] {
+        nand.startProgramPartial(recordPage, recordColumn, record, sizeof(record));
+      });
+    } else {
+      nand.startProgramPartial(recordPage, recordColumn, record, sizeof(record));
+    }
+    nand.waitUntilReady();
+  }
+  printf("  a 5th program of page 641 and one of page 640 after 641:\n");
+  const bool refused =
+      nand.startProgramPartial(641, 64, record, sizeof(record)) == MemoryOperationStatus::kError
+      && nand.startProgramPartial(640, 64, record, sizeof(record)) == MemoryOperationStatus::kError;
+  bool logged = true;
+  for (uint8_t i = 0; i < 8; ++i) {
+    logged = logged && chip.peek(640 + i / 4, (i % 4) * 16 + 15) == i;
+  }
+  printResult("8 records in 2 pages, no more than 4 programs per page", refused
+      && logged && chip.peek(640, 64) == 0xFF && tracker.programs(10, 1) == 4
+      && chip.partialProgramViolations() == violationsBefore);
+  nand.setProgramTracker(nullptr);
+
+  // Block 3 rewritten with a pattern, first with an erase, a wait and a
+  // writeStream(), then with rewriteBlock().
+  const TestPattern blockPattern(PatternKind::kAddressInData);
+  const uint32_t kBlockAddress = 192ul * PAGE_SIZE_NAND_FLASH;
+  const uint32_t kBlockBytes = 64ul * PAGE_SIZE_NAND_FLASH;
+  PatternSource blockSource(blockPattern, kBlockAddress);
+  measure("erase, writeStream() of a block", [&] {
+    nand.eraseBlock(192);
+    nand.waitUntilReady();
+    nand.writeStream(kBlockAddress, kBlockBytes, blockSource);
+  });
+  NandBlockReport report;
+  MemoryOperationStatus rewriteStatus = MemoryOperationStatus::kError;
+  measure("rewriteBlock()", [&] { rewriteStatus = nand.rewriteBlock(3, blockSource, report); });
+  printf("  erase %lu us, 64 programs %lu us, slowest page %lu us, %u failed pages\n",
+      (unsigned long)report.eraseMicros, (unsigned long)report.programMicros,
+      (unsigned long)report.slowestPageMicros, report.failedPages);
+  MismatchSink blockSink;
+  printResult("block rewritten", rewriteStatus == MemoryOperationStatus::kDone
+      && nand.verifyRange(kBlockAddress, kBlockBytes, blockPattern, blockSink) == 0);
+
+  // From the middle of a page of block 2, across 34 pages.
+  nand.eraseBlock(128);
+  nand.waitUntilReady();
+  runStream(nand, 128ul * PAGE_SIZE_NAND_FLASH + 100);
+
+  // The whole array filled with a pattern, checkpointed in the internal
+  // EEPROM every 16 blocks, after the bad block table. A reset after 100
+  // blocks is simulated by loading the checkpoint into a new progress,
+  // which goes on from block 96 and rewrites the 4 blocks after it.
+  const TestPattern fillPattern(PatternKind::kPseudoRandom, 3);
+  const uint16_t kFillEepromAddress = NandBadBlockTable::kStoredBytes;
+  NandFillProgress progress;
+  const uint64_t fillStart = simBus.nowNanos();
+  measure("fill(), first 100 blocks", [&] {
+    for (uint16_t blocks = 0; blocks < 96; blocks += 16) {
+      nand.fill(fillPattern, progress, 16);
+      progress.save(kFillEepromAddress);
+    }
+    nand.fill(fillPattern, progress, 4);
+  });
+  NandFillProgress resumed;
+  const bool checkpointLoaded = resumed.load(kFillEepromAddress);
+  const uint16_t resumedFrom = resumed.nextBlock();
+  measure("fill(), from the checkpoint", [&] {
+    while (nand.fill(fillPattern, resumed, 16) == MemoryOperationStatus::kPending) {
+      resumed.save(kFillEepromAddress);
+    }
+    resumed.save(kFillEepromAddress);
+  });
+  const double fillSeconds = (simBus.nowNanos() - fillStart) / 1e9;
+  const double fillMegabytes = (double)geometry.arrayBytes() / 1e6;
+  printf("  filled %.1f MB in %.1f s, %.2f MB/s, slowest erase %lu us, slowest program %lu us\n",
+      fillMegabytes, fillSeconds, fillMegabytes / fillSeconds,
+      (unsigned long)resumed.slowestEraseMicros(),
+      (unsigned long)resumed.slowestPageMicros());
+  MismatchSink fillSink;
+  printResult("array filled, resumed from block 96", checkpointLoaded
+      && resumedFrom == 96 && resumed.nextBlock() == geometry.blocks
+      && resumed.failedBlocks() == 0 && chip.peek(65535, 2111)
+          == fillPattern.expectedByte(65535ul * 2112 + 2111)
+      && nand.verifyEcc(0, geometry.arrayBytes(), fillPattern, fillSink) == 0);
+}
+
+/**
+ * A block of the NAND Flash verified, and a page already in the buffer read,
+ * with each read instruction of the buffer over each bus: the SPI of the
+ * Nano, a bit banged port (see spi_lanes.h) and the QSPI of a faster MCU.
+ */
+void runNandReadLanes() {
+  printf("\n## NAND Flash buffer reads, 1, 2 and 4 lanes\n");
+  SimNandFlash chip(CHIP_SELECT_NAND_FLASH);
+  MemoryNANDFlash nand;
+  nand.disableBlockProtection();
+  const TestPattern pattern(PatternKind::kPseudoRandom, 11);
+  const uint32_t kBlockBytes = 64ul * PAGE_SIZE_NAND_FLASH;
+  PatternSource source(pattern, 0);
+  NandBlockReport report;
+  nand.rewriteBlock(0, source, report);
+
+  SpiLaneBus spiBus(SPI, SPISettings(SPI_TRANSFER_SPEED_NAND_FLASH, MSBFIRST, SPI_MODE0));
+  PortLaneBus<7> portBus;
+  portBus.begin();
+  QspiLaneBus qspiBus(50000000);
+  struct {
+    const char* label;
+    LaneBus* bus;
+    NandReadMode mode;
+  } const kConfigs[] = {
+    {"SPI READ", nullptr, NandReadMode::kFast},
+    {"SPI FAST READ", &spiBus, NandReadMode::kFast},
+    {"port x1 FAST READ", &portBus, NandReadMode::kFast},
+    {"port x2 dual output", &portBus, NandReadMode::kDualOutput},
+    {"port x4 quad output", &portBus, NandReadMode::kQuadOutput},
+    {"port x4 quad I/O", &portBus, NandReadMode::kQuadIo},
+    {"QSPI 50 MHz x1", &qspiBus, NandReadMode::kFast},
+    {"QSPI 50 MHz x2 dual I/O", &qspiBus, NandReadMode::kDualIo},
+    {"QSPI 50 MHz x4 quad I/O", &qspiBus, NandReadMode::kQuadIo},
+  };
+  bool matched = !nand.setReadBus(&spiBus, NandReadMode::kQuadIo);
+  printf("  %-24s %12s %9s %12s %9s\n", "", "block (ms)", "MB/s", "page (us)", "MB/s");
+  static uint8_t page[PAGE_SIZE_NAND_FLASH];
+  for (const auto& config : kConfigs) {
+    matched = nand.setReadBus(config.bus, config.mode) && matched;
+    nand.invalidateBuffer();
+    MismatchSink sink;
+    uint64_t start = simBus.nowNanos();
+    matched = nand.verifyRange(0, kBlockBytes, pattern, sink) == 0 && matched;
+    const uint64_t blockNanos = simBus.nowNanos() - start;
+    start = simBus.nowNanos();
+    nand.readBuffer(page, 0, PAGE_SIZE_NAND_FLASH);
+    const uint64_t pageNanos = simBus.nowNanos() - start;
+    for (uint16_t i = 0; i < PAGE_SIZE_NAND_FLASH; ++i) {
+      matched = matched && page[i] == pattern.expectedByte(63ul * PAGE_SIZE_NAND_FLASH + i);
+    }
+    printf("  %-24s %12.2f %9.3f %12.1f %9.3f\n", config.label, blockNanos / 1e6,
+        kBlockBytes * 1e3 / blockNanos, pageNanos / 1e3,
+        PAGE_SIZE_NAND_FLASH * 1e3 / pageNanos);
+  }
+  nand.setReadBus(nullptr);
+  printResult("every mode read the block, quad refused on SPI", matched);
+}
+
+/**
+ * Both dies of the NOR Flash: IDs and dummy clocks, programs and erases
+ * across the boundary between the dies, a bit flip found and rewritten, a
+ * failing erase, and a scrub of the whole 128 MByte.
+ */
+void runNorFlash() {
+  printf("\n## NOR Flash MT25TL01G (requested %lu Hz)\n",
+      (unsigned long)SPI_TRANSFER_SPEED_NOR_FLASH);
+  SimNorFlash chip(CHIP_SELECT_NOR_FLASH, HOLD_NOR_FLASH_DIE_1, HOLD_NOR_FLASH_DIE_2);
+  chip.die(1).failSector(1000);
+  MemoryNORFlash nor;
+  nor.begin();
+  printSimCountersHeader();
+  uint32_t ids[2] = {0, 0};
+  measure("readJedecId() of both dies", [&] {
+    ids[0] = nor.readJedecId(0);
+    ids[1] = nor.readJedecId(1);
+  });
+  const bool oddCyclesRefused = !nor.setDummyCycles(10);
+  bool dummySet = false;
+  measure("setDummyCycles(8)", [&] { dummySet = nor.setDummyCycles(8); });
+  printResult("IDs of both dies, 8 dummy clocks, 10 refused over SPI",
+      ids[0] == 0x20BA20 && ids[1] == 0x20BA20 && dummySet && oddCyclesRefused
+      && (nor.readVolatileConfiguration(0) >> 4) == 8
+      && (nor.readVolatileConfiguration(1) >> 4) == 8);
+
+  // The last sector of the first die and the first sector of the second.
+  const TestPattern pattern(PatternKind::kAddressInData);
+  const uint32_t kBoundary = MemoryNORFlash::kDieBytes;
+  const uint32_t kFirst = kBoundary - MemoryNORFlash::kSectorBytes;
+  const uint32_t kBytes = 2 * MemoryNORFlash::kSectorBytes;
+  bool erased = true;
+  measure("startErase() of 2 sectors", [&] {
+    for (uint32_t address = kFirst; address < kFirst + kBytes;
+         address += MemoryNORFlash::kSectorBytes) {
+      erased = nor.startErase(NorEraseSize::kSector, address) == MemoryOperationStatus::kPending && erased;
+      while (nor.poll() == MemoryOperationStatus::kPending) {
+      }
+    }
+  });
+  PatternSource source(pattern, kFirst);
+  MemoryOperationStatus written = MemoryOperationStatus::kError;
+  measure("writeStream() of 2 sectors", [&] { written = nor.writeStream(kFirst, kBytes, source); });
+  MismatchSink sink;
+  uint32_t mismatches = 1;
+  measure("verifyRange() of 2 sectors", [&] { mismatches = nor.verifyRange(kFirst, kBytes, pattern, sink); });
+  printResult("2 sectors across the dies written", erased
+      && written == MemoryOperationStatus::kDone && mismatches == 0
+      && chip.peek(kBoundary) == pattern.expectedByte(kBoundary)
+      && chip.die(1).subsectorErases(0) == 1 && chip.instructionsWhileBusy() == 0);
+
+  // A flipped bit is found and only its 4 KByte subsector is erased and
+  // programmed again.
+  const uint32_t kSubsector = kBoundary + 4096;
+  chip.injectBitFlip(kSubsector + 100, 3);
+  MismatchSink flipSink;
+  const uint32_t found = nor.verifyRange(kFirst, kBytes, pattern, flipSink);
+  PatternSource subsectorSource(pattern, kSubsector);
+  measure("4 KByte subsector erased and written", [&] {
+    nor.startErase(NorEraseSize::kSubsector4KB, kSubsector);
+    while (nor.poll() == MemoryOperationStatus::kPending) {
+    }
+    nor.writeStream(kSubsector, 4096, subsectorSource);
+  });
+  MismatchSink repairedSink;
+  printResult("flipped bit found and rewritten", found == 1
+      && flipSink.at(0).address == kSubsector + 100 && flipSink.at(0).xorMask == 0x08
+      && nor.verifyRange(kFirst, kBytes, pattern, repairedSink) == 0
+      && chip.die(1).subsectorErases(4096) == 2 && chip.die(1).subsectorErases(0) == 1);
+
+  // Misaligned erases and programs past a page are refused, an erase of a
+  // worn out sector ends in kError and its flag is cleared.
+  const uint8_t twoBytes[2] = {0x00, 0x00};
+  const bool refused =
+      nor.startErase(NorEraseSize::kSubsector32KB, kBoundary + 4096) == MemoryOperationStatus::kError
+      && nor.startWrite(twoBytes, 2, 255) == MemoryOperationStatus::kError;
+  MemoryOperationStatus failed = MemoryOperationStatus::kDone;
+  nor.startErase(NorEraseSize::kSector, kBoundary + 1000ul * MemoryNORFlash::kSectorBytes);
+  while ((failed = nor.poll()) == MemoryOperationStatus::kPending) {
+  }
+  // Failed again and not polled: the next start of the die reports it.
+  const uint32_t kGoodSector = kBoundary + 1001ul * MemoryNORFlash::kSectorBytes;
+  nor.startErase(NorEraseSize::kSector, kBoundary + 1000ul * MemoryNORFlash::kSectorBytes);
+  delay(1000);
+  const bool unpolledReported =
+      nor.startErase(NorEraseSize::kSector, kGoodSector) == MemoryOperationStatus::kError
+      && nor.startErase(NorEraseSize::kSector, kGoodSector) == MemoryOperationStatus::kPending;
+  while (nor.poll() == MemoryOperationStatus::kPending) {
+  }
+  printResult("invalid ranges refused, failing erase reported", refused
+      && failed == MemoryOperationStatus::kError && unpolledReported
+      && (nor.readFlagStatusRegister(1) & 0x30) == 0);
+
+  // From 30000 bytes before the second die, erased again.
+  for (uint32_t address = kFirst; address < kFirst + kBytes;
+       address += MemoryNORFlash::kSectorBytes) {
+    nor.startErase(NorEraseSize::kSector, address);
+    while (nor.poll() == MemoryOperationStatus::kPending) {
+    }
+  }
+  runStream(nor, kBoundary - 30000);
+
+  for (uint32_t address = 0; address < MemoryNORFlash::kCapacity; ++address) {
+    chip.poke(address, pattern.expectedByte(address));
+  }
+  runScrub("NOR Flash", nor, MemoryNORFlash::kCapacity, 4096, pattern);
+}
+
+/**
+ * Upsets in 4 places of the NOR Flash, rewritten with the erases of a
+ * NorErasePlanner and then again with a 4 KByte erase per dirty subsector,
+ * the smallest erase there is. Both rewrite the same 60 subsectors.
+ */
+void runNorErasePlanner() {
+  printf("\n## NOR Flash erase planner\n");
+  SimNorFlash chip(CHIP_SELECT_NOR_FLASH, HOLD_NOR_FLASH_DIE_1, HOLD_NOR_FLASH_DIE_2);
+  MemoryNORFlash nor;
+  nor.begin();
+  const TestPattern pattern(PatternKind::kAddressInData);
+  const uint32_t kSector = MemoryNORFlash::kSectorBytes;
+  const uint32_t kSubsector = NorErasePlanner::kSubsectorBytes;
+  // A flip in sector 10, 3 subsectors of the first half of sector 20, 200000
+  // bytes from sector 48 on and 3 subsectors in each half of sector 1500,
+  // in the second die.
+  const uint32_t kFlips[] = {
+      10 * kSector + 5000,
+      20 * kSector + 100, 20 * kSector + 2 * kSubsector, 20 * kSector + 5 * kSubsector + 7,
+      1500 * kSector + kSubsector, 1500 * kSector + 3 * kSubsector, 1500 * kSector + 6 * kSubsector,
+      1500 * kSector + 9 * kSubsector, 1500 * kSector + 12 * kSubsector, 1500 * kSector + 15 * kSubsector};
+  const uint32_t kRunFirst = 48 * kSector + 1000;
+  const uint32_t kRunBytes = 200000;
+  const uint16_t kSectors[] = {10, 20, 48, 49, 50, 51, 1500};
+  auto corrupt = [&] {
+    for (uint16_t sector : kSectors) {
+      for (uint32_t address = sector * kSector; address < (sector + 1) * kSector; ++address) {
+        chip.poke(address, pattern.expectedByte(address));
+      }
+    }
+    for (uint32_t address : kFlips) {
+      chip.injectBitFlip(address, 2);
+    }
+    for (uint32_t address = kRunFirst; address < kRunFirst + kRunBytes; ++address) {
+      chip.poke(address, 0x00);
+    }
+  };
+  auto verify = [&] {
+    uint32_t mismatches = 0;
+    for (uint16_t sector : kSectors) {
+      MismatchSink sink;
+      mismatches += nor.verifyRange(sector * kSector, kSector, pattern, sink);
+    }
+    return mismatches;
+  };
+
+  NorErasePlanner planner;
+  for (uint32_t address : kFlips) {
+    planner.addRange(address, 1);
+  }
+  planner.addRange(kRunFirst, kRunBytes);
+  const NorEraseCommand kExpected[] = {
+      {NorEraseSize::kSubsector4KB, 10 * kSector + kSubsector},
+      {NorEraseSize::kSubsector32KB, 20 * kSector},
+      {NorEraseSize::kSector, 48 * kSector},
+      {NorEraseSize::kSector, 49 * kSector},
+      {NorEraseSize::kSector, 50 * kSector},
+      {NorEraseSize::kSubsector4KB, 51 * kSector},
+      {NorEraseSize::kSubsector4KB, 51 * kSector + kSubsector},
+      {NorEraseSize::kSector, 1500 * kSector}};
+  NorEraseCommand command;
+  uint8_t planned = 0;
+  bool asExpected = true;
+  while (planner.next(command)) {
+    asExpected = asExpected && planned < 8 && command.size == kExpected[planned].size
+        && command.address == kExpected[planned].address;
+    ++planned;
+  }
+  printf("  planned: %u erases, %lu subsectors, %.1f ms expected\n", planned,
+      (unsigned long)(planner.plannedBytes() / kSubsector), planner.plannedMicros() / 1e3);
+  printResult("4 KByte, 32 KByte and sector erases mixed", asExpected && planned == 8);
+
+  // Executed, counting erases. Sector 51 takes two erases but one cycle.
+  corrupt();
+  NorEraseCounts counts;
+  nor.setEraseCounts(&counts);
+  planner.clear();
+  for (uint32_t address : kFlips) {
+    planner.addRange(address, 1);
+  }
+  planner.addRange(kRunFirst, kRunBytes);
+  MemoryOperationStatus rewritten = MemoryOperationStatus::kError;
+  uint64_t startNanos = simBus.nowNanos();
+  measure("rewrite() of the plan", [&] { rewritten = nor.rewrite(planner, pattern); });
+  const uint64_t plannedNanos = simBus.nowNanos() - startNanos;
+  printResult("planned rewrite read back, cycles counted",
+      rewritten == MemoryOperationStatus::kDone && verify() == 0
+      && counts.erases(10) == 1 && counts.erases(51) == 1 && counts.erases(1500) == 1
+      && counts.erases(11) == 0 && chip.die(0).subsectorErases(10 * kSector) == 0
+      && chip.die(0).subsectorErases(51 * kSector + kSubsector) == 1);
+  nor.setEraseCounts(nullptr);
+
+  // The same subsectors, a 4 KByte erase each.
+  corrupt();
+  uint16_t subsectorErases = 0;
+  startNanos = simBus.nowNanos();
+  measure("4 KByte erase per dirty subsector", [&] {
+    for (uint16_t sector : kSectors) {
+      for (uint32_t address = sector * kSector; address < (sector + 1) * kSector;
+           address += kSubsector) {
+        bool dirty = address + kSubsector > kRunFirst && address < kRunFirst + kRunBytes;
+        for (uint32_t flip : kFlips) {
+          dirty = dirty || flip / kSubsector == address / kSubsector;
+        }
+        if (!dirty) {
+          continue;
+        }
+        nor.startErase(NorEraseSize::kSubsector4KB, address);
+        while (nor.poll() == MemoryOperationStatus::kPending) {
+        }
+        PatternSource source(pattern, address);
+        nor.writeStream(address, kSubsector, source);
+        ++subsectorErases;
+      }
+    }
+  });
+  const uint64_t subsectorNanos = simBus.nowNanos() - startNanos;
+  printf("  planned: %.1f ms; 4 KByte only: %u erases, %.1f ms\n", plannedNanos / 1e6,
+      subsectorErases, subsectorNanos / 1e6);
+  printResult("planned rewrite faster", verify() == 0 && subsectorErases == 60
+      && plannedNanos < subsectorNanos);
+
+  // A die erase pays with the first sector of the second die clean, not
+  // with 100 subsectors.
+  NorErasePlanner diePlanner;
+  diePlanner.addRange(MemoryNORFlash::kDieBytes + kSector,
+      MemoryNORFlash::kDieBytes - kSector);
+  const bool dieErase = diePlanner.next(command) && command.size == NorEraseSize::kDie
+      && command.address == MemoryNORFlash::kDieBytes && !diePlanner.next(command);
+  diePlanner.clear();
+  diePlanner.addRange(MemoryNORFlash::kDieBytes + 100 * kSubsector,
+      MemoryNORFlash::kDieBytes - 100 * kSubsector);
+  const bool sectorErases = diePlanner.next(command) && command.size == NorEraseSize::kSector
+      && command.address == MemoryNORFlash::kDieBytes + 6 * kSector;
+  // Past kMaxRanges the nearest ranges merge.
+  diePlanner.clear();
+  for (uint32_t i = 0; i < 20; ++i) {
+    diePlanner.addRange(i * 10 * kSector, 1);
+  }
+  printResult("die erase weighed, ranges merged past 16",
+      dieErase && sectorErases && diePlanner.ranges() == NorErasePlanner::kMaxRanges);
+
+  // 20 sectors for 16 entries: the counts make room without ever falling
+  // below the real ones, and go through the internal EEPROM.
+  NorEraseCounts wear;
+  wear.recordDieErase(0);
+  for (uint16_t sector = 0; sector < 20; ++sector) {
+    for (uint16_t i = 0; i <= sector; ++i) {
+      wear.recordSectorErase(100 + sector);
+    }
+  }
+  bool upperBound = wear.erases(2000) == 0;
+  for (uint16_t sector = 0; sector < 20; ++sector) {
+    upperBound = upperBound && wear.erases(100 + sector) >= 1u + sector + 1;
+  }
+  wear.save(0);
+  NorEraseCounts stored;
+  printResult("erase counts kept past 16 sectors and stored", upperBound
+      && wear.mostErasedSector() == 119 && stored.load(0)
+      && stored.erases(119) == wear.erases(119) && stored.erases(5) == wear.erases(5)
+      && !stored.isWornOut(119));
+}
+
+/**
+ * Read-verify-rewrite of 16 sectors of each NOR Flash die, from pattern A
+ * to pattern B: first one die after the other, waiting for every erase,
+ * then with a NorRefresh, which works on one die while the other erases.
+ */
+void runNorRefresh() {
+  printf("\n## NOR Flash read-verify-rewrite, one die at a time and both at once\n");
+  SimNorFlash chip(CHIP_SELECT_NOR_FLASH, HOLD_NOR_FLASH_DIE_1, HOLD_NOR_FLASH_DIE_2);
+  MemoryNORFlash nor;
+  nor.begin();
+  const TestPattern before(PatternKind::kAddressInData);
+  const TestPattern after(PatternKind::kPseudoRandom, 11);
+  const uint16_t kFirstSector = 1000;
+  const uint16_t kSectors = 16;
+  const uint32_t kSector = MemoryNORFlash::kSectorBytes;
+  auto prepare = [&] {
+    for (uint8_t die = 0; die < 2; ++die) {
+      const uint32_t first = die * MemoryNORFlash::kDieBytes + kFirstSector * kSector;
+      for (uint32_t address = first; address < first + kSectors * kSector; ++address) {
+        chip.poke(address, before.expectedByte(address));
+      }
+    }
+    chip.injectBitFlip(kFirstSector * kSector + 12345, 0);
+    chip.injectBitFlip(MemoryNORFlash::kDieBytes + (kFirstSector + 15) * kSector + 7, 6);
+  };
+  auto verifyAfter = [&] {
+    uint32_t mismatches = 0;
+    for (uint8_t die = 0; die < 2; ++die) {
+      MismatchSink sink;
+      mismatches += nor.verifyRange(die * MemoryNORFlash::kDieBytes + kFirstSector * kSector,
+          kSectors * kSector, after, sink);
+    }
+    return mismatches;
+  };
+  const double megabytes = 2.0 * kSectors * kSector / 1e6;
+
+  prepare();
+  uint32_t serialMismatches = 0;
+  uint64_t startNanos = simBus.nowNanos();
+  for (uint8_t die = 0; die < 2; ++die) {
+    for (uint16_t sector = kFirstSector; sector < kFirstSector + kSectors; ++sector) {
+      const uint32_t address = die * MemoryNORFlash::kDieBytes + sector * kSector;
+      MismatchSink sink;
+      serialMismatches += nor.verifyRange(address, kSector, before, sink);
+      nor.startErase(NorEraseSize::kSector, address);
+      while (nor.poll() == MemoryOperationStatus::kPending) {
+      }
+      PatternSource source(after, address);
+      nor.writeStream(address, kSector, source);
+    }
+  }
+  const uint64_t serialNanos = simBus.nowNanos() - startNanos;
+  const bool serialDone = serialMismatches == 2 && verifyAfter() == 0;
+
+  prepare();
+  NorRefresh refresh(nor, kFirstSector, kSectors);
+  refresh.begin(&before, after);
+  uint32_t runs = 0;
+  startNanos = simBus.nowNanos();
+  while (!refresh.run(50000)) {
+    ++runs;
+  }
+  const uint64_t refreshNanos = simBus.nowNanos() - startNanos;
+  printf("  one die at a time: %.1f ms, %.2f MB/s\n", serialNanos / 1e6,
+      megabytes * 1e9 / serialNanos);
+  printf("  both dies at once: %.1f ms, %.2f MB/s, %lu run() calls, %.2fx\n",
+      refreshNanos / 1e6, megabytes * 1e9 / refreshNanos, (unsigned long)runs + 1,
+      (double)serialNanos / refreshNanos);
+  printResult("both rewrites read back, flips found", serialDone
+      && refresh.mismatches() == 2 && refresh.sink().at(0).address == kFirstSector * kSector + 12345
+      && refresh.failedSectors() == 0 && verifyAfter() == 0
+      && chip.instructionsWhileBusy() == 0 && refreshNanos < serialNanos);
+
+  // Without a pattern to verify against, as the fill of a boot.
+  NorRefresh fill(nor, kFirstSector, kSectors);
+  fill.begin(nullptr, before);
+  startNanos = simBus.nowNanos();
+  while (!fill.run(50000)) {
+  }
+  const uint64_t fillNanos = simBus.nowNanos() - startNanos;
+  MismatchSink fillSink;
+  printf("  fill of both dies: %.1f ms, %.2f MB/s\n", fillNanos / 1e6,
+      megabytes * 1e9 / fillNanos);
+  printResult("fill read back", fill.mismatches() == 0 && fill.failedSectors() == 0
+      && nor.verifyRange(MemoryNORFlash::kDieBytes + kFirstSector * kSector, kSectors * kSector,
+          before, fillSink) == 0);
+}
+
+/**
+ * The whole NOR Flash scrubbed 4 KByte per step, as nor_main does, without
+ * and then with a read session, and then 4 MByte of it with 256 byte
+ * steps, where the instruction of every step weighs more.
+ */
+void runNorReadSession() {
+  printf("\n## NOR Flash read session (XIP and continuous reads)\n");
+  SimNorFlash chip(CHIP_SELECT_NOR_FLASH, HOLD_NOR_FLASH_DIE_1, HOLD_NOR_FLASH_DIE_2);
+  MemoryNORFlash nor;
+  nor.begin();
+  const TestPattern pattern(PatternKind::kAddressInData);
+  for (uint32_t address = 0; address < MemoryNORFlash::kCapacity; ++address) {
+    chip.poke(address, pattern.expectedByte(address));
+  }
+  const uint32_t kFlip = MemoryNORFlash::kDieBytes + 5000;
+  chip.injectBitFlip(kFlip, 1);
+  const uint32_t kWindow = 4ul << 20;
+
+  runScrub("NOR Flash, no session", nor, MemoryNORFlash::kCapacity, 4096, pattern);
+  runScrub("NOR Flash 4 MByte 256 byte steps, no session", nor, kWindow, 256, pattern);
+  nor.beginReadSession();
+  runScrub("NOR Flash, read session", nor, MemoryNORFlash::kCapacity, 4096, pattern);
+  runScrub("NOR Flash 4 MByte 256 byte steps, read session", nor, kWindow, 256, pattern);
+  const bool inXip = chip.die(0).isInXip() && chip.die(1).isInXip();
+  // A jump to the flip, a read across the dies, a refused erase and
+  // refused register instructions.
+  MismatchSink sink;
+  const uint32_t found = nor.verifyRange(kFlip - 100, 200, pattern, sink);
+  uint8_t acrossDies[4] = {0, 0, 0, 0};
+  nor.readNBytes(MemoryNORFlash::kDieBytes - 2, acrossDies, 4);
+  const bool refused = nor.startErase(NorEraseSize::kSector, 0) == MemoryOperationStatus::kError
+      && !nor.isBusy() && nor.readJedecId(0) == 0 && !nor.setDummyCycles(8);
+  nor.beginReadSession(); // already in one
+  nor.endReadSession();
+  printResult("session reads in XIP, dies out of it afterwards", inXip && found == 1
+      && sink.at(0).address == kFlip && acrossDies[1] == pattern.expectedByte(MemoryNORFlash::kDieBytes - 1)
+      && acrossDies[2] == pattern.expectedByte(MemoryNORFlash::kDieBytes) && refused
+      && !nor.isInReadSession() && !chip.die(0).isInXip() && !chip.die(1).isInXip()
+      && (nor.readVolatileConfiguration(0) & 0x08) != 0
+      && (nor.readVolatileConfiguration(1) & 0x08) != 0
+      && nor.readJedecId(1) == 0x20BA20 && nor.readByte(kFlip) != pattern.expectedByte(kFlip));
+}
+
+/**
+ * 1 MByte of the NOR Flash across the boundary between the dies verified,
+ * and a page read, with each transfer profile over each bus that can carry
+ * it: the SPI of the Nano, a bit banged port and the QSPI of a faster MCU,
+ * at 133 MHz and at the 90 MHz of DTR. The fastest one on the Nano is what
+ * nor_main would use.
+ */
+void runNorTransferProfiles() {
+  printf("\n## NOR Flash transfer profiles, STR x1, dual, quad and DTR quad\n");
+  SimNorFlash chip(CHIP_SELECT_NOR_FLASH, HOLD_NOR_FLASH_DIE_1, HOLD_NOR_FLASH_DIE_2);
+  MemoryNORFlash nor;
+  nor.begin();
+  const TestPattern pattern(PatternKind::kPseudoRandom, 25);
+  const uint32_t kWindowBytes = 1ul << 20;
+  const uint32_t kFirst = MemoryNORFlash::kDieBytes - kWindowBytes / 2;
+  for (uint32_t address = kFirst; address < kFirst + kWindowBytes; ++address) {
+    chip.poke(address, pattern.expectedByte(address));
+  }
+  const uint32_t kFlip = MemoryNORFlash::kDieBytes + 1000;
+  chip.injectBitFlip(kFlip, 6);
+
+  SpiLaneBus spiBus(SPI, SPISettings(SPI_TRANSFER_SPEED_NOR_FLASH, MSBFIRST, SPI_MODE0));
+  PortLaneBus<7> portBus;
+  portBus.begin();
+  QspiLaneBus qspiBus(MemoryNORFlash::maxClockHz(NorTransferProfile::kQuad));
+  QspiLaneBus qspiDtrBus(MemoryNORFlash::maxClockHz(NorTransferProfile::kDtrQuad));
+  struct {
+    const char* label;
+    LaneBus* bus;
+    NorTransferProfile profile;
+    bool onNano;
+  } const kConfigs[] = {
+    {"SPI STR x1", nullptr, NorTransferProfile::kStrX1, true},
+    {"port STR x1", &portBus, NorTransferProfile::kStrX1, true},
+    {"port x2 dual I/O", &portBus, NorTransferProfile::kDual, true},
+    {"port x4 quad I/O", &portBus, NorTransferProfile::kQuad, true},
+    {"QSPI 133 MHz STR x1", &qspiBus, NorTransferProfile::kStrX1, false},
+    {"QSPI 133 MHz x2 dual I/O", &qspiBus, NorTransferProfile::kDual, false},
+    {"QSPI 133 MHz x4 quad I/O", &qspiBus, NorTransferProfile::kQuad, false},
+    {"QSPI 90 MHz x4 DTR quad", &qspiDtrBus, NorTransferProfile::kDtrQuad, false},
+  };
+  bool matched = !nor.setTransferProfile(&spiBus, NorTransferProfile::kDual)
+      && !nor.setTransferProfile(&portBus, NorTransferProfile::kDtrQuad)
+      && !nor.setTransferProfile(nullptr, NorTransferProfile::kQuad);
+  printf("  %-26s %6s %11s %9s %11s %9s\n", "", "dummy", "1 MB (ms)", "MB/s", "page (us)", "MB/s");
+  const char* fastest = "";
+  uint64_t fastestNanos = 0;
+  uint8_t page[MemoryNORFlash::kPageBytes];
+  for (const auto& config : kConfigs) {
+    matched = nor.setTransferProfile(config.bus, config.profile) && matched;
+    const uint8_t dummy = nor.readVolatileConfiguration(1) >> 4;
+    matched = matched && dummy == nor.dummyCycles()
+        && nor.readVolatileConfiguration(0) >> 4 == dummy;
+    MismatchSink sink;
+    uint64_t start = simBus.nowNanos();
+    matched = nor.verifyRange(kFirst, kWindowBytes, pattern, sink) == 1
+        && sink.at(0).address == kFlip && matched;
+    const uint64_t windowNanos = simBus.nowNanos() - start;
+    start = simBus.nowNanos();
+    nor.readNBytes(kFirst, page, sizeof(page));
+    const uint64_t pageNanos = simBus.nowNanos() - start;
+    for (uint16_t i = 0; i < sizeof(page); ++i) {
+      matched = matched && page[i] == pattern.expectedByte(kFirst + i);
+    }
+    printf("  %-26s %6u %11.2f %9.3f %11.1f %9.3f\n", config.label, dummy,
+        windowNanos / 1e6, kWindowBytes * 1e3 / windowNanos, pageNanos / 1e3,
+        sizeof(page) * 1e3 / pageNanos);
+    if (config.onNano && (fastestNanos == 0 || windowNanos < fastestNanos)) {
+      fastest = config.label;
+      fastestNanos = windowNanos;
+    }
+  }
+  printf("  fastest on the Nano: %s\n", fastest);
+  // A read session keeps the profile of its reads, DTR included. Back on
+  // the first die, the second one has taken its read in XIP.
+  nor.beginReadSession();
+  MismatchSink sink;
+  matched = !nor.setTransferProfile(nullptr) && matched;
+  matched = nor.verifyRange(kFirst, kWindowBytes, pattern, sink) == 1
+      && nor.readByte(kFirst) == pattern.expectedByte(kFirst) && matched;
+  const bool inXip = chip.die(0).isInXip() && chip.die(1).isInXip();
+  nor.endReadSession();
+  matched = matched && nor.setTransferProfile(nullptr)
+      && nor.readVolatileConfiguration(0) >> 4 == MemoryNORFlash::kDefaultDummyCycles
+      && nor.readByte(kFirst) == pattern.expectedByte(kFirst);
+  printResult("every profile found the flip, wider profiles refused", matched && inXip
+      && !chip.die(0).isInXip() && !chip.die(1).isInXip());
+}
+
+/**
+ * The same work twice: writing 64 EEPROM pages and 2 NAND Flash blocks
+ * while the FRAM and the MRAM are scrubbed. First every operation blocks
+ * until its memory is ready, then a BusScheduler scrubs while the EEPROM
+ * and the NAND Flash are busy.
+ */
+void runBusScheduler() {
+  printf("\n## Bus scheduler, EEPROM + NAND Flash writes overlapped with FRAM/MRAM scrubs\n");
+  SimEeprom eepromChip(CHIP_SELECT_EEPROM);
+  SimSerialRam framChip(SimSerialRam::framConfig(), CHIP_SELECT_FRAM);
+  SimSerialRam mramChip(SimSerialRam::mramConfig(), CHIP_SELECT_MRAM);
+  SimNandFlash nandChip(CHIP_SELECT_NAND_FLASH);
+  MemoryEEPROM eeprom;
+  MemoryFRAM fram;
+  MemoryMRAM mram;
+  MemoryNANDFlash nand;
+  nand.disableBlockProtection();
+
+  const TestPattern pattern(PatternKind::kPseudoRandom, 7);
+  for (uint32_t address = 0; address < framChip.capacity(); ++address) {
+    framChip.poke(address, pattern.expectedByte(address));
+  }
+  for (uint32_t address = 0; address < mramChip.capacity(); ++address) {
+    mramChip.poke(address, pattern.expectedByte(address));
+  }
+  const uint32_t kEepromBytes = 64 * 256;
+  const uint32_t kNandPages = 128;
+  static uint8_t pageBuffer[PAGE_SIZE_NAND_FLASH];
+
+  // Scheduled, until both writes are done.
+  ScrubEngine<MemoryFRAM> framScrub(fram, framChip.capacity(), 1024, pattern);
+  ScrubEngine<MemoryMRAM> mramScrub(mram, mramChip.capacity(), 1024, pattern);
+  EepromWriteTask eepromTask(eeprom, pattern, 0, kEepromBytes);
+  NandWriteTask nandTask(nand, pattern, 0, kNandPages, pageBuffer);
+  ScrubTask<MemoryFRAM> framTask(framScrub, CHIP_SELECT_FRAM);
+  ScrubTask<MemoryMRAM> mramTask(mramScrub, CHIP_SELECT_MRAM);
+  BusScheduler scheduler;
+  scheduler.addTask(eepromTask);
+  scheduler.addTask(nandTask);
+  scheduler.addTask(framTask);
+  scheduler.addTask(mramTask);
+  scheduler.begin();
+  const SimCounters before = simBus.counters();
+  const uint64_t startNanos = simBus.nowNanos();
+  while (!eepromTask.isFinished() || !nandTask.isFinished()) {
+    scheduler.run(50000);
+  }
+  const uint64_t scheduledNanos = simBus.nowNanos() - startNanos;
+  const SimCounters scheduled = simBus.counters() - before;
+  const uint64_t scrubbedBytes = framScrub.bytesVerified() + mramScrub.bytesVerified();
+  const uint64_t movedBytes = kEepromBytes + kNandPages * PAGE_SIZE_NAND_FLASH + scrubbedBytes;
+
+  // Serialized, the same amount of bytes one operation after the other.
+  const uint64_t serialStartNanos = simBus.nowNanos();
+  Array<uint8_t, 256> page;
+  for (uint32_t address = 0; address < kEepromBytes; address += 256) {
+    pattern.fill(address, &page[0], 256);
+    eeprom.enableWrite();
+    eeprom.writePage(page, address);
+    eeprom.waitUntilReady();
+  }
+  for (uint32_t pageAddress = 0; pageAddress < kNandPages; ++pageAddress) {
+    if (pageAddress % 64 == 0) {
+      nand.enableWrite();
+      nand.eraseBlock(pageAddress);
+      nand.waitUntilReady();
+    }
+    pattern.fill(pageAddress * PAGE_SIZE_NAND_FLASH, pageBuffer, PAGE_SIZE_NAND_FLASH);
+    nand.enableWrite();
+    nand.writePage(pageBuffer, pageAddress);
+    nand.waitUntilReady();
+  }
+  ScrubEngine<MemoryFRAM> serialScrub(fram, framChip.capacity(), 1024, pattern);
+  while (serialScrub.bytesVerified() < scrubbedBytes) {
+    serialScrub.run(0);
+  }
+  const uint64_t serialNanos = simBus.nowNanos() - serialStartNanos;
+
+  printf("  bytes moved: %lu (%lu scrubbed)\n", (unsigned long)movedBytes,
+      (unsigned long)scrubbedBytes);
+  printf("  serialized: %.1f ms, %.0f B/s\n", serialNanos / 1e6,
+      movedBytes * 1e9 / serialNanos);
+  printf("  scheduled:  %.1f ms, %.0f B/s, bus in use %.0f %%, idle %.1f ms\n",
+      scheduledNanos / 1e6, movedBytes * 1e9 / scheduledNanos,
+      100.0 * scheduled.busNanos / scheduledNanos, scheduler.idleMicros() / 1e3);
+  printResult("scheduled writes read back",
+      eepromChip.peek(kEepromBytes - 1) == pattern.expectedByte(kEepromBytes - 1)
+      && nandChip.peek(kNandPages - 1, 100)
+          == pattern.expectedByte((kNandPages - 1) * PAGE_SIZE_NAND_FLASH + 100)
+      && nandTask.failures() == 0
+      && framScrub.sink().mismatches() == 0 && mramScrub.sink().mismatches() == 0);
+}
+
+} // namespace
+
+int main() {
+  ChipSelect<CHIP_SELECT_EEPROM>::begin();
+  ChipSelect<CHIP_SELECT_FRAM>::begin();
+  ChipSelect<CHIP_SELECT_MRAM>::begin();
+  ChipSelect<CHIP_SELECT_NAND_FLASH>::begin();
+  ChipSelect<CHIP_SELECT_NOR_FLASH>::begin();
+  SPI.begin();
+  hspi.begin();
+
+  runEeprom();
+  {
+    SimSerialRam chip(SimSerialRam::framConfig(), CHIP_SELECT_FRAM);
+    MemoryFRAM fram;
+    runSerialRam("FRAM CY15B108QN", fram, chip);
+  }
+  {
+    SimSerialRam chip(SimSerialRam::mramConfig(), CHIP_SELECT_MRAM);
+    MemoryMRAM mram;
+    runSerialRam("MRAM MR25H40", mram, chip);
+  }
+  runNandFlash();
+  runNandReadLanes();
+  runNorFlash();
+  runNorErasePlanner();
+  runNorRefresh();
+  runNorReadSession();
+  runNorTransferProfiles();
+  runBusScheduler();
+
+  printf("\nBus contentions: %lu\n", (unsigned long)simBus.contentions());
+  return 0;
+}
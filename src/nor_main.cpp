@@ -0,0 +1,105 @@
+/**
+ * @file nor_main.cpp
+ * @brief Writes a test pattern to both dies of the NOR Flash and then
+ *    scrubs it continuously, reporting every complete pass and writing
+ *    back the subsectors where mismatches were found.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ */
+
+#include <Arduino.h>
+#include <memory_nor_flash.h>
+#include <nor_erase_counts.h>
+#include <nor_erase_planner.h>
+#include <nor_refresh.h>
+#include <scrub_engine.h>
+#include <test_pattern.h>
+
+#include "SPI.h"
+
+// **** first update chip select and hold pins on the class ****
+
+const uint32_t kScrubStepBytes = 4096; // about 6 ms on the bus
+const uint32_t kScrubBudgetMicros = 50000; // per loop()
+const uint16_t kEraseCountsEepromAddress = 0;
+
+MemoryNORFlash nor;
+
+const TestPattern kPattern(PatternKind::kAddressInData);
+
+ScrubEngine<MemoryNORFlash> scrubber(nor, MemoryNORFlash::kCapacity,
+    kScrubStepBytes, kPattern);
+
+NorErasePlanner planner;
+NorEraseCounts eraseCounts;
+
+// "NOR Flash sector <n>: <erases> erase cycles" of the most erased one.
+void printMostErasedSector() {
+  const uint16_t sector = eraseCounts.mostErasedSector();
+  Serial.print(F("NOR Flash sector "));
+  Serial.print(sector);
+  Serial.print(F(": "));
+  Serial.print(eraseCounts.erases(sector));
+  Serial.println(eraseCounts.isWornOut(sector) ? F(" erase cycles, worn out") :
+      F(" erase cycles"));
+}
+
+// Every boot costs each sector one erase cycle out of its 100000, kept in
+// the internal EEPROM from one boot to the next. Sectors of one die are
+// erased while the other die is programmed, about 5 minutes in total.
+void setup() {
+  ChipSelect<CHIP_SELECT_NOR_FLASH>::begin();
+  nor.begin();
+  SPI.begin();
+  Serial.begin(9600);
+  delay(1); // tPU, the dies are accessible afterwards
+  Serial.print(F("NOR Flash IDs: "));
+  Serial.print(nor.readJedecId(0), HEX);
+  Serial.print(F(" "));
+  Serial.println(nor.readJedecId(1), HEX);
+  eraseCounts.load(kEraseCountsEepromAddress);
+  nor.setEraseCounts(&eraseCounts);
+  const uint32_t fillStart = millis();
+  NorRefresh fill(nor, 0, MemoryNORFlash::kDieBytes / MemoryNORFlash::kSectorBytes);
+  fill.begin(nullptr, kPattern);
+  while (!fill.run(kScrubBudgetMicros)) {
+  }
+  eraseCounts.recordDieErase(0); // every sector once
+  eraseCounts.recordDieErase(1);
+  eraseCounts.save(kEraseCountsEepromAddress);
+  Serial.print(F("NOR Flash filled in "));
+  Serial.print(millis() - fillStart);
+  Serial.println(fill.failedSectors() == 0 ? F(" ms") : F(" ms, with failed sectors"));
+  printMostErasedSector();
+  nor.beginReadSession();
+}
+
+// The scrub goes on in a read session, which is left for the rewrites. Only
+// the mismatches kept by the sink are written back, the rest are found
+// again on the next pass.
+void loop() {
+  if (!scrubber.run(kScrubBudgetMicros)) {
+    return;
+  }
+  printPassReport(F("NOR Flash"), scrubber);
+  MismatchSink& sink = scrubber.sink();
+  if (sink.stored() == 0) {
+    return;
+  }
+  planner.clear();
+  for (uint8_t i = 0; i < sink.stored(); ++i) {
+    planner.addRange(sink.at(i).address, 1);
+  }
+  sink.clear();
+  const uint32_t rewriteStart = millis();
+  nor.endReadSession();
+  const MemoryOperationStatus status = nor.rewrite(planner, kPattern);
+  nor.beginReadSession();
+  eraseCounts.save(kEraseCountsEepromAddress);
+  Serial.print(F("NOR Flash rewritten in "));
+  Serial.print(millis() - rewriteStart);
+  Serial.println(status == MemoryOperationStatus::kDone ? F(" ms") :
+      F(" ms, with failed erases or programs"));
+  printMostErasedSector();
+}